@@ -520,6 +520,7 @@ Common.BrowserView {
                 target: newTabViewLoader.item && !browser.incognito ? newTabViewLoader.item : null
                 onBookmarkClicked: {
                     chrome.requestedUrl = url
+                    tabsModel.currentTab.historyTransition = HistoryModel.Bookmark
                     currentWebview.url = url
                     tabContainer.forceActiveFocus()
                 }
@@ -946,32 +947,16 @@ Common.BrowserView {
         Keys.onEscapePressed: internal.resetFocus()
 
         models: searchTerms && searchTerms.length > 0 ?
-                [historySuggestions,
-                 bookmarksSuggestions,
+                [rankedSuggestions,
                  searchSuggestions.limit(4)] : []
 
-        LimitProxyModel {
-            id: historySuggestions
-            limit: 2
-            readonly property string icon: "history"
-            readonly property bool displayUrl: true
-            sourceModel: TextSearchFilterModel {
-                sourceModel: HistoryModel
-                terms: suggestionsList.searchTerms
-                searchFields: ["url", "title"]
-            }
-        }
-
-        LimitProxyModel {
-            id: bookmarksSuggestions
-            limit: 2
-            readonly property string icon: "non-starred"
-            readonly property bool displayUrl: true
-            sourceModel: TextSearchFilterModel {
-                sourceModel: BookmarksModel
-                terms: suggestionsList.searchTerms
-                searchFields: ["url", "title"]
-            }
+        SuggestionEngine {
+            id: rankedSuggestions
+            historyModel: HistoryModel
+            bookmarksModel: BookmarksModel
+            tabsModel: browser.tabsModel
+            terms: suggestionsList.searchTerms
+            limit: 4
         }
 
         SearchSuggestions {
@@ -991,6 +976,8 @@ Common.BrowserView {
         }
 
         onActivated: {
+            // Picking a suggestion counts as typing its URL
+            tabsModel.currentTab.historyTransition = HistoryModel.Typed
             browser.currentWebview.url = url
             tabContainer.forceActiveFocus()
             chrome.requestedUrl = url
@@ -1148,7 +1135,7 @@ Common.BrowserView {
             target: bookmarksViewLoader.item
 
             onBookmarkEntryClicked: {
-                internal.openUrlInNewTab(url, true)
+                internal.openUrlInNewTab(url, true, true, undefined, HistoryModel.Bookmark)
                 bookmarksViewLoader.active = false
             }
             onBack: bookmarksViewLoader.active = false
@@ -1346,9 +1333,13 @@ Common.BrowserView {
             if (share) share.shareText(text)
         }
 
-        function openUrlInNewTab(url, setCurrent, load, index) {
+        function openUrlInNewTab(url, setCurrent, load, index, historyTransition) {
             load = typeof load !== 'undefined' ? load : true
-            var tab = internal.createTabHelper({"initialUrl": url})
+            var properties = {"initialUrl": url}
+            if (historyTransition !== undefined) {
+                properties["historyTransition"] = historyTransition
+            }
+            var tab = internal.createTabHelper(properties)
             addTab(tab, setCurrent, index)
             if (load) {
                 tab.load()
@@ -45,6 +45,9 @@ FocusScope {
     property bool incognito
     readonly property bool empty: !url.toString() && !initialUrl.toString() && !restoreState && !request
     property bool loadingPreview: false
+    // How the user got to the page being loaded, recorded in the history
+    // (see HistoryModel.add()) and reset once the load is over
+    property int historyTransition: HistoryModel.Link
     readonly property size previewSize: webview ? Qt.size(webview.width*Screen.devicePixelRatio,
                                                 webview.height*Screen.devicePixelRatio) : Qt.size(0,0)
     readonly property size previewThumbnailSize: webview ? Qt.size(webview.width/1.5,
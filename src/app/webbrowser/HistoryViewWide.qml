@@ -138,6 +138,9 @@ Common.BrowserPage {
         id: historySearchModel
         searchFields: ["title", "url"]
         terms: searchQuery.terms
+        // The whole history is searched, match it off the UI thread
+        // so that typing doesn't stall on long histories
+        asynchronous: true
     }
 
     TextField {
@@ -19,6 +19,7 @@
 import QtQuick 2.7
 import Ubuntu.Components 1.3
 import QtWebEngine 1.10
+import webbrowserapp.private 0.1
 import ".."
 
 FocusScope {
@@ -188,6 +189,7 @@ FocusScope {
             onValidated: {
                 if (!findInPageMode) {
                     internal.webview.forceActiveFocus()
+                    root.tab.historyTransition = HistoryModel.Typed
                     internal.webview.url = requestedUrl
                 }
             }
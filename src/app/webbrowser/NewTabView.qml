@@ -34,7 +34,7 @@ FocusScope {
 
     TopSitesModel {
         id: topSitesModel
-        model: HistoryModel
+        sourceModel: HistoryModel
     }
 
     QtObject {
@@ -48,7 +48,7 @@ FocusScope {
         id: topSitesModel
         limit: 10
         sourceModel: TopSitesModel {
-            model: HistoryModel
+            sourceModel: HistoryModel
         }
     }
 
@@ -32,7 +32,7 @@ Item {
         id: topSites
         limit: 10
         sourceModel: TopSitesModel {
-            model: HistoryModel
+            sourceModel: HistoryModel
         }
         function contains(url) {
             for (var i = 0; i < topSites.count; i++) {
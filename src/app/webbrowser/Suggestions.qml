@@ -60,9 +60,11 @@ FocusScope {
                 for (var i = 0; i < model.count; i++) modelItems.push(model.get(i))
             }
 
+            // Items may carry their own icon and displayUrl, otherwise they
+            // are those of the model
             modelItems.forEach(function(item) {
-                item["icon"] = model.icon
-                item["displayUrl"] = model.displayUrl
+                if (item.icon === undefined) item["icon"] = model.icon
+                if (item.displayUrl === undefined) item["displayUrl"] = model.displayUrl
                 list.push(item)
             })
             return list
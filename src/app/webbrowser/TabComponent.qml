@@ -139,6 +139,11 @@ Component {
             }
 
             onLoadingChanged: {
+                var transition = tab.historyTransition
+                if (loadRequest.status !== WebEngineLoadRequest.LoadStartedStatus) {
+                    tab.historyTransition = HistoryModel.Link
+                }
+
                 if (loadRequest.status === WebEngineLoadRequest.LoadSucceededStatus) {
                     chrome.findInPageMode = false
                     webviewInternal.titleSet = false
@@ -152,7 +157,7 @@ Component {
                 if (loadRequest.status === WebEngineLoadRequest.LoadSucceededStatus) {
                     webviewInternal.storedUrl = loadRequest.url
                     // note: at this point the icon is an empty string most times, not sure why (seems to be set after this event)
-                    HistoryModel.add(loadRequest.url, title, (UrlUtils.schemeIs(icon, "image") && UrlUtils.hostIs(icon, "favicon")) ? icon.toString().substring(("image://favicon/").length) : icon)
+                    HistoryModel.add(loadRequest.url, title, (UrlUtils.schemeIs(icon, "image") && UrlUtils.hostIs(icon, "favicon")) ? icon.toString().substring(("image://favicon/").length) : icon, transition)
                 }
 
                 // If the page has started, stopped, redirected, errored
@@ -17,15 +17,8 @@
  */
 
 import QtQuick 2.4
-import Ubuntu.Components 1.3
+import webbrowserapp.private 0.1
 
-SortFilterModel {
-    sort {
-        order: Qt.DescendingOrder
-        property: "visits"
-    }
-    filter {
-        pattern: /^false$/
-        property: "hidden"
-    }
+HistoryTopSitesModel {
+    limit: 10
 }
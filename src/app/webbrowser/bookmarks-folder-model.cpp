@@ -19,40 +19,76 @@
 #include "bookmarks-folder-model.h"
 #include "bookmarks-model.h"
 
-// Qt
-#include <QtCore/QUrl>
-
 /*!
     \class BookmarksFolderModel
-    \brief Proxy model that filters the contents of a bookmarks model
-           based on a folder name
+    \brief List model that exposes the entries of a bookmarks model
+           for a given folder name
 
-    BookmarksFolderModel is a proxy model that filters the contents of a
-    bookmarks model based on a folder name.
+    BookmarksFolderModel is a view on the entries of a bookmarks model that
+    are stored in a given folder, sorted chronologically (most recent first),
+    with the same roles.
 
     An entry in the bookmarks model matches if it is stored in a folder
     with the same name that the filter folder name (case-sensitive
-    comparison).
+    comparison). Matching entries are looked up in the folder partition of
+    the bookmarks model, which notifies the view of changes to those entries
+    only.
 
     When no folder name is set (null or empty string), all entries that
     are not stored in any folder match.
 */
 BookmarksFolderModel::BookmarksFolderModel(QObject* parent)
-    : QSortFilterProxyModel(parent)
+    : QAbstractListModel(parent)
+{
+    connect(this, SIGNAL(modelReset()), SIGNAL(countChanged()));
+    connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)), SIGNAL(countChanged()));
+    connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)), SIGNAL(countChanged()));
+}
+
+BookmarksFolderModel::~BookmarksFolderModel()
 {
+    detach();
+}
+
+QHash<int, QByteArray> BookmarksFolderModel::roleNames() const
+{
+    if (m_sourceModel.isNull()) {
+        return QHash<int, QByteArray>();
+    }
+    return m_sourceModel->roleNames();
+}
+
+int BookmarksFolderModel::rowCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    if (m_sourceModel.isNull()) {
+        return 0;
+    }
+    return m_sourceModel->folderEntryCount(m_folder);
+}
+
+QVariant BookmarksFolderModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || m_sourceModel.isNull()) {
+        return QVariant();
+    }
+    return m_sourceModel->folderEntryData(m_folder, index.row(), role);
 }
 
 BookmarksModel* BookmarksFolderModel::sourceModel() const
 {
-    return qobject_cast<BookmarksModel*>(QSortFilterProxyModel::sourceModel());
+    return m_sourceModel;
 }
 
 void BookmarksFolderModel::setSourceModel(BookmarksModel* sourceModel)
 {
-    if (sourceModel != this->sourceModel()) {
-        QSortFilterProxyModel::setSourceModel(sourceModel);
+    if (sourceModel != m_sourceModel) {
+        beginResetModel();
+        detach();
+        m_sourceModel = sourceModel;
+        attach();
+        endResetModel();
         Q_EMIT sourceModelChanged();
-        Q_EMIT countChanged();
     }
 }
 
@@ -64,10 +100,12 @@ const QString& BookmarksFolderModel::folder() const
 void BookmarksFolderModel::setFolder(const QString& folder)
 {
     if (folder != m_folder) {
+        beginResetModel();
+        detach();
         m_folder = folder;
-        invalidate();
+        attach();
+        endResetModel();
         Q_EMIT folderChanged();
-        Q_EMIT countChanged();
     }
 }
 
@@ -96,9 +134,16 @@ QVariantMap BookmarksFolderModel::get(int row) const
     return res;
 }
 
-bool BookmarksFolderModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+void BookmarksFolderModel::attach()
 {
-    QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
-    QString folder = sourceModel()->data(index, BookmarksModel::Folder).toString();
-    return (folder.compare(m_folder, Qt::CaseSensitive) == 0);
+    if (!m_sourceModel.isNull()) {
+        m_sourceModel->registerFolderModel(this);
+    }
+}
+
+void BookmarksFolderModel::detach()
+{
+    if (!m_sourceModel.isNull()) {
+        m_sourceModel->unregisterFolderModel(this);
+    }
 }
@@ -20,12 +20,13 @@
 #define __BOOKMARKS_FOLDER_MODEL_H__
 
 // Qt
-#include <QtCore/QSortFilterProxyModel>
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QPointer>
 #include <QtCore/QString>
 
 class BookmarksModel;
 
-class BookmarksFolderModel : public QSortFilterProxyModel
+class BookmarksFolderModel : public QAbstractListModel
 {
     Q_OBJECT
 
@@ -35,6 +36,12 @@ class BookmarksFolderModel : public QSortFilterProxyModel
 
 public:
     BookmarksFolderModel(QObject* parent=0);
+    ~BookmarksFolderModel();
+
+    // reimplemented from QAbstractListModel
+    QHash<int, QByteArray> roleNames() const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
 
     BookmarksModel* sourceModel() const;
     void setSourceModel(BookmarksModel* sourceModel);
@@ -50,12 +57,14 @@ Q_SIGNALS:
     void folderChanged() const;
     void countChanged() const;
 
-protected:
-    // reimplemented from QSortFilterProxyModel
-    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
-
 private:
+    friend class BookmarksModel;
+
+    QPointer<BookmarksModel> m_sourceModel;
     QString m_folder;
+
+    void attach();
+    void detach();
 };
 
 #endif // __BOOKMARKS_FOLDER_MODEL_H__
@@ -24,6 +24,9 @@
 #include <QtCore/QDebug>
 #include <QtCore/QStringList>
 
+// std
+#include <algorithm>
+
 /*!
     \class BookmarksFolderListModel
     \brief List model that exposes bookmarks entries grouped by folder name
@@ -32,6 +35,10 @@
     from a BookmarksModel grouped by folder name. Each item in the list has
     two roles: 'folder' for the folder name and 'entries' for the corresponding
     BookmarksFolderModel that contains all entries in this group.
+
+    Folders are kept sorted by name in a vector, along with a hash of the row
+    of each folder, so that accessing data and looking up folders by name
+    don’t depend on the number of folders.
 */
 BookmarksFolderListModel::BookmarksFolderListModel(QObject* parent)
     : QAbstractListModel(parent)
@@ -65,12 +72,11 @@ QVariant BookmarksFolderListModel::data(const QModelIndex& index, int role) cons
     if (!index.isValid() || !checkValidFolderIndex(index.row())) {
         return QVariant();
     }
-    const QString folder = m_folders.keys().at(index.row());
-    BookmarksFolderModel* entries = m_folders.value(folder);
+    BookmarksFolderModel* entries = m_folders.at(index.row());
 
     switch (role) {
     case Folder:
-        return folder;
+        return entries->folder();
     case Entries:
         return QVariant::fromValue(entries);
     default:
@@ -95,6 +101,8 @@ void BookmarksFolderListModel::setSourceModel(BookmarksModel* sourceModel)
         populateModel();
         if (m_sourceModel != 0) {
             connect(m_sourceModel, SIGNAL(folderAdded(const QString&)), SLOT(onFolderAdded(const QString&)));
+            connect(m_sourceModel, SIGNAL(foldersAdded(const QStringList&)), SLOT(onFoldersAdded(const QStringList&)));
+            connect(m_sourceModel, SIGNAL(folderRemoved(const QString&)), SLOT(onFolderRemoved(const QString&)));
             connect(m_sourceModel, SIGNAL(modelReset()), SLOT(onModelReset()));
         }
         endResetModel();
@@ -125,8 +133,7 @@ QVariantMap BookmarksFolderListModel::get(int row) const
 
 int BookmarksFolderListModel::indexOf(const QString& folder) const
 {
-    QStringList folders = m_folders.keys();
-    return folders.indexOf(folder);
+    return m_rows.value(folder, -1);
 }
 
 void BookmarksFolderListModel::createNewFolder(const QString& folder)
@@ -145,41 +152,88 @@ bool BookmarksFolderListModel::checkValidFolderIndex(int index) const
 
 void BookmarksFolderListModel::clearFolders()
 {
-    Q_FOREACH(const QString& folder, m_folders.keys()) {
-        delete m_folders.take(folder);
-    }
+    qDeleteAll(m_folders);
+    m_folders.clear();
+    m_rows.clear();
+}
+
+static bool folderLessThan(const BookmarksFolderModel* a, const BookmarksFolderModel* b)
+{
+    return a->folder().compare(b->folder()) < 0;
 }
 
 void BookmarksFolderListModel::populateModel()
 {
     if (m_sourceModel != 0) {
         Q_FOREACH(const QString& folder, m_sourceModel->folders()) {
-            if (!m_folders.contains(folder)) {
-                addFolder(folder);
+            if (!m_rows.contains(folder)) {
+                m_rows.insert(folder, -1);
+                m_folders.append(createFolderModel(folder));
             }
         }
+        std::sort(m_folders.begin(), m_folders.end(), folderLessThan);
+        updateRows(0);
     }
 }
 
 void BookmarksFolderListModel::onFolderAdded(const QString& folder)
 {
-    if (!m_folders.contains(folder)) {
-        QStringList folders = m_folders.keys();
-        int insertAt = 0;
-        while (insertAt < folders.count()) {
-            if (folder.compare(folders.at(insertAt)) < 0) {
-                break;
-            }
-            ++insertAt;
-        }
-        beginInsertRows(QModelIndex(), insertAt, insertAt);
-        addFolder(folder);
+    if (!m_rows.contains(folder)) {
+        int row = insertionRow(folder);
+        beginInsertRows(QModelIndex(), row, row);
+        m_folders.insert(row, createFolderModel(folder));
+        updateRows(row);
         endInsertRows();
 
         Q_EMIT countChanged();
     }
 }
 
+/*
+    Folders notified in a batch (typically when the source model is loaded)
+    are all added with a single model reset. Existing folder models are
+    preserved.
+*/
+void BookmarksFolderListModel::onFoldersAdded(const QStringList& folders)
+{
+    QStringList added;
+    Q_FOREACH(const QString& folder, folders) {
+        if (!m_rows.contains(folder)) {
+            added.append(folder);
+        }
+    }
+    if (added.isEmpty()) {
+        return;
+    } else if (added.count() == 1) {
+        onFolderAdded(added.first());
+        return;
+    }
+
+    beginResetModel();
+    Q_FOREACH(const QString& folder, added) {
+        m_folders.append(createFolderModel(folder));
+    }
+    std::sort(m_folders.begin(), m_folders.end(), folderLessThan);
+    updateRows(0);
+    endResetModel();
+
+    Q_EMIT countChanged();
+}
+
+void BookmarksFolderListModel::onFolderRemoved(const QString& folder)
+{
+    int row = m_rows.value(folder, -1);
+    if (row != -1) {
+        beginRemoveRows(QModelIndex(), row, row);
+        delete m_folders.takeAt(row);
+        m_rows.remove(folder);
+        updateRows(row);
+        endRemoveRows();
+
+        Q_EMIT countChanged();
+    }
+}
+
 void BookmarksFolderListModel::onModelReset()
 {
     beginResetModel();
@@ -190,7 +244,7 @@ void BookmarksFolderListModel::onModelReset()
     Q_EMIT countChanged();
 }
 
-void BookmarksFolderListModel::addFolder(const QString& folder)
+BookmarksFolderModel* BookmarksFolderListModel::createFolderModel(const QString& folder)
 {
     BookmarksFolderModel* model = new BookmarksFolderModel(this);
     model->setSourceModel(m_sourceModel);
@@ -201,7 +255,24 @@ void BookmarksFolderListModel::addFolder(const QString& folder)
     connect(model, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)), SLOT(onFolderDataChanged()));
     connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), SLOT(onFolderDataChanged()));
     connect(model, SIGNAL(modelReset()), SLOT(onFolderDataChanged()));
-    m_folders.insert(folder, model);
+    return model;
+}
+
+int BookmarksFolderListModel::insertionRow(const QString& folder) const
+{
+    QVector<BookmarksFolderModel*>::const_iterator i =
+        std::upper_bound(m_folders.constBegin(), m_folders.constEnd(), folder,
+                         [] (const QString& name, const BookmarksFolderModel* model) {
+                             return name.compare(model->folder()) < 0;
+                         });
+    return i - m_folders.constBegin();
+}
+
+void BookmarksFolderListModel::updateRows(int first)
+{
+    for (int i = first; i < m_folders.count(); ++i) {
+        m_rows.insert(m_folders.at(i)->folder(), i);
+    }
 }
 
 void BookmarksFolderListModel::onFolderDataChanged()
@@ -214,7 +285,7 @@ void BookmarksFolderListModel::onFolderDataChanged()
 
 void BookmarksFolderListModel::emitDataChanged(const QString& folder)
 {
-    int i = m_folders.keys().indexOf(folder);
+    int i = m_rows.value(folder, -1);
     if (i != -1) {
         QModelIndex index = this->index(i, 0);
         Q_EMIT dataChanged(index, index, QVector<int>() << Entries);
@@ -21,8 +21,10 @@
 
 // Qt
 #include <QtCore/QAbstractListModel>
-#include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
 
 class BookmarksFolderModel;
 class BookmarksModel;
@@ -63,18 +65,24 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void onFolderAdded(const QString& folder);
+    void onFoldersAdded(const QStringList& folders);
+    void onFolderRemoved(const QString& folder);
     void onModelReset();
 
     void onFolderDataChanged();
 
 private:
     BookmarksModel* m_sourceModel;
-    QMap<QString, BookmarksFolderModel*> m_folders;
+    // Folder models sorted by folder name, and the row of each folder
+    QVector<BookmarksFolderModel*> m_folders;
+    QHash<QString, int> m_rows;
 
     bool checkValidFolderIndex(int row) const;
     void clearFolders();
     void populateModel();
-    void addFolder(const QString& folder);
+    BookmarksFolderModel* createFolderModel(const QString& folder);
+    int insertionRow(const QString& folder) const;
+    void updateRows(int first);
     void emitDataChanged(const QString& folder);
 };
 
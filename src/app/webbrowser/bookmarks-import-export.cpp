@@ -0,0 +1,348 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bookmarks-import-export.h"
+
+// Qt
+#include <QtCore/QHash>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QStack>
+
+#define READ_CHUNK_SIZE 65536
+
+namespace BookmarksImportExport {
+
+namespace {
+
+QString decodeEntities(const QString& text)
+{
+    if (!text.contains(QLatin1Char('&'))) {
+        return text;
+    }
+    static const QRegularExpression entity(QStringLiteral("&(#x[0-9a-fA-F]+|#[0-9]+|[a-zA-Z]+);"));
+    QString decoded;
+    decoded.reserve(text.size());
+    int last = 0;
+    QRegularExpressionMatchIterator i = entity.globalMatch(text);
+    while (i.hasNext()) {
+        QRegularExpressionMatch match = i.next();
+        decoded.append(text.midRef(last, match.capturedStart() - last));
+        last = match.capturedEnd();
+        const QString name = match.captured(1);
+        uint code = 0;
+        if (name.startsWith(QLatin1String("#x"))) {
+            code = name.mid(2).toUInt(nullptr, 16);
+        } else if (name.startsWith(QLatin1Char('#'))) {
+            code = name.mid(1).toUInt();
+        } else if (name == QLatin1String("amp")) {
+            code = '&';
+        } else if (name == QLatin1String("lt")) {
+            code = '<';
+        } else if (name == QLatin1String("gt")) {
+            code = '>';
+        } else if (name == QLatin1String("quot")) {
+            code = '"';
+        } else if (name == QLatin1String("apos")) {
+            code = '\'';
+        } else if (name == QLatin1String("nbsp")) {
+            code = 0xa0;
+        }
+        if (code > 0) {
+            decoded.append(QString::fromUcs4(&code, 1));
+        } else {
+            decoded.append(match.captured(0));
+        }
+    }
+    decoded.append(text.midRef(last));
+    return decoded;
+}
+
+QHash<QString, QString> attributes(const QString& tag)
+{
+    static const QRegularExpression expression(QStringLiteral("\\s([\\w-]+)\\s*=\\s*\"([^\"]*)\""));
+    QHash<QString, QString> values;
+    QRegularExpressionMatchIterator i = expression.globalMatch(tag);
+    while (i.hasNext()) {
+        QRegularExpressionMatch match = i.next();
+        values.insert(match.captured(1).toUpper(), decodeEntities(match.captured(2)));
+    }
+    return values;
+}
+
+/*
+    The Netscape bookmark file format is loosely structured HTML that can't
+    be parsed as XML: folders are <H3> headers, each of them followed by a
+    <DL> list that contains its bookmarks as <A> links. The input is read in
+    chunks and scanned tag by tag. BookmarksModel has no nested folders, so
+    bookmarks go to the innermost folder that contains them.
+*/
+bool readNetscapeHtml(QIODevice* device, const EntryHandler& handleEntry,
+                      const ProgressHandler& handleProgress)
+{
+    enum Capture {
+        None,
+        FolderName,
+        Title
+    };
+
+    QTextStream stream(device);
+    stream.setCodec("UTF-8");
+    qint64 size = device->size();
+    QString buffer;
+    QStack<QString> folders;
+    QString pendingFolder;
+    bool hasPendingFolder = false;
+    bool hasDocType = false;
+    Capture capture = None;
+    QString text;
+    BookmarksModel::BookmarkEntry entry;
+
+    bool atEnd = false;
+    while (!atEnd) {
+        QString chunk = stream.read(READ_CHUNK_SIZE);
+        atEnd = chunk.isEmpty();
+        buffer.append(chunk);
+
+        int position = 0;
+        forever {
+            int start = buffer.indexOf(QLatin1Char('<'), position);
+            int end = (start == -1) ? -1 : buffer.indexOf(QLatin1Char('>'), start);
+            if (end == -1) {
+                // wait for the end of the tag in the next chunk
+                int length = ((start == -1) ? buffer.size() : start) - position;
+                if (capture != None) {
+                    text.append(buffer.midRef(position, length));
+                }
+                position += length;
+                break;
+            }
+            if (capture != None) {
+                text.append(buffer.midRef(position, start - position));
+            }
+            position = end + 1;
+
+            const QString tag = buffer.mid(start + 1, end - start - 1);
+            int nameLength = 0;
+            while ((nameLength < tag.size()) && !tag.at(nameLength).isSpace()) {
+                ++nameLength;
+            }
+            const QString name = tag.left(nameLength).toUpper();
+            if (name == QLatin1String("!DOCTYPE")) {
+                hasDocType = tag.contains(QLatin1String("NETSCAPE-Bookmark-file"), Qt::CaseInsensitive);
+            } else if (name == QLatin1String("H3")) {
+                capture = FolderName;
+                text.clear();
+            } else if ((name == QLatin1String("/H3")) && (capture == FolderName)) {
+                pendingFolder = decodeEntities(text.simplified());
+                hasPendingFolder = true;
+                capture = None;
+            } else if (name == QLatin1String("DL")) {
+                if (hasPendingFolder) {
+                    folders.push(pendingFolder);
+                    hasPendingFolder = false;
+                } else {
+                    folders.push(folders.isEmpty() ? QString() : folders.top());
+                }
+            } else if (name == QLatin1String("/DL")) {
+                if (!folders.isEmpty()) {
+                    folders.pop();
+                }
+            } else if (name == QLatin1String("A")) {
+                const QHash<QString, QString> values = attributes(tag);
+                entry = BookmarksModel::BookmarkEntry();
+                entry.url = QUrl(values.value(QStringLiteral("HREF")));
+                QString added = values.value(QStringLiteral("ADD_DATE"));
+                if (!added.isEmpty()) {
+                    entry.created = QDateTime::fromMSecsSinceEpoch(added.toLongLong() * 1000);
+                }
+                entry.icon = QUrl(values.value(QStringLiteral("ICON_URI")));
+                capture = Title;
+                text.clear();
+            } else if ((name == QLatin1String("/A")) && (capture == Title)) {
+                capture = None;
+                // Skip the smart bookmarks of Firefox (e.g. 'place:sort=8')
+                if (entry.url.isValid() && !entry.url.isRelative() &&
+                        (entry.url.scheme() != QLatin1String("place"))) {
+                    entry.title = decodeEntities(text.simplified());
+                    entry.folder = folders.isEmpty() ? QString() : folders.top();
+                    handleEntry(entry);
+                }
+            }
+        }
+        buffer.remove(0, position);
+
+        if (!hasDocType) {
+            return false;
+        }
+        if (size > 0) {
+            handleProgress(qreal(device->pos()) / size);
+        }
+    }
+    return true;
+}
+
+/*
+    The JSON format is an array of objects that have the same properties as
+    the roles of BookmarksModel, the creation date being in milliseconds
+    since the epoch.
+*/
+bool readJson(QIODevice* device, const EntryHandler& handleEntry,
+              const ProgressHandler& handleProgress)
+{
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(device->readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !document.isArray()) {
+        return false;
+    }
+    const QJsonArray array = document.array();
+    int count = array.count();
+    int index = 0;
+    Q_FOREACH(const QJsonValue& value, array) {
+        const QJsonObject object = value.toObject();
+        BookmarksModel::BookmarkEntry entry;
+        entry.url = QUrl(object.value(QStringLiteral("url")).toString());
+        entry.title = object.value(QStringLiteral("title")).toString();
+        entry.icon = QUrl(object.value(QStringLiteral("icon")).toString());
+        QJsonValue created = object.value(QStringLiteral("created"));
+        if (created.isDouble()) {
+            entry.created = QDateTime::fromMSecsSinceEpoch(qint64(created.toDouble()));
+        }
+        entry.folder = object.value(QStringLiteral("folder")).toString();
+        if (entry.url.isValid() && !entry.url.isRelative()) {
+            handleEntry(entry);
+        }
+        if (++index % 1000 == 0) {
+            handleProgress(qreal(index) / count);
+        }
+    }
+    handleProgress(1.0);
+    return true;
+}
+
+}
+
+Format formatForFileName(const QString& fileName)
+{
+    if (fileName.endsWith(QLatin1String(".json"), Qt::CaseInsensitive)) {
+        return Json;
+    } else {
+        return NetscapeHtml;
+    }
+}
+
+bool read(QIODevice* device, Format format,
+          const EntryHandler& handleEntry, const ProgressHandler& handleProgress)
+{
+    switch (format) {
+    case NetscapeHtml:
+        return readNetscapeHtml(device, handleEntry, handleProgress);
+    case Json:
+        return readJson(device, handleEntry, handleProgress);
+    default:
+        Q_UNREACHABLE();
+    }
+}
+
+Writer::Writer(QIODevice* device, Format format)
+    : m_stream(device)
+    , m_format(format)
+    , m_count(0)
+{
+    m_stream.setCodec("UTF-8");
+    switch (m_format) {
+    case NetscapeHtml:
+        m_stream << "<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+                    "<!-- This is an automatically generated file.\n"
+                    "     It will be read and overwritten.\n"
+                    "     DO NOT EDIT! -->\n"
+                    "<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; charset=UTF-8\">\n"
+                    "<TITLE>Bookmarks</TITLE>\n"
+                    "<H1>Bookmarks</H1>\n"
+                    "<DL><p>\n";
+        break;
+    case Json:
+        m_stream << "[";
+        break;
+    }
+}
+
+void Writer::writeEntry(const BookmarksModel::BookmarkEntry& entry)
+{
+    switch (m_format) {
+    case NetscapeHtml: {
+        if (entry.folder != m_folder) {
+            if (!m_folder.isEmpty()) {
+                m_stream << "    </DL><p>\n";
+            }
+            m_folder = entry.folder;
+            if (!m_folder.isEmpty()) {
+                m_stream << "    <DT><H3>" << m_folder.toHtmlEscaped() << "</H3>\n"
+                         << "    <DL><p>\n";
+            }
+        }
+        const char* indentation = m_folder.isEmpty() ? "    " : "        ";
+        m_stream << indentation << "<DT><A HREF=\"" << entry.url.toString().toHtmlEscaped()
+                 << "\" ADD_DATE=\"" << (entry.created.toMSecsSinceEpoch() / 1000) << "\"";
+        if (!entry.icon.isEmpty()) {
+            m_stream << " ICON_URI=\"" << entry.icon.toString().toHtmlEscaped() << "\"";
+        }
+        m_stream << ">" << entry.title.toHtmlEscaped() << "</A>\n";
+        break;
+    }
+    case Json: {
+        QJsonObject object;
+        object.insert(QStringLiteral("url"), entry.url.toString());
+        object.insert(QStringLiteral("title"), entry.title);
+        object.insert(QStringLiteral("icon"), entry.icon.toString());
+        object.insert(QStringLiteral("created"), double(entry.created.toMSecsSinceEpoch()));
+        object.insert(QStringLiteral("folder"), entry.folder);
+        m_stream << ((m_count > 0) ? ",\n" : "\n")
+                 << QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        break;
+    }
+    }
+    ++m_count;
+}
+
+bool Writer::finish()
+{
+    switch (m_format) {
+    case NetscapeHtml:
+        if (!m_folder.isEmpty()) {
+            m_stream << "    </DL><p>\n";
+        }
+        m_stream << "</DL><p>\n";
+        break;
+    case Json:
+        m_stream << "\n]\n";
+        break;
+    }
+    m_stream.flush();
+    return (m_stream.status() == QTextStream::Ok);
+}
+
+int Writer::count() const
+{
+    return m_count;
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BOOKMARKS_IMPORT_EXPORT_H__
+#define __BOOKMARKS_IMPORT_EXPORT_H__
+
+// Qt
+#include <QtCore/QString>
+#include <QtCore/QTextStream>
+
+// std
+#include <functional>
+
+// local
+#include "bookmarks-model.h"
+
+class QIODevice;
+
+namespace BookmarksImportExport {
+
+enum Format {
+    NetscapeHtml,
+    Json
+};
+
+// JSON for files with a .json suffix, the Netscape bookmark file format
+// (as exported by all major browsers) otherwise.
+Format formatForFileName(const QString& fileName);
+
+typedef std::function<void(const BookmarksModel::BookmarkEntry&)> EntryHandler;
+typedef std::function<void(qreal)> ProgressHandler;
+
+// Read bookmarks from a device, calling the entry handler for each of them
+// as they are parsed, and the progress handler with the fraction of the
+// input read so far. Return false if the input is not in the given format.
+bool read(QIODevice* device, Format format,
+          const EntryHandler& handleEntry, const ProgressHandler& handleProgress);
+
+// Write bookmarks to a device one by one. Entries are expected to be
+// grouped by folder, entries of the default folder first.
+class Writer
+{
+public:
+    Writer(QIODevice* device, Format format);
+
+    void writeEntry(const BookmarksModel::BookmarkEntry& entry);
+    bool finish();
+
+    int count() const;
+
+private:
+    QTextStream m_stream;
+    Format m_format;
+    QString m_folder;
+    int m_count;
+};
+
+}
+
+#endif // __BOOKMARKS_IMPORT_EXPORT_H__
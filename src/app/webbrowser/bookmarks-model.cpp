@@ -16,13 +16,55 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "bookmarks-folder-model.h"
+#include "bookmarks-import-export.h"
 #include "bookmarks-model.h"
+#include "full-text-search.h"
 
 // Qt
 #include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QTimer>
 #include <QtSql/QSqlQuery>
 
-#define CONNECTION_NAME "morph-browser-bookmarks"
+// std
+#include <algorithm>
+
+#define SQL_DRIVER QStringLiteral("QSQLITE")
+#define CONNECTION_NAME QStringLiteral("morph-browser-bookmarks")
+#define FETCH_CHUNK_SIZE 2000
+
+/*
+    Merge entries sorted chronologically (most recent first) into a list
+    sorted the same way, entries already in the list going first when created
+    at the same time. Each run of consecutive merged entries is inserted at
+    once, between calls to begin(first, last) and end().
+*/
+template<typename Begin, typename End>
+static void mergeEntries(QList<BookmarksModel::BookmarkEntry>& entries,
+                         const QList<BookmarksModel::BookmarkEntry>& merged,
+                         Begin begin, End end)
+{
+    int position = 0;
+    int i = 0;
+    while (i < merged.count()) {
+        const QDateTime& created = merged.at(i).created;
+        while ((position < entries.count()) && (entries.at(position).created >= created)) {
+            ++position;
+        }
+        int last = i;
+        while ((last + 1 < merged.count()) && ((position == entries.count()) ||
+               (merged.at(last + 1).created > entries.at(position).created))) {
+            ++last;
+        }
+        begin(position, position + last - i);
+        for (int j = i; j <= last; ++j) {
+            entries.insert(position++, merged.at(j));
+        }
+        end();
+        i = last + 1;
+    }
+}
 
 /*!
     \class BookmarksModel
@@ -31,138 +73,172 @@
     BookmarksModel is a list model that stores bookmark entries for quick access
     to favourite websites. For a given URL, the following information is stored:
     page title and URL to the favorite icon if any.
-    The model is sorted alphabetically at all times (by URL).
+    The model is sorted chronologically at all times (most recent first).
 
     The information is persistently stored on disk in a SQLite database.
-    The database is read at startup to populate the model, and whenever a new
-    entry is added to the model or an entry is removed from the model
-    the database is updated.
+    All database operations happen on a separate thread: the database is read
+    asynchronously when set, the model being populated at once when done (the
+    loaded() signal is emitted then), and changes to the model are queued and
+    written in batches, so that the UI never blocks on disk access.
     However the model doesn’t monitor the database for external changes.
+
+    The URLs and titles of the bookmarks can also be searched in the database,
+    see matchUrls().
+
+    Bookmarks can be imported from and exported to files in bulk, see
+    importBookmarks() and exportBookmarks().
+
+    The entries are also partitioned by folder (see folderEntryCount() and
+    folderEntryData()), which is what BookmarksFolderModel views are built
+    upon: a change to an entry is notified to the views of its folder only.
 */
 BookmarksModel::BookmarksModel(QObject* parent)
     : QAbstractListModel(parent)
+    , m_lastMatchRequest(0)
+    , m_fetchGeneration(0)
 {
-    m_database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), CONNECTION_NAME);
+    m_dbWorker = new BookmarksDbWorker;
+    m_dbWorker->moveToThread(&m_dbWorkerThread);
+    connect(m_dbWorker, SIGNAL(foldersFetched(int, const QStringList&)),
+            SLOT(onFoldersFetched(int, const QStringList&)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(entriesFetched(int, const QVector<BookmarksModel::BookmarkEntry>&)),
+            SLOT(onEntriesFetched(int, const QVector<BookmarksModel::BookmarkEntry>&)),
+            Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(urlsMatched(int, const QList<QUrl>&)),
+            SIGNAL(urlsMatched(int, const QList<QUrl>&)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(loaded(int)), SLOT(onLoaded(int)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(importProgress(qreal)),
+            SIGNAL(importProgress(qreal)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(entriesImported(bool, const QVector<BookmarksModel::BookmarkEntry>&)),
+            SLOT(onEntriesImported(bool, const QVector<BookmarksModel::BookmarkEntry>&)),
+            Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(exportFinished(bool, int)),
+            SIGNAL(exportFinished(bool, int)), Qt::QueuedConnection);
+    m_dbWorkerThread.start(QThread::LowPriority);
 }
 
 BookmarksModel::~BookmarksModel()
 {
-    m_database.close();
-    m_database = QSqlDatabase();
-    QSqlDatabase::removeDatabase(CONNECTION_NAME);
+    m_dbWorker->deleteLater();
+    m_dbWorkerThread.quit();
+    m_dbWorkerThread.wait();
 }
 
 void BookmarksModel::resetDatabase(const QString& databaseName)
 {
     beginResetModel();
+    m_databasePath = databaseName;
     m_folders.clear();
     m_urls.clear();
     m_orderedEntries.clear();
-    m_database.close();
-    m_database.setDatabaseName(databaseName);
-    m_database.open();
-    createOrAlterDatabaseSchema();
+    m_fetchedFolders.clear();
+    m_fetchedEntries.clear();
+    rebuildFolderIndex();
+    Q_EMIT m_dbWorker->resetDatabase(databaseName);
     endResetModel();
-    populateFromDatabase();
+
+    // The default empty folder is not stored in the database
+    m_folders.insert(QString());
+    Q_EMIT folderAdded(QString());
+
+    // Results of the fetches of previous databases may still be queued,
+    // they are dropped
+    Q_EMIT m_dbWorker->fetchEntries(++m_fetchGeneration);
     Q_EMIT rowCountChanged();
 }
 
-void BookmarksModel::createOrAlterDatabaseSchema()
+/*
+    Folders fetched from the database are known to the model right away, but
+    they are notified in one batch with the foldersAdded() signal once the
+    entries are published, so that views don’t create and filter one proxy
+    model per folder while the model is being populated.
+*/
+void BookmarksModel::onFoldersFetched(int generation, const QStringList& folders)
 {
-    QSqlQuery createQuery(m_database);
-    QString query = QLatin1String("CREATE TABLE IF NOT EXISTS bookmarks "
-                                  "(url VARCHAR, title VARCHAR, icon VARCHAR, "
-                                  "created INTEGER, folderId INTEGER);");
-    createQuery.prepare(query);
-    createQuery.exec();
-
-    QSqlQuery createFolderQuery(m_database);
-    query = QLatin1String("CREATE TABLE IF NOT EXISTS folders "
-                          "(folderId INTEGER PRIMARY KEY, folder VARCHAR);");
-    createFolderQuery.prepare(query);
-    createFolderQuery.exec();
-
-    // Older version of the database schema didn’t have 'created' and/or
-    // 'folderId' columns
-    QSqlQuery tableInfoQuery(m_database);
-    query = QLatin1String("PRAGMA TABLE_INFO(bookmarks);");
-    tableInfoQuery.prepare(query);
-    tableInfoQuery.exec();
-
-    bool missingCreatedColumn = true;
-    bool missingFolderIdColumn = true;
-
-    while (tableInfoQuery.next()) {
-        if (tableInfoQuery.value("name").toString() == "created") {
-            missingCreatedColumn = false;
-        }
-        if (tableInfoQuery.value("name").toString() == "folderId") {
-            missingFolderIdColumn = false;
-        }
-        if (!missingCreatedColumn && !missingFolderIdColumn) {
-            break;
-        }
+    if (generation != m_fetchGeneration) {
+        return;
     }
-    if (missingCreatedColumn) {
-        QSqlQuery addCreatedColumnQuery(m_database);
-        query = QLatin1String("ALTER TABLE bookmarks ADD COLUMN created INTEGER;");
-        addCreatedColumnQuery.prepare(query);
-        addCreatedColumnQuery.exec();
-        // the default for the column is an empty value, which is interpreted as zero
-        // when converted to a number. Zero represents a date far in the past, so
-        // any newly created bookmark will correctly be represented as more recent than any other
-    }
-    if (missingFolderIdColumn) {
-        QSqlQuery addFolderColumnQuery(m_database);
-        query = QLatin1String("ALTER TABLE bookmarks ADD COLUMN folderId INTEGER;");
-        addFolderColumnQuery.prepare(query);
-        addFolderColumnQuery.exec();
+    Q_FOREACH(const QString& folder, folders) {
+        if (!m_folders.contains(folder)) {
+            m_folders.insert(folder);
+            m_fetchedFolders.append(folder);
+        }
     }
 }
 
-void BookmarksModel::populateFromDatabase()
+void BookmarksModel::onEntriesFetched(int generation, const QVector<BookmarkEntry>& entries)
 {
-    //Add default empty folder
-    m_folders.insert(0, "");
-    Q_EMIT folderAdded("");
-
-    QSqlQuery populateFolderQuery(m_database);
-    QString query = QLatin1String("SELECT folderId, folder FROM folders;");
-    populateFolderQuery.prepare(query);
-    populateFolderQuery.exec();
-    while (populateFolderQuery.next()) {
-        QString folder = populateFolderQuery.value(1).toString();
-        m_folders.insert(populateFolderQuery.value(0).toInt(), folder);
-        Q_EMIT folderAdded(folder);
+    if (generation != m_fetchGeneration) {
+        return;
     }
+    m_fetchedEntries += entries;
+}
 
-    QSqlQuery populateQuery(m_database);
-    query = QLatin1String("SELECT url, title, icon, created, folderId "
-                          "FROM bookmarks ORDER BY created DESC;");
-    populateQuery.prepare(query);
-    populateQuery.exec();
-    int count = 0;
-    while (populateQuery.next()) {
-        BookmarkEntry entry;
-        entry.url = populateQuery.value(0).toUrl();
-        entry.title = populateQuery.value(1).toString();
-        entry.icon = populateQuery.value(2).toUrl();
-        entry.created = QDateTime::fromMSecsSinceEpoch(populateQuery.value(3).toULongLong());
-        entry.folderId = populateQuery.value(4).toInt();
+/*
+    Fetched entries are accumulated and published in one go: with a single
+    model reset if the model is still empty. Otherwise they are merged with
+    the entries added or imported while loading (imported entries may be
+    older than fetched ones), so that the model remains sorted, with one row
+    insertion notification per run of consecutive fetched entries.
+*/
+void BookmarksModel::onLoaded(int generation)
+{
+    if (generation != m_fetchGeneration) {
+        return;
+    }
+    QList<BookmarkEntry> fetched;
+    fetched.reserve(m_fetchedEntries.count());
+    Q_FOREACH(const BookmarkEntry& entry, m_fetchedEntries) {
+        if (!m_urls.contains(entry.url)) {
+            fetched.append(entry);
+        }
+    }
+    m_fetchedEntries.clear();
+    m_fetchedEntries.squeeze();
 
-        if (m_folders.contains(entry.folderId)) {
-            entry.folder = m_folders.value(entry.folderId);
+    if (!fetched.isEmpty()) {
+        Q_FOREACH(const BookmarkEntry& entry, fetched) {
+            m_urls.insert(entry.url, entry.created);
+        }
+        if (m_orderedEntries.isEmpty()) {
+            beginResetModel();
+            m_orderedEntries = fetched;
+            rebuildFolderIndex();
+            endResetModel();
         } else {
-            entry.folderId = 0;
-            updateExistingEntryInDatabase(entry);
+            mergeEntries(m_orderedEntries, fetched,
+                         [this] (int first, int last) { beginInsertRows(QModelIndex(), first, last); },
+                         [this] () { endInsertRows(); });
+            QHash<QString, QList<BookmarkEntry>> groups;
+            Q_FOREACH(const BookmarkEntry& entry, fetched) {
+                groups[entry.folder].append(entry);
+            }
+            QHash<QString, QList<BookmarkEntry>>::const_iterator group;
+            for (group = groups.constBegin(); group != groups.constEnd(); ++group) {
+                QList<BookmarksFolderModel*> models = m_folderModels.values(group.key());
+                mergeEntries(m_folderIndex[group.key()], group.value(),
+                             [&models] (int first, int last) {
+                                 Q_FOREACH(BookmarksFolderModel* model, models) {
+                                     model->beginInsertRows(QModelIndex(), first, last);
+                                 }
+                             },
+                             [&models] () {
+                                 Q_FOREACH(BookmarksFolderModel* model, models) {
+                                     model->endInsertRows();
+                                 }
+                             });
+            }
         }
+        Q_EMIT rowCountChanged();
+    }
 
-        beginInsertRows(QModelIndex(), count, count);
-        m_urls.insert(entry.url);
-        m_orderedEntries.append(entry);
-        endInsertRows();
-        ++count;
+    if (!m_fetchedFolders.isEmpty()) {
+        QStringList folders = m_fetchedFolders;
+        m_fetchedFolders.clear();
+        Q_EMIT foldersAdded(folders);
     }
+
+    Q_EMIT loaded();
 }
 
 QHash<int, QByteArray> BookmarksModel::roleNames() const
@@ -189,7 +265,11 @@ QVariant BookmarksModel::data(const QModelIndex& index, int role) const
     if (!index.isValid()) {
         return QVariant();
     }
-    const BookmarkEntry& entry = m_orderedEntries.at(index.row());
+    return entryData(m_orderedEntries.at(index.row()), role);
+}
+
+QVariant BookmarksModel::entryData(const BookmarkEntry& entry, int role)
+{
     switch (role) {
     case Url:
         return entry.url;
@@ -208,7 +288,7 @@ QVariant BookmarksModel::data(const QModelIndex& index, int role) const
 
 const QString BookmarksModel::databasePath() const
 {
-    return m_database.databaseName();
+    return m_databasePath;
 }
 
 void BookmarksModel::setDatabasePath(const QString& path)
@@ -225,17 +305,229 @@ void BookmarksModel::setDatabasePath(const QString& path)
 
 QStringList BookmarksModel::folders() const
 {
-    return m_folders.values();
+    return m_folders.toList();
 }
 
-int BookmarksModel::addFolder(const QString& folder)
+/*!
+    Add a folder with the given name, if it doesn’t exist yet.
+
+    Folders are identified by their name, their identifiers in the database
+    are allocated on the database thread.
+*/
+void BookmarksModel::addFolder(const QString& folder)
 {
-    int newFolderId = insertNewFolderInDatabase(folder);
-    if (newFolderId != 0) {
-        m_folders.insert(newFolderId, folder);
+    if (!m_folders.contains(folder)) {
+        m_folders.insert(folder);
         Q_EMIT folderAdded(folder);
+        Q_EMIT m_dbWorker->enqueue(BookmarksDbWorker::InsertNewFolder, QVariantList() << folder);
+    }
+}
+
+/*!
+    Remove a folder along with all the bookmarks it contains.
+
+    The default folder (empty name) cannot be removed.
+*/
+void BookmarksModel::removeFolder(const QString& folder)
+{
+    if (folder.isEmpty()) {
+        qWarning() << "Cannot remove the default folder";
+        return;
+    }
+    if (!m_folders.contains(folder)) {
+        qWarning() << "Invalid folder:" << folder;
+        return;
+    }
+
+    QList<BookmarksFolderModel*> models = m_folderModels.values(folder);
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->beginResetModel();
+    }
+    QList<BookmarkEntry> entries = m_folderIndex.take(folder);
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->endResetModel();
+    }
+
+    // Look up the rows of the entries of the folder, then remove contiguous
+    // ranges of rows, last ones first
+    QVector<int> rows;
+    rows.reserve(entries.count());
+    Q_FOREACH(const BookmarkEntry& entry, entries) {
+        rows.append(entryPosition(m_orderedEntries, entry.url, entry.created));
+    }
+    std::sort(rows.begin(), rows.end());
+    int i = rows.count() - 1;
+    while (i >= 0) {
+        int last = rows.at(i);
+        int first = last;
+        while ((i > 0) && (rows.at(i - 1) == first - 1)) {
+            first = rows.at(--i);
+        }
+        --i;
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = first; row <= last; ++row) {
+            m_urls.remove(m_orderedEntries.at(row).url);
+        }
+        m_orderedEntries.erase(m_orderedEntries.begin() + first, m_orderedEntries.begin() + last + 1);
+        endRemoveRows();
+    }
+
+    m_folders.remove(folder);
+    Q_EMIT folderRemoved(folder);
+    Q_FOREACH(const BookmarkEntry& entry, entries) {
+        Q_EMIT removed(entry.url);
+    }
+    if (!entries.isEmpty()) {
+        Q_EMIT rowCountChanged();
     }
-    return newFolderId;
+    Q_EMIT m_dbWorker->enqueue(BookmarksDbWorker::RemoveFolder, QVariantList() << folder);
+}
+
+/*!
+    Return the number of entries in a given folder.
+*/
+int BookmarksModel::folderEntryCount(const QString& folder) const
+{
+    QHash<QString, QList<BookmarkEntry>>::const_iterator i = m_folderIndex.constFind(folder);
+    return (i == m_folderIndex.constEnd()) ? 0 : i.value().count();
+}
+
+/*!
+    Return the data for a given role of the entry at a given index among the
+    entries of a given folder (sorted chronologically, most recent first).
+*/
+QVariant BookmarksModel::folderEntryData(const QString& folder, int index, int role) const
+{
+    QHash<QString, QList<BookmarkEntry>>::const_iterator i = m_folderIndex.constFind(folder);
+    if ((i == m_folderIndex.constEnd()) || (index < 0) || (index >= i.value().count())) {
+        return QVariant();
+    }
+    return entryData(i.value().at(index), role);
+}
+
+/*
+    Entries are sorted chronologically, most recent first, both in the model
+    and in the folder index, so the position of an entry is looked up with a
+    binary search on its creation date. The order only breaks if the system
+    clock went back in time between two additions, the entries are scanned
+    in that case.
+*/
+int BookmarksModel::entryPosition(const QList<BookmarkEntry>& entries,
+                                  const QUrl& url, const QDateTime& created)
+{
+    QList<BookmarkEntry>::const_iterator i =
+        std::lower_bound(entries.constBegin(), entries.constEnd(), created,
+                         [] (const BookmarkEntry& entry, const QDateTime& created) {
+                             return entry.created > created;
+                         });
+    for (; (i != entries.constEnd()) && (i->created == created); ++i) {
+        if (i->url == url) {
+            return i - entries.constBegin();
+        }
+    }
+    for (int j = 0; j < entries.count(); ++j) {
+        if (entries.at(j).url == url) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+int BookmarksModel::folderEntryPosition(const QString& folder, const QUrl& url,
+                                        const QDateTime& created) const
+{
+    QHash<QString, QList<BookmarkEntry>>::const_iterator i = m_folderIndex.constFind(folder);
+    if (i == m_folderIndex.constEnd()) {
+        return -1;
+    }
+    return entryPosition(i.value(), url, created);
+}
+
+/*
+    Entries of a folder are sorted chronologically like the model, an entry
+    moved to a folder is inserted before the ones created at the same time
+    or earlier.
+*/
+int BookmarksModel::folderInsertionPosition(const QString& folder, const QDateTime& created) const
+{
+    const QList<BookmarkEntry> entries = m_folderIndex.value(folder);
+    QList<BookmarkEntry>::const_iterator i =
+        std::lower_bound(entries.constBegin(), entries.constEnd(), created,
+                         [] (const BookmarkEntry& entry, const QDateTime& created) {
+                             return entry.created > created;
+                         });
+    return i - entries.constBegin();
+}
+
+void BookmarksModel::insertInFolderIndex(const BookmarkEntry& entry, int position)
+{
+    QList<BookmarksFolderModel*> models = m_folderModels.values(entry.folder);
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->beginInsertRows(QModelIndex(), position, position);
+    }
+    m_folderIndex[entry.folder].insert(position, entry);
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->endInsertRows();
+    }
+}
+
+void BookmarksModel::removeFromFolderIndex(const QString& folder, const QUrl& url,
+                                           const QDateTime& created)
+{
+    int position = folderEntryPosition(folder, url, created);
+    if (position == -1) {
+        return;
+    }
+    QList<BookmarksFolderModel*> models = m_folderModels.values(folder);
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->beginRemoveRows(QModelIndex(), position, position);
+    }
+    QHash<QString, QList<BookmarkEntry>>::iterator i = m_folderIndex.find(folder);
+    i.value().removeAt(position);
+    if (i.value().isEmpty()) {
+        m_folderIndex.erase(i);
+    }
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->endRemoveRows();
+    }
+}
+
+void BookmarksModel::updateInFolderIndex(const BookmarkEntry& entry, const QVector<int>& roles)
+{
+    int position = folderEntryPosition(entry.folder, entry.url, entry.created);
+    if (position == -1) {
+        return;
+    }
+    m_folderIndex[entry.folder][position] = entry;
+    Q_FOREACH(BookmarksFolderModel* model, m_folderModels.values(entry.folder)) {
+        QModelIndex index = model->index(position, 0);
+        Q_EMIT model->dataChanged(index, index, roles);
+    }
+}
+
+void BookmarksModel::rebuildFolderIndex()
+{
+    QList<BookmarksFolderModel*> models = m_folderModels.values();
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->beginResetModel();
+    }
+    m_folderIndex.clear();
+    Q_FOREACH(const BookmarkEntry& entry, m_orderedEntries) {
+        m_folderIndex[entry.folder].append(entry);
+    }
+    Q_FOREACH(BookmarksFolderModel* model, models) {
+        model->endResetModel();
+    }
+}
+
+void BookmarksModel::registerFolderModel(BookmarksFolderModel* model)
+{
+    m_folderModels.insert(model->m_folder, model);
+}
+
+void BookmarksModel::unregisterFolderModel(BookmarksFolderModel* model)
+{
+    m_folderModels.remove(model->m_folder, model);
 }
 
 /*!
@@ -259,6 +551,7 @@ void BookmarksModel::add(const QUrl& url, const QString& title, const QUrl& icon
     if (m_urls.contains(url)) {
         qWarning() << "URL already bookmarked:" << url;
     } else {
+        addFolder(folder);
         beginInsertRows(QModelIndex(), 0, 0);
         BookmarkEntry entry;
         entry.url = url;
@@ -266,10 +559,10 @@ void BookmarksModel::add(const QUrl& url, const QString& title, const QUrl& icon
         entry.icon = icon;
         entry.created = QDateTime::currentDateTime();
         entry.folder = folder;
-        entry.folderId = getFolderId(entry.folder);
-        m_urls.insert(url);
+        m_urls.insert(url, entry.created);
         m_orderedEntries.prepend(entry);
         endInsertRows();
+        insertInFolderIndex(entry, 0);
         Q_EMIT added(url);
         insertNewEntryInDatabase(entry);
         Q_EMIT rowCountChanged();
@@ -278,21 +571,10 @@ void BookmarksModel::add(const QUrl& url, const QString& title, const QUrl& icon
 
 void BookmarksModel::insertNewEntryInDatabase(const BookmarkEntry& entry)
 {
-    QSqlQuery query(m_database);
-    static QString insertStatement = QLatin1String("INSERT INTO bookmarks (url, "
-                                                   "title, icon, created, folderId) "
-                                                   "VALUES (?, ?, ?, ?, ?);");
-    query.prepare(insertStatement);
-    query.addBindValue(entry.url.toString());
-    query.addBindValue(entry.title);
-    query.addBindValue(entry.icon.toString());
-    query.addBindValue(entry.created.toMSecsSinceEpoch());
-    if (!entry.folderId) {
-        query.addBindValue(QVariant());
-    } else {
-        query.addBindValue(entry.folderId);
-    }
-    query.exec();
+    QVariantList values;
+    values << entry.url.toString() << entry.title << entry.icon.toString()
+           << entry.created.toMSecsSinceEpoch() << entry.folder;
+    Q_EMIT m_dbWorker->enqueue(BookmarksDbWorker::InsertNewEntry, values);
 }
 
 /*!
@@ -302,22 +584,19 @@ void BookmarksModel::insertNewEntryInDatabase(const BookmarkEntry& entry)
 */
 void BookmarksModel::remove(const QUrl& url)
 {
-    if (m_urls.contains(url)) {
-        int index = 0;
-        Q_FOREACH(BookmarkEntry entry, m_orderedEntries) {
-            if (entry.url == url) {
-                beginRemoveRows(QModelIndex(), index, index);
-                m_orderedEntries.removeAt(index);
-                m_urls.remove(url);
-                endRemoveRows();
-                Q_EMIT removed(url);
-                removeExistingEntryFromDatabase(url);
-                Q_EMIT rowCountChanged();
-                return;
-            } else {
-                index++;
-            }
-        };
+    QHash<QUrl, QDateTime>::iterator i = m_urls.find(url);
+    if (i != m_urls.end()) {
+        const QDateTime created = i.value();
+        int index = entryPosition(m_orderedEntries, url, created);
+        const QString folder = m_orderedEntries.at(index).folder;
+        beginRemoveRows(QModelIndex(), index, index);
+        m_orderedEntries.removeAt(index);
+        m_urls.erase(i);
+        endRemoveRows();
+        removeFromFolderIndex(folder, url, created);
+        Q_EMIT removed(url);
+        removeExistingEntryFromDatabase(url);
+        Q_EMIT rowCountChanged();
     } else {
         qWarning() << "Invalid bookmark:" << url;
     }
@@ -325,39 +604,38 @@ void BookmarksModel::remove(const QUrl& url)
 
 void BookmarksModel::removeExistingEntryFromDatabase(const QUrl& url)
 {
-    QSqlQuery query(m_database);
-    static QString deleteStatement = QLatin1String("DELETE FROM bookmarks WHERE url=?;");
-    query.prepare(deleteStatement);
-    query.addBindValue(url.toString());
-    query.exec();
+    Q_EMIT m_dbWorker->enqueue(BookmarksDbWorker::RemoveExistingEntry,
+                               QVariantList() << url.toString());
 }
 
 void BookmarksModel::update(const QUrl& url, const QString& title, const QString& folder)
 {
-    if (m_urls.contains(url)) {
-        int index = 0;
-        Q_FOREACH(BookmarkEntry entry, m_orderedEntries) {
-            if (entry.url == url) {
-                BookmarkEntry& updatedEntry = m_orderedEntries[index];
-                QVector<int> roles;
-                if (title != updatedEntry.title) {
-                    updatedEntry.title = title;
-                    roles << Title;
-                }
-                if (folder != updatedEntry.folder) {
-                    updatedEntry.folder = folder;
-                    updatedEntry.folderId = getFolderId(updatedEntry.folder);
-                    roles << Folder;
-                }
-                if (!roles.isEmpty()) {
-                    Q_EMIT dataChanged(this->index(index, 0), this->index(index, 0), roles);
-                    updateExistingEntryInDatabase(updatedEntry);
-                }
-                return;
+    QHash<QUrl, QDateTime>::const_iterator i = m_urls.constFind(url);
+    if (i != m_urls.constEnd()) {
+        int index = entryPosition(m_orderedEntries, url, i.value());
+        BookmarkEntry& updatedEntry = m_orderedEntries[index];
+        QString previousFolder = updatedEntry.folder;
+        QVector<int> roles;
+        if (title != updatedEntry.title) {
+            updatedEntry.title = title;
+            roles << Title;
+        }
+        if (folder != updatedEntry.folder) {
+            addFolder(folder);
+            updatedEntry.folder = folder;
+            roles << Folder;
+        }
+        if (!roles.isEmpty()) {
+            Q_EMIT dataChanged(this->index(index, 0), this->index(index, 0), roles);
+            if (roles.contains(Folder)) {
+                removeFromFolderIndex(previousFolder, url, updatedEntry.created);
+                insertInFolderIndex(updatedEntry,
+                                    folderInsertionPosition(folder, updatedEntry.created));
             } else {
-                index++;
+                updateInFolderIndex(updatedEntry, roles);
             }
-        };
+            updateExistingEntryInDatabase(updatedEntry);
+        }
     } else {
         qWarning() << "Invalid bookmark:" << url;
     }
@@ -365,51 +643,569 @@ void BookmarksModel::update(const QUrl& url, const QString& title, const QString
 
 void BookmarksModel::updateExistingEntryInDatabase(const BookmarkEntry& entry)
 {
-    QSqlQuery query(m_database);
-    static QString updateStatement = QLatin1String("UPDATE bookmarks SET title=?, "
-                                                   "icon=?, created=?, folderId=? "
-                                                   "WHERE url=?;");
-    query.prepare(updateStatement);
-    query.addBindValue(entry.title);
-    query.addBindValue(entry.icon.toString());
-    query.addBindValue(entry.created.toMSecsSinceEpoch());
-    if (entry.folderId == 0) {
-        query.addBindValue(QVariant());
-    } else {
-        query.addBindValue(entry.folderId);
+    QVariantList values;
+    values << entry.title << entry.icon.toString() << entry.created.toMSecsSinceEpoch()
+           << entry.folder << entry.url.toString();
+    Q_EMIT m_dbWorker->enqueue(BookmarksDbWorker::UpdateExistingEntry, values);
+}
+
+/*!
+    Look up the URLs of the bookmarks whose URL or title contain all the given
+    terms, most recent first.
+    The results are delivered by the urlsMatched() signal along with the
+    request identifier returned by this method.
+*/
+int BookmarksModel::matchUrls(const QStringList& terms, int limit)
+{
+    int requestId = ++m_lastMatchRequest;
+    Q_EMIT m_dbWorker->matchUrls(requestId, terms, limit);
+    return requestId;
+}
+
+/*!
+    Import the bookmarks stored in a file, in the Netscape bookmark file
+    format exported by most browsers, or in JSON if the name of the file ends
+    with '.json' (see exportBookmarks()).
+
+    The file is parsed on the database thread, the importProgress() signal
+    reporting the progress. Bookmarks already in the model are skipped, the
+    others are added to the model at once, with their folders, and written
+    to the database in a single transaction. The importFinished() signal is
+    emitted with the number of bookmarks added once done.
+*/
+void BookmarksModel::importBookmarks(const QString& fileName)
+{
+    Q_EMIT m_dbWorker->importBookmarks(fileName);
+}
+
+void BookmarksModel::onEntriesImported(bool success, const QVector<BookmarkEntry>& entries)
+{
+    if (!success) {
+        Q_EMIT importFinished(false, 0);
+        return;
+    }
+
+    QVector<BookmarkEntry> imported;
+    imported.reserve(entries.count());
+    QStringList folders;
+    Q_FOREACH(const BookmarkEntry& entry, entries) {
+        if (m_urls.contains(entry.url)) {
+            continue;
+        }
+        imported.append(entry);
+        if (!m_folders.contains(entry.folder)) {
+            m_folders.insert(entry.folder);
+            folders.append(entry.folder);
+        }
+    }
+
+    if (!imported.isEmpty()) {
+        beginResetModel();
+        Q_FOREACH(const BookmarkEntry& entry, imported) {
+            m_urls.insert(entry.url, entry.created);
+            m_orderedEntries.append(entry);
+        }
+        std::stable_sort(m_orderedEntries.begin(), m_orderedEntries.end(),
+                         [] (const BookmarkEntry& a, const BookmarkEntry& b) {
+                             return a.created > b.created;
+                         });
+        rebuildFolderIndex();
+        endResetModel();
+        Q_EMIT rowCountChanged();
+        Q_EMIT m_dbWorker->insertEntries(imported);
+    }
+    if (!folders.isEmpty()) {
+        Q_EMIT foldersAdded(folders);
+    }
+    Q_EMIT importFinished(true, imported.count());
+}
+
+/*!
+    Export all bookmarks to a file, in the Netscape bookmark file format or
+    in JSON if the name of the file ends with '.json'.
+
+    The file is written on the database thread, the exportFinished() signal
+    is emitted with the number of bookmarks written once done.
+*/
+void BookmarksModel::exportBookmarks(const QString& fileName)
+{
+    Q_EMIT m_dbWorker->exportBookmarks(fileName);
+}
+
+BookmarksDbWorker::BookmarksDbWorker()
+    : QObject()
+    , m_lastFolderOperation(-1)
+    , m_flush(nullptr)
+{
+    // Ensure all database operations are performed on the same thread
+    connect(this, SIGNAL(resetDatabase(const QString&)),
+            SLOT(doResetDatabase(const QString&)), Qt::QueuedConnection);
+    connect(this, SIGNAL(fetchEntries(int)), SLOT(doFetchEntries(int)), Qt::QueuedConnection);
+    connect(this, SIGNAL(matchUrls(int, const QStringList&, int)),
+            SLOT(doMatchUrls(int, const QStringList&, int)), Qt::QueuedConnection);
+    qRegisterMetaType<BookmarksDbWorker::Operation>("BookmarksDbWorker::Operation");
+    qRegisterMetaType<QList<QUrl>>("QList<QUrl>");
+    qRegisterMetaType<QVector<BookmarksModel::BookmarkEntry>>("QVector<BookmarksModel::BookmarkEntry>");
+    connect(this, SIGNAL(enqueue(BookmarksDbWorker::Operation, QVariantList)),
+            SLOT(doEnqueue(BookmarksDbWorker::Operation, QVariantList)), Qt::QueuedConnection);
+    connect(this, SIGNAL(importBookmarks(const QString&)),
+            SLOT(doImportBookmarks(const QString&)), Qt::QueuedConnection);
+    connect(this, SIGNAL(insertEntries(const QVector<BookmarksModel::BookmarkEntry>&)),
+            SLOT(doInsertEntries(const QVector<BookmarksModel::BookmarkEntry>&)),
+            Qt::QueuedConnection);
+    connect(this, SIGNAL(exportBookmarks(const QString&)),
+            SLOT(doExportBookmarks(const QString&)), Qt::QueuedConnection);
+}
+
+BookmarksDbWorker::~BookmarksDbWorker()
+{
+    if (m_flush) {
+        m_flush->stop();
+        delete m_flush;
+        m_flush = nullptr;
+    }
+    doFlush();
+    m_preparedQueries.clear();
+    if (m_database.isOpen()) {
+        m_database.close();
     }
-    query.addBindValue(entry.url.toString());
-    query.exec();
+    m_database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(CONNECTION_NAME);
+}
+
+void BookmarksDbWorker::doResetDatabase(const QString& databaseName)
+{
+    if (m_flush) {
+        m_flush->stop();
+    }
+    doFlush();
+    m_preparedQueries.clear();
+    if (m_database.isOpen()) {
+        m_database.close();
+    }
+    if (!m_database.isValid()) {
+        m_database = QSqlDatabase::addDatabase(SQL_DRIVER, CONNECTION_NAME);
+    }
+    m_database.setDatabaseName(databaseName);
+    m_database.open();
+    createOrAlterDatabaseSchema();
 }
 
-int BookmarksModel::getFolderId(const QString& folder) {
-    QHashIterator<int, QString> i(m_folders);
-    while (i.hasNext()) {
-        i.next();
-        if (i.value() == folder) {
-            return i.key();
+void BookmarksDbWorker::createOrAlterDatabaseSchema()
+{
+    QSqlQuery createQuery(m_database);
+    QString query = QLatin1String("CREATE TABLE IF NOT EXISTS bookmarks "
+                                  "(url VARCHAR, title VARCHAR, icon VARCHAR, "
+                                  "created INTEGER, folderId INTEGER);");
+    createQuery.prepare(query);
+    createQuery.exec();
+
+    QSqlQuery createFolderQuery(m_database);
+    query = QLatin1String("CREATE TABLE IF NOT EXISTS folders "
+                          "(folderId INTEGER PRIMARY KEY, folder VARCHAR);");
+    createFolderQuery.prepare(query);
+    createFolderQuery.exec();
+
+    // Older version of the database schema didn’t have 'created' and/or
+    // 'folderId' columns
+    QSqlQuery tableInfoQuery(m_database);
+    query = QLatin1String("PRAGMA TABLE_INFO(bookmarks);");
+    tableInfoQuery.prepare(query);
+    tableInfoQuery.exec();
+
+    bool missingCreatedColumn = true;
+    bool missingFolderIdColumn = true;
+
+    while (tableInfoQuery.next()) {
+        if (tableInfoQuery.value("name").toString() == "created") {
+            missingCreatedColumn = false;
+        }
+        if (tableInfoQuery.value("name").toString() == "folderId") {
+            missingFolderIdColumn = false;
+        }
+        if (!missingCreatedColumn && !missingFolderIdColumn) {
+            break;
         }
     }
+    if (missingCreatedColumn) {
+        QSqlQuery addCreatedColumnQuery(m_database);
+        query = QLatin1String("ALTER TABLE bookmarks ADD COLUMN created INTEGER;");
+        addCreatedColumnQuery.prepare(query);
+        addCreatedColumnQuery.exec();
+        // the default for the column is an empty value, which is interpreted as zero
+        // when converted to a number. Zero represents a date far in the past, so
+        // any newly created bookmark will correctly be represented as more recent than any other
+    }
+    if (missingFolderIdColumn) {
+        QSqlQuery addFolderColumnQuery(m_database);
+        query = QLatin1String("ALTER TABLE bookmarks ADD COLUMN folderId INTEGER;");
+        addFolderColumnQuery.prepare(query);
+        addFolderColumnQuery.exec();
+    }
 
-    return addFolder(folder);
+    // Bookmarks are looked up by URL on every write. Older databases may
+    // contain duplicate URLs, only the most recently created one is kept.
+    QSqlQuery createIndexQuery(m_database);
+    query = QLatin1String("CREATE UNIQUE INDEX IF NOT EXISTS bookmarks_url ON bookmarks (url);");
+    if (!createIndexQuery.exec(query)) {
+        QSqlQuery removeDuplicatesQuery(m_database);
+        removeDuplicatesQuery.exec(QLatin1String("DELETE FROM bookmarks WHERE rowid NOT IN "
+                                                 "(SELECT rowid FROM (SELECT rowid, MAX(created) "
+                                                 "FROM bookmarks GROUP BY url));"));
+        createIndexQuery.exec(query);
+    }
+
+    // Drop the full-text index that used to be maintained on every write
+    // while nothing queried it.
+    QStringList dropFullTextIndex;
+    dropFullTextIndex << QLatin1String("DROP TRIGGER IF EXISTS bookmarks_fts_insert;")
+                      << QLatin1String("DROP TRIGGER IF EXISTS bookmarks_fts_delete;")
+                      << QLatin1String("DROP TRIGGER IF EXISTS bookmarks_fts_update;")
+                      << QLatin1String("DROP TABLE IF EXISTS bookmarks_fts;");
+    Q_FOREACH(const QString& statement, dropFullTextIndex) {
+        QSqlQuery dropQuery(m_database);
+        dropQuery.exec(statement);
+    }
 }
 
-int BookmarksModel::insertNewFolderInDatabase(const QString& folder)
+/*
+    Bookmarks that belong to a folder that doesn’t exist (anymore) are moved
+    to the default folder, with a single statement. Entries are fetched with
+    the name of their folder, in chunks of FETCH_CHUNK_SIZE, most recent first.
+*/
+void BookmarksDbWorker::doFetchEntries(int generation)
 {
-    QSqlQuery insertQuery(m_database);
-    QString query = QLatin1String("INSERT INTO folders (folder) VALUES (?);");
-    insertQuery.prepare(query);
-    insertQuery.addBindValue(folder);
-    insertQuery.exec();
+    QSqlQuery fixFoldersQuery(m_database);
+    fixFoldersQuery.exec(QStringLiteral("UPDATE bookmarks SET folderId=NULL "
+                                        "WHERE folderId NOT IN (SELECT folderId FROM folders);"));
+
+    QSqlQuery populateFolderQuery(m_database);
+    QString query = QStringLiteral("SELECT folder FROM folders;");
+    populateFolderQuery.prepare(query);
+    populateFolderQuery.exec();
+    QStringList folders;
+    while (populateFolderQuery.next()) {
+        folders.append(populateFolderQuery.value(0).toString());
+    }
+    Q_EMIT foldersFetched(generation, folders);
+
+    QSqlQuery populateQuery(m_database);
+    query = QStringLiteral("SELECT bookmarks.url, bookmarks.title, bookmarks.icon, "
+                           "bookmarks.created, folders.folder FROM bookmarks "
+                           "LEFT JOIN folders ON bookmarks.folderId = folders.folderId "
+                           "ORDER BY bookmarks.created DESC;");
+    populateQuery.prepare(query);
+    populateQuery.exec();
+    QVector<BookmarksModel::BookmarkEntry> entries;
+    entries.reserve(FETCH_CHUNK_SIZE);
+    while (populateQuery.next()) {
+        BookmarksModel::BookmarkEntry entry;
+        entry.url = populateQuery.value(0).toUrl();
+        entry.title = populateQuery.value(1).toString();
+        entry.icon = populateQuery.value(2).toUrl();
+        entry.created = QDateTime::fromMSecsSinceEpoch(populateQuery.value(3).toULongLong());
+        entry.folder = populateQuery.value(4).toString();
+        entries.append(entry);
+        if (entries.count() == FETCH_CHUNK_SIZE) {
+            Q_EMIT entriesFetched(generation, entries);
+            entries.clear();
+            entries.reserve(FETCH_CHUNK_SIZE);
+        }
+    }
+    Q_EMIT entriesFetched(generation, entries);
+    Q_EMIT loaded(generation);
+}
+
+/*
+    Pending operations are flushed first so that the results reflect the
+    state of the model.
+*/
+void BookmarksDbWorker::doMatchUrls(int requestId, const QStringList& terms, int limit)
+{
+    doFlush();
+    QList<QUrl> urls = FullTextSearch::matchUrls(m_database, QLatin1String("bookmarks"),
+                                                 terms, limit,
+                                                 QLatin1String("created DESC"));
+    Q_EMIT urlsMatched(requestId, urls);
+}
 
-    QSqlQuery selectQuery(m_database);
-    query = QLatin1String("SELECT folderId FROM folders WHERE folder=?;");
-    selectQuery.prepare(query);
-    selectQuery.addBindValue(folder);
-    selectQuery.exec();
-    if (selectQuery.next()) {
-        return selectQuery.value(0).toInt();
+/*
+    The pending queue is a write-behind buffer keyed by URL: an update is
+    folded into a pending insertion or update of the same bookmark, and an
+    insertion followed by a removal cancels out (toggling a bookmark back and
+    forth doesn’t hit the disk). Cancelled operations stay in the queue with
+    no values (and are skipped when flushing) so that the positions recorded
+    in the keys remain valid.
+    An update is folded in place only if no folder was added or removed
+    since the pending operation was queued, as its statement may refer to
+    that folder. Otherwise the pending operation is cancelled and the merged
+    one goes to the tail of the queue.
+*/
+void BookmarksDbWorker::doEnqueue(BookmarksDbWorker::Operation operation, QVariantList values)
+{
+    if (!m_flush) {
+        m_flush = new QTimer;
+        m_flush->setInterval(1000);
+        m_flush->setSingleShot(true);
+        connect(m_flush, SIGNAL(timeout()), SLOT(doFlush()));
+    }
+    m_flush->start();
+    switch (operation) {
+    case InsertNewEntry:
+        m_pendingEntries.insert(values.first().toString(), m_pending.count());
+        break;
+    case UpdateExistingEntry: {
+        QString url = values.last().toString();
+        QHash<QString, int>::iterator i = m_pendingEntries.find(url);
+        if (i != m_pendingEntries.end()) {
+            QPair<Operation, QVariantList>& pending = m_pending[i.value()];
+            if (pending.first == InsertNewEntry) {
+                // Same values, except for the URL that comes first
+                values.prepend(values.takeLast());
+                operation = InsertNewEntry;
+            }
+            if (i.value() > m_lastFolderOperation) {
+                pending.second = values;
+                return;
+            }
+            pending.second.clear();
+            i.value() = m_pending.count();
+            break;
+        }
+        m_pendingEntries.insert(url, m_pending.count());
+        break;
+    }
+    case RemoveExistingEntry: {
+        QHash<QString, int>::iterator i = m_pendingEntries.find(values.first().toString());
+        if (i != m_pendingEntries.end()) {
+            int index = i.value();
+            m_pendingEntries.erase(i);
+            m_pending[index].second.clear();
+            if (m_pending.at(index).first == InsertNewEntry) {
+                // The entry never made it to the disk
+                return;
+            }
+        }
+        break;
     }
+    case InsertNewFolder:
+    case RemoveFolder:
+        m_lastFolderOperation = m_pending.count();
+        break;
+    default:
+        break;
+    }
+    m_pending.enqueue(qMakePair(operation, values));
+}
 
-    return 0;
+/*
+    All pending operations are executed in a single transaction, so that a
+    burst of changes costs one journal sync instead of one per statement.
+    Folders are referenced by name, their identifiers are looked up by the
+    statements themselves.
+*/
+void BookmarksDbWorker::doFlush()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    bool transaction = m_database.transaction();
+    while (!m_pending.isEmpty()) {
+        QPair<Operation, QVariantList> args = m_pending.dequeue();
+        if (args.second.isEmpty()) {
+            // cancelled by a subsequent operation
+            continue;
+        }
+        QString statement;
+        switch (args.first) {
+        case InsertNewFolder:
+            statement = QStringLiteral("INSERT INTO folders (folder) "
+                                       "SELECT ? EXCEPT SELECT folder FROM folders;");
+            break;
+        case InsertNewEntry:
+            // A bookmark added while the model was loading may already be
+            // on disk
+            statement = QStringLiteral("INSERT OR REPLACE INTO bookmarks (url, title, icon, created, folderId) "
+                                       "VALUES (?, ?, ?, ?, (SELECT folderId FROM folders "
+                                       "WHERE folder=?));");
+            break;
+        case UpdateExistingEntry:
+            statement = QStringLiteral("UPDATE bookmarks SET title=?, icon=?, created=?, "
+                                       "folderId=(SELECT folderId FROM folders WHERE folder=?) "
+                                       "WHERE url=?;");
+            break;
+        case RemoveExistingEntry:
+            statement = QStringLiteral("DELETE FROM bookmarks WHERE url=?;");
+            break;
+        case RemoveFolder: {
+            QSqlQuery* remove = preparedQuery(QStringLiteral("DELETE FROM bookmarks WHERE folderId IN "
+                                                             "(SELECT folderId FROM folders WHERE folder=?);"));
+            if (remove) {
+                remove->bindValue(0, args.second.first());
+                remove->exec();
+            }
+            statement = QStringLiteral("DELETE FROM folders WHERE folder=?;");
+            break;
+        }
+        default:
+            Q_UNREACHABLE();
+        }
+        QSqlQuery* query = preparedQuery(statement);
+        if (!query) {
+            continue;
+        }
+        for (int i = 0; i < args.second.count(); ++i) {
+            query->bindValue(i, args.second.at(i));
+        }
+        query->exec();
+    }
+    m_pendingEntries.clear();
+    m_lastFolderOperation = -1;
+    if (transaction) {
+        m_database.commit();
+    }
+}
+
+/*
+    Bookmarks are de-duplicated by URL, the first occurrence in the file
+    wins. Those without a creation date are considered created now.
+*/
+void BookmarksDbWorker::doImportBookmarks(const QString& fileName)
+{
+    QVector<BookmarksModel::BookmarkEntry> entries;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open bookmarks file:" << fileName;
+        Q_EMIT entriesImported(false, entries);
+        return;
+    }
+
+    QSet<QUrl> urls;
+    QDateTime now = QDateTime::currentDateTime();
+    int lastProgress = -1;
+    bool success = BookmarksImportExport::read(
+        &file, BookmarksImportExport::formatForFileName(fileName),
+        [&] (const BookmarksModel::BookmarkEntry& entry) {
+            if (!urls.contains(entry.url)) {
+                urls.insert(entry.url);
+                entries.append(entry);
+                if (!entry.created.isValid()) {
+                    entries.last().created = now;
+                }
+            }
+        },
+        [&] (qreal progress) {
+            // Notify whole percents only
+            int percent = qRound(progress * 100);
+            if (percent != lastProgress) {
+                lastProgress = percent;
+                Q_EMIT importProgress(progress);
+            }
+        });
+    if (!success) {
+        qWarning() << "Invalid bookmarks file:" << fileName;
+        entries.clear();
+    }
+    Q_EMIT entriesImported(success, entries);
+}
+
+/*
+    Imported entries (and their folders) are written in a single transaction,
+    after the pending operations.
+*/
+void BookmarksDbWorker::doInsertEntries(const QVector<BookmarksModel::BookmarkEntry>& entries)
+{
+    if (m_flush) {
+        m_flush->stop();
+    }
+    doFlush();
+
+    QSet<QString> folders;
+    Q_FOREACH(const BookmarksModel::BookmarkEntry& entry, entries) {
+        if (!entry.folder.isEmpty()) {
+            folders.insert(entry.folder);
+        }
+    }
+
+    bool transaction = m_database.transaction();
+    QSqlQuery* insertFolder = preparedQuery(QStringLiteral("INSERT INTO folders (folder) "
+                                                           "SELECT ? EXCEPT SELECT folder FROM folders;"));
+    if (insertFolder) {
+        Q_FOREACH(const QString& folder, folders) {
+            insertFolder->bindValue(0, folder);
+            insertFolder->exec();
+        }
+    }
+    // A bookmark imported while the model was loading may already be on disk
+    QSqlQuery* insert = preparedQuery(QStringLiteral("INSERT OR REPLACE INTO bookmarks "
+                                                     "(url, title, icon, created, folderId) "
+                                                     "VALUES (?, ?, ?, ?, (SELECT folderId FROM folders "
+                                                     "WHERE folder=?));"));
+    if (insert) {
+        Q_FOREACH(const BookmarksModel::BookmarkEntry& entry, entries) {
+            insert->bindValue(0, entry.url.toString());
+            insert->bindValue(1, entry.title);
+            insert->bindValue(2, entry.icon.toString());
+            insert->bindValue(3, entry.created.toMSecsSinceEpoch());
+            insert->bindValue(4, entry.folder);
+            insert->exec();
+        }
+    }
+    if (transaction) {
+        m_database.commit();
+    }
+}
+
+/*
+    Entries are read from the database and written to the file as they come,
+    grouped by folder, entries of the default folder first.
+*/
+void BookmarksDbWorker::doExportBookmarks(const QString& fileName)
+{
+    if (m_flush) {
+        m_flush->stop();
+    }
+    doFlush();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open bookmarks file:" << fileName;
+        Q_EMIT exportFinished(false, 0);
+        return;
+    }
+
+    BookmarksImportExport::Writer writer(&file, BookmarksImportExport::formatForFileName(fileName));
+    QSqlQuery exportQuery(m_database);
+    exportQuery.setForwardOnly(true);
+    exportQuery.prepare(QStringLiteral("SELECT bookmarks.url, bookmarks.title, bookmarks.icon, "
+                                       "bookmarks.created, folders.folder FROM bookmarks "
+                                       "LEFT JOIN folders ON bookmarks.folderId = folders.folderId "
+                                       "ORDER BY folders.folder IS NOT NULL, folders.folder, "
+                                       "bookmarks.created DESC;"));
+    exportQuery.exec();
+    while (exportQuery.next()) {
+        BookmarksModel::BookmarkEntry entry;
+        entry.url = exportQuery.value(0).toUrl();
+        entry.title = exportQuery.value(1).toString();
+        entry.icon = exportQuery.value(2).toUrl();
+        entry.created = QDateTime::fromMSecsSinceEpoch(exportQuery.value(3).toULongLong());
+        entry.folder = exportQuery.value(4).toString();
+        writer.writeEntry(entry);
+    }
+    bool success = writer.finish();
+    file.close();
+    Q_EMIT exportFinished(success, writer.count());
+}
+
+QSqlQuery* BookmarksDbWorker::preparedQuery(const QString& statement)
+{
+    QHash<QString, QSqlQuery>::iterator i = m_preparedQueries.find(statement);
+    if (i == m_preparedQueries.end()) {
+        QSqlQuery query(m_database);
+        if (!query.prepare(statement)) {
+            return nullptr;
+        }
+        i = m_preparedQueries.insert(statement, query);
+    }
+    return &i.value();
 }
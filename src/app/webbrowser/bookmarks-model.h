@@ -22,11 +22,24 @@
 // Qt
 #include <QtCore/QAbstractListModel>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
 #include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QQueue>
 #include <QtCore/QSet>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
 #include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+class QTimer;
+
+class BookmarksDbWorker;
+class BookmarksFolderModel;
 
 class BookmarksModel : public QAbstractListModel
 {
@@ -58,43 +71,142 @@ public:
     void setDatabasePath(const QString& path);
 
     QStringList folders() const;
-    int addFolder(const QString& folder);
+    void addFolder(const QString& folder);
+    Q_INVOKABLE void removeFolder(const QString& folder);
+    int folderEntryCount(const QString& folder) const;
+    QVariant folderEntryData(const QString& folder, int index, int role) const;
 
     Q_INVOKABLE bool contains(const QUrl& url) const;
     Q_INVOKABLE void add(const QUrl& url, const QString& title, const QUrl& icon, const QString& folder);
     Q_INVOKABLE void remove(const QUrl& url);
     Q_INVOKABLE void update(const QUrl& url, const QString& title, const QString& folder);
+    Q_INVOKABLE int matchUrls(const QStringList& terms, int limit);
+    Q_INVOKABLE void importBookmarks(const QString& fileName);
+    Q_INVOKABLE void exportBookmarks(const QString& fileName);
+
+    struct BookmarkEntry {
+        QUrl url;
+        QString title;
+        QUrl icon;
+        QDateTime created;
+        QString folder;
+    };
 
 Q_SIGNALS:
     void databasePathChanged() const;
     void folderAdded(const QString& folder) const;
+    void foldersAdded(const QStringList& folders) const;
+    void folderRemoved(const QString& folder) const;
     void added(const QUrl& url) const;
     void removed(const QUrl& url) const;
     void rowCountChanged();
+    void urlsMatched(int requestId, const QList<QUrl>& urls) const;
+    void loaded() const;
+    void importProgress(qreal progress) const;
+    void importFinished(bool success, int count) const;
+    void exportFinished(bool success, int count) const;
+
+private Q_SLOTS:
+    void onFoldersFetched(int generation, const QStringList& folders);
+    void onEntriesFetched(int generation, const QVector<BookmarksModel::BookmarkEntry>& entries);
+    void onLoaded(int generation);
+    void onEntriesImported(bool success, const QVector<BookmarksModel::BookmarkEntry>& entries);
 
 private:
-    QSqlDatabase m_database;
+    friend class BookmarksFolderModel;
 
-    struct BookmarkEntry {
-        QUrl url;
-        QString title;
-        QUrl icon;
-        QDateTime created;
-        int folderId;
-        QString folder;
-    };
-    QHash<int, QString> m_folders;
-    QSet<QUrl> m_urls;
+    QString m_databasePath;
+    int m_lastMatchRequest;
+    int m_fetchGeneration;
+
+    QSet<QString> m_folders;
+    QHash<QUrl, QDateTime> m_urls; // creation date of each entry, to look it up
     QList<BookmarkEntry> m_orderedEntries;
+    QStringList m_fetchedFolders;
+    QVector<BookmarkEntry> m_fetchedEntries;
+
+    // Entries grouped by folder, in the same order as m_orderedEntries, and
+    // the views registered for each folder
+    QHash<QString, QList<BookmarkEntry>> m_folderIndex;
+    QMultiHash<QString, BookmarksFolderModel*> m_folderModels;
+
+    static QVariant entryData(const BookmarkEntry& entry, int role);
+    static int entryPosition(const QList<BookmarkEntry>& entries,
+                             const QUrl& url, const QDateTime& created);
+    int folderEntryPosition(const QString& folder, const QUrl& url, const QDateTime& created) const;
+    int folderInsertionPosition(const QString& folder, const QDateTime& created) const;
+    void insertInFolderIndex(const BookmarkEntry& entry, int position);
+    void removeFromFolderIndex(const QString& folder, const QUrl& url, const QDateTime& created);
+    void updateInFolderIndex(const BookmarkEntry& entry, const QVector<int>& roles);
+    void rebuildFolderIndex();
+    void registerFolderModel(BookmarksFolderModel* model);
+    void unregisterFolderModel(BookmarksFolderModel* model);
 
     void resetDatabase(const QString& databaseName);
-    void createOrAlterDatabaseSchema();
-    void populateFromDatabase();
     void insertNewEntryInDatabase(const BookmarkEntry& entry);
     void removeExistingEntryFromDatabase(const QUrl& url);
     void updateExistingEntryInDatabase(const BookmarkEntry& entry);
-    int getFolderId(const QString& folder);
-    int insertNewFolderInDatabase(const QString& folder);
+
+    QThread m_dbWorkerThread;
+    BookmarksDbWorker* m_dbWorker;
+};
+
+class BookmarksDbWorker : public QObject {
+    Q_OBJECT
+
+    Q_ENUMS(Operation)
+
+public:
+    BookmarksDbWorker();
+    ~BookmarksDbWorker();
+
+    enum Operation {
+        InsertNewFolder,
+        InsertNewEntry,
+        UpdateExistingEntry,
+        RemoveExistingEntry,
+        RemoveFolder,
+    };
+
+Q_SIGNALS:
+    void resetDatabase(const QString& databaseName);
+    void fetchEntries(int generation);
+    void matchUrls(int requestId, const QStringList& terms, int limit);
+    void foldersFetched(int generation, const QStringList& folders);
+    void entriesFetched(int generation, const QVector<BookmarksModel::BookmarkEntry>& entries);
+    void urlsMatched(int requestId, const QList<QUrl>& urls);
+    void loaded(int generation);
+    void enqueue(BookmarksDbWorker::Operation operation, QVariantList values);
+    void importBookmarks(const QString& fileName);
+    void insertEntries(const QVector<BookmarksModel::BookmarkEntry>& entries);
+    void exportBookmarks(const QString& fileName);
+    void importProgress(qreal progress);
+    void entriesImported(bool success, const QVector<BookmarksModel::BookmarkEntry>& entries);
+    void exportFinished(bool success, int count);
+
+private Q_SLOTS:
+    void doResetDatabase(const QString& databaseName);
+    void doFetchEntries(int generation);
+    void doMatchUrls(int requestId, const QStringList& terms, int limit);
+    void doEnqueue(BookmarksDbWorker::Operation operation, QVariantList values);
+    void doFlush();
+    void doImportBookmarks(const QString& fileName);
+    void doInsertEntries(const QVector<BookmarksModel::BookmarkEntry>& entries);
+    void doExportBookmarks(const QString& fileName);
+
+private:
+    QSqlQuery* preparedQuery(const QString& statement);
+    void createOrAlterDatabaseSchema();
+
+    QSqlDatabase m_database;
+    QHash<QString, QSqlQuery> m_preparedQueries;
+    QQueue<QPair<Operation, QVariantList>> m_pending;
+    QHash<QString, int> m_pendingEntries;
+    int m_lastFolderOperation;
+    QTimer* m_flush;
 };
 
+Q_DECLARE_TYPEINFO(BookmarksModel::BookmarkEntry, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(QVector<BookmarksModel::BookmarkEntry>)
+
 #endif // __BOOKMARKS_MODEL_H__
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "folded-text-search.h"
+
+// Qt
+#include <QtCore/QtAlgorithms>
+
+// system
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace FoldedTextSearch {
+
+/*
+    Candidate positions are found by comparing the first and last characters
+    of the needle against 8 positions of the haystack at once, and only those
+    are compared in full.
+*/
+int indexOf(const QString& haystack, const QString& needle, int from)
+{
+    const int m = needle.size();
+    const int n = haystack.size();
+    if (from < 0) {
+        from = 0;
+    }
+    if (m == 0) {
+        return (from <= n) ? from : -1;
+    }
+    if (m > n - from) {
+        return -1;
+    }
+
+    const ushort* h = haystack.utf16();
+    const ushort* p = needle.utf16();
+    const size_t size = m * sizeof(ushort);
+    int i = from;
+
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi16(p[0]);
+    const __m128i last = _mm_set1_epi16(p[m - 1]);
+    for (; i + 8 + m - 1 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + m - 1));
+        // two bits per matching position
+        uint mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first),
+                                                    _mm_cmpeq_epi16(b, last)));
+        while (mask != 0) {
+            uint bit = qCountTrailingZeroBits(mask);
+            if (memcmp(h + i + bit / 2, p, size) == 0) {
+                return i + bit / 2;
+            }
+            mask &= ~(3u << bit);
+        }
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint16x8_t first = vdupq_n_u16(p[0]);
+    const uint16x8_t last = vdupq_n_u16(p[m - 1]);
+    for (; i + 8 + m - 1 <= n; i += 8) {
+        uint16x8_t a = vld1q_u16(h + i);
+        uint16x8_t b = vld1q_u16(h + i + m - 1);
+        // one byte per matching position
+        uint8x8_t matches = vmovn_u16(vandq_u16(vceqq_u16(a, first), vceqq_u16(b, last)));
+        quint64 mask = vget_lane_u64(vreinterpret_u64_u8(matches), 0);
+        while (mask != 0) {
+            uint bit = qCountTrailingZeroBits(mask);
+            if (memcmp(h + i + bit / 8, p, size) == 0) {
+                return i + bit / 8;
+            }
+            mask &= ~(Q_UINT64_C(0xff) << bit);
+        }
+    }
+#endif
+
+    for (; i + m <= n; ++i) {
+        if ((h[i] == p[0]) && (h[i + m - 1] == p[m - 1]) && (memcmp(h + i, p, size) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool contains(const QString& haystack, const QString& needle)
+{
+    return (indexOf(haystack, needle) != -1);
+}
+
+bool isRefinement(const QVector<QString>& terms, const QVector<QString>& newTerms)
+{
+    if (newTerms.isEmpty()) {
+        return terms.isEmpty();
+    }
+    Q_FOREACH(const QString& term, terms) {
+        bool refined = false;
+        Q_FOREACH(const QString& newTerm, newTerms) {
+            if (contains(newTerm, term)) {
+                refined = true;
+                break;
+            }
+        }
+        if (!refined) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace FoldedTextSearch
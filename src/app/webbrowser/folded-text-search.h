@@ -0,0 +1,43 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FOLDED_TEXT_SEARCH_H__
+#define __FOLDED_TEXT_SEARCH_H__
+
+// Qt
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace FoldedTextSearch {
+
+// Position of the first occurrence of needle in haystack at or after from,
+// both being already case-folded, or -1 if there is none.
+int indexOf(const QString& haystack, const QString& needle, int from=0);
+
+// Whether haystack contains needle, both being already case-folded.
+bool contains(const QString& haystack, const QString& needle);
+
+// Whether the new case-folded terms refine the current ones, i.e. each
+// current term is contained in one of the new terms: text that matches all
+// the new terms then also matches the current ones, so text rejected by the
+// current terms will also be rejected by the new ones.
+bool isRefinement(const QVector<QString>& terms, const QVector<QString>& newTerms);
+
+} // namespace FoldedTextSearch
+
+#endif // __FOLDED_TEXT_SEARCH_H__
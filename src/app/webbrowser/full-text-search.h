@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FULL_TEXT_SEARCH_H__
+#define __FULL_TEXT_SEARCH_H__
+
+// Qt
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+namespace FullTextSearch {
+
+// Build a LIKE pattern that matches a term anywhere in a value,
+// to be used with ESCAPE '\'.
+static QString likePattern(const QString& term)
+{
+    QString pattern = term;
+    pattern.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+    pattern.replace(QLatin1Char('%'), QStringLiteral("\\%"));
+    pattern.replace(QLatin1Char('_'), QStringLiteral("\\_"));
+    return QStringLiteral("%%1%").arg(pattern);
+}
+
+// Look up the URLs of the rows of a table whose 'url' or 'title' columns
+// contain all the terms, ranked by the given ORDER BY clause.
+//
+// The tables are not indexed for this: an FTS5 index would have to be
+// maintained by triggers on every write, which is not worth it as long as
+// the suggestions are computed from the in-memory models.
+static QList<QUrl> matchUrls(QSqlDatabase& database, const QString& table,
+                             const QStringList& terms, int limit, const QString& order)
+{
+    QList<QUrl> urls;
+    QStringList patterns;
+    QStringList conditions;
+    Q_FOREACH(const QString& term, terms) {
+        if (!term.trimmed().isEmpty()) {
+            patterns.append(likePattern(term.trimmed()));
+            conditions.append(QStringLiteral("(url LIKE ? ESCAPE '\\' OR title LIKE ? ESCAPE '\\')"));
+        }
+    }
+    if (conditions.isEmpty()) {
+        return urls;
+    }
+
+    QSqlQuery query(database);
+    query.prepare(QStringLiteral("SELECT url FROM %1 WHERE %2 ORDER BY %3 LIMIT ?;")
+                      .arg(table, conditions.join(QStringLiteral(" AND ")), order));
+    Q_FOREACH(const QString& pattern, patterns) {
+        query.addBindValue(pattern);
+        query.addBindValue(pattern);
+    }
+    query.addBindValue(limit > 0 ? limit : -1);
+    if (query.exec()) {
+        while (query.next()) {
+            urls.append(query.value(0).toUrl());
+        }
+    }
+    return urls;
+}
+
+} // namespace FullTextSearch
+
+#endif // __FULL_TEXT_SEARCH_H__
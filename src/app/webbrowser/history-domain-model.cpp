@@ -19,41 +19,85 @@
 #include "history-domain-model.h"
 #include "history-model.h"
 
-// Qt
-#include <QtCore/QUrl>
-
 /*!
     \class HistoryDomainModel
-    \brief Proxy model that filters the contents of a history model
-           based on a domain name
+    \brief List model that exposes the entries of a history model
+           for a given domain name
 
-    HistoryDomainModel is a proxy model that filters the contents of a
-    history model based on a domain name.
+    HistoryDomainModel is a view on the entries of a history model that
+    match a domain name, sorted chronologically (most recent visit first),
+    with the same roles.
 
     An entry in the history model matches if the domain name extracted from
-    its URL equals the filter domain name (case-insensitive comparison).
+    its URL equals the filter domain name converted to lowercase. Domain names
+    are extracted from normalized (lowercase) hosts, so this amounts to a
+    case-insensitive comparison, but the domains of the entries themselves
+    are compared as is. Matching entries are looked up in the domain index of the history model,
+    which notifies the view of changes to those entries only.
 
     When no domain name is set (null or empty string), all entries match.
 */
 HistoryDomainModel::HistoryDomainModel(QObject* parent)
-    : QSortFilterProxyModel(parent)
+    : QAbstractListModel(parent)
 {
     connect(this, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)), SLOT(onModelChanged()));
     connect(this, SIGNAL(modelReset()), SLOT(onModelChanged()));
     connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(onModelChanged()));
     connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(onModelChanged()));
+    connect(this, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), SLOT(onModelChanged()));
     connect(this, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)), SLOT(onModelChanged()));
 }
 
+HistoryDomainModel::~HistoryDomainModel()
+{
+    detach();
+}
+
+QHash<int, QByteArray> HistoryDomainModel::roleNames() const
+{
+    if (m_sourceModel.isNull()) {
+        return QHash<int, QByteArray>();
+    }
+    return m_sourceModel->roleNames();
+}
+
+int HistoryDomainModel::rowCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    if (m_sourceModel.isNull()) {
+        return 0;
+    }
+    if (m_key.isEmpty()) {
+        return m_sourceModel->rowCount();
+    }
+    return m_sourceModel->domainEntryCount(m_key);
+}
+
+QVariant HistoryDomainModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || m_sourceModel.isNull()) {
+        return QVariant();
+    }
+    int row = index.row();
+    if (!m_key.isEmpty()) {
+        row = m_sourceModel->domainEntryRow(m_key, row);
+    }
+    return m_sourceModel->data(m_sourceModel->index(row, 0), role);
+}
+
 HistoryModel* HistoryDomainModel::sourceModel() const
 {
-    return qobject_cast<HistoryModel*>(QSortFilterProxyModel::sourceModel());
+    return m_sourceModel;
 }
 
 void HistoryDomainModel::setSourceModel(HistoryModel* sourceModel)
 {
-    if (sourceModel != this->sourceModel()) {
-        QSortFilterProxyModel::setSourceModel(sourceModel);
+    if (sourceModel != m_sourceModel) {
+        beginResetModel();
+        detach();
+        m_sourceModel = sourceModel;
+        attach();
+        endResetModel();
         Q_EMIT sourceModelChanged();
     }
 }
@@ -66,8 +110,12 @@ const QString& HistoryDomainModel::domain() const
 void HistoryDomainModel::setDomain(const QString& domain)
 {
     if (domain != m_domain) {
+        beginResetModel();
+        detach();
         m_domain = domain;
-        invalidate();
+        m_key = domain.toLower();
+        attach();
+        endResetModel();
         Q_EMIT domainChanged();
     }
 }
@@ -87,14 +135,95 @@ const QUrl& HistoryDomainModel::lastVisitedIcon() const
     return m_lastVisitedIcon;
 }
 
-bool HistoryDomainModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+/*
+    When filtering on a domain, the view is registered with the source model,
+    that notifies it of changes to its entries. Otherwise it mirrors all the
+    changes to the source model.
+*/
+void HistoryDomainModel::attach()
 {
-    if (m_domain.isEmpty()) {
-        return true;
+    if (m_sourceModel.isNull()) {
+        return;
     }
-    QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
-    QString domain = sourceModel()->data(index, HistoryModel::Domain).toString();
-    return (domain.compare(m_domain, Qt::CaseInsensitive) == 0);
+    if (!m_key.isEmpty()) {
+        m_sourceModel->registerDomainModel(this);
+        return;
+    }
+    connect(m_sourceModel, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+            SLOT(onSourceRowsAboutToBeInserted(QModelIndex, int, int)));
+    connect(m_sourceModel, SIGNAL(rowsInserted(QModelIndex, int, int)),
+            SLOT(onSourceRowsInserted()));
+    connect(m_sourceModel, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+            SLOT(onSourceRowsAboutToBeRemoved(QModelIndex, int, int)));
+    connect(m_sourceModel, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+            SLOT(onSourceRowsRemoved()));
+    connect(m_sourceModel, SIGNAL(rowsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)),
+            SLOT(onSourceRowsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)));
+    connect(m_sourceModel, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+            SLOT(onSourceRowsMoved()));
+    connect(m_sourceModel, SIGNAL(modelAboutToBeReset()), SLOT(onSourceModelAboutToBeReset()));
+    connect(m_sourceModel, SIGNAL(modelReset()), SLOT(onSourceModelReset()));
+    connect(m_sourceModel, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)),
+            SLOT(onSourceDataChanged(QModelIndex, QModelIndex, QVector<int>)));
+}
+
+void HistoryDomainModel::detach()
+{
+    if (!m_sourceModel.isNull()) {
+        m_sourceModel->disconnect(this);
+        m_sourceModel->unregisterDomainModel(this);
+    }
+}
+
+void HistoryDomainModel::onSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    beginInsertRows(QModelIndex(), first, last);
+}
+
+void HistoryDomainModel::onSourceRowsInserted()
+{
+    endInsertRows();
+}
+
+void HistoryDomainModel::onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    beginRemoveRows(QModelIndex(), first, last);
+}
+
+void HistoryDomainModel::onSourceRowsRemoved()
+{
+    endRemoveRows();
+}
+
+void HistoryDomainModel::onSourceRowsAboutToBeMoved(const QModelIndex& sourceParent, int sourceFirst, int sourceLast,
+                                                    const QModelIndex& destinationParent, int destinationRow)
+{
+    Q_UNUSED(sourceParent);
+    Q_UNUSED(destinationParent);
+    beginMoveRows(QModelIndex(), sourceFirst, sourceLast, QModelIndex(), destinationRow);
+}
+
+void HistoryDomainModel::onSourceRowsMoved()
+{
+    endMoveRows();
+}
+
+void HistoryDomainModel::onSourceModelAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void HistoryDomainModel::onSourceModelReset()
+{
+    endResetModel();
+}
+
+void HistoryDomainModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                             const QVector<int>& roles)
+{
+    Q_EMIT dataChanged(index(topLeft.row(), 0), index(bottomRight.row(), 0), roles);
 }
 
 void HistoryDomainModel::onModelChanged()
@@ -20,14 +20,15 @@
 #define __HISTORY_DOMAIN_MODEL_H__
 
 // Qt
+#include <QtCore/QAbstractListModel>
 #include <QtCore/QDateTime>
-#include <QtCore/QSortFilterProxyModel>
+#include <QtCore/QPointer>
 #include <QtCore/QString>
 #include <QtCore/QUrl>
 
 class HistoryModel;
 
-class HistoryDomainModel : public QSortFilterProxyModel
+class HistoryDomainModel : public QAbstractListModel
 {
     Q_OBJECT
 
@@ -39,6 +40,12 @@ class HistoryDomainModel : public QSortFilterProxyModel
 
 public:
     HistoryDomainModel(QObject* parent=0);
+    ~HistoryDomainModel();
+
+    // reimplemented from QAbstractListModel
+    QHash<int, QByteArray> roleNames() const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
 
     HistoryModel* sourceModel() const;
     void setSourceModel(HistoryModel* sourceModel);
@@ -57,18 +64,33 @@ Q_SIGNALS:
     void lastVisitedTitleChanged() const;
     void lastVisitedIconChanged() const;
 
-protected:
-    // reimplemented from QSortFilterProxyModel
-    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
-
 private:
+    friend class HistoryModel;
+
+    QPointer<HistoryModel> m_sourceModel;
     QString m_domain;
+    QString m_key;
     QDateTime m_lastVisit;
     QString m_lastVisitedTitle;
     QUrl m_lastVisitedIcon;
 
+    void attach();
+    void detach();
+
 private Q_SLOTS:
     void onModelChanged();
+
+    void onSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsInserted();
+    void onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved();
+    void onSourceRowsAboutToBeMoved(const QModelIndex& sourceParent, int sourceFirst, int sourceLast,
+                                    const QModelIndex& destinationParent, int destinationRow);
+    void onSourceRowsMoved();
+    void onSourceModelAboutToBeReset();
+    void onSourceModelReset();
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                             const QVector<int>& roles);
 };
 
 #endif // __HISTORY_DOMAIN_MODEL_H__
@@ -21,7 +21,12 @@
 #include "history-model.h"
 
 // Qt
+#include <QtCore/QPair>
 #include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+// system
+#include <algorithm>
 
 /*!
     \class HistoryDomainListModel
@@ -32,6 +37,12 @@
     three roles: 'domain' for the domain name, 'lastVisit' for the timestamp
     of the last page visited in this domain, and 'entries' for the corresponding
     HistoryDomainModel that contains all entries in this group.
+
+    Domains are sorted by their last visit (most recent first). The model is
+    updated incrementally: the HistoryDomainModel views are backed by the
+    domain index of the HistoryModel, so each of them is only notified of
+    changes to its own domain, and only the corresponding item is updated
+    (and moved if its last visit changed).
 */
 HistoryDomainListModel::HistoryDomainListModel(QObject* parent)
     : QAbstractListModel(parent)
@@ -61,7 +72,7 @@ QHash<int, QByteArray> HistoryDomainListModel::roleNames() const
 int HistoryDomainListModel::rowCount(const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
-    return m_domains.count();
+    return m_domainsPerLastVisit.count();
 }
 
 QVariant HistoryDomainListModel::data(const QModelIndex& index, int role) const
@@ -69,7 +80,7 @@ QVariant HistoryDomainListModel::data(const QModelIndex& index, int role) const
     if (!index.isValid()) {
         return QVariant();
     }
-    const QString domain = m_domainsPerLastVisit.at(index.row());
+    const QString& domain = m_domainsPerLastVisit.at(m_domainsPerLastVisit.count() - 1 - index.row());
     HistoryDomainModel* entries = m_domains.value(domain);
 
     switch (role) {
@@ -108,9 +119,8 @@ void HistoryDomainListModel::setSourceModel(HistoryModel* sourceModel)
         if (m_sourceModel != 0) {
             connect(m_sourceModel, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
                     SLOT(onRowsInserted(const QModelIndex&, int, int)));
+            connect(m_sourceModel, SIGNAL(modelAboutToBeReset()), SLOT(onModelAboutToBeReset()));
             connect(m_sourceModel, SIGNAL(modelReset()), SLOT(onModelReset()));
-            connect(m_sourceModel, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)),
-                    SLOT(onModelReset()));
         }
         endResetModel();
         Q_EMIT sourceModelChanged();
@@ -139,107 +149,180 @@ QVariantMap HistoryDomainListModel::get(int row) const
 
 void HistoryDomainListModel::clearDomains()
 {
-    Q_FOREACH(const QString& domain, m_domains.keys()) {
-        delete m_domains.take(domain);
-    }
+    qDeleteAll(m_domains);
+    m_domains.clear();
     m_domainsPerLastVisit.clear();
+    m_domainPositions.clear();
 }
 
+/*
+    Domains are sorted by the row of their most recent entry, which is looked
+    up in the domain index of the source model instead of going through all
+    its entries.
+*/
 void HistoryDomainListModel::populateModel()
 {
     if (m_sourceModel != 0) {
-        int count = m_sourceModel->rowCount();
-        for (int i = 0; i < count; ++i) {
-            QString domain = getDomainFromSourceModel(m_sourceModel->index(i, 0));
-            if (!m_domains.contains(domain)) {
-                insertNewDomain(domain);
-            }
+        QVector<QPair<int, QString>> domains;
+        Q_FOREACH(const QString& domain, m_sourceModel->domains()) {
+            domains.append(qMakePair(m_sourceModel->domainEntryRow(domain, 0), domain));
+        }
+        std::sort(domains.begin(), domains.end());
+        m_domainsPerLastVisit.reserve(domains.count());
+        for (int i = domains.count() - 1; i >= 0; --i) {
+            const QString& domain = domains.at(i).second;
+            m_domains.insert(domain, createDomainModel(domain));
+            m_domainsPerLastVisit.append(domain);
         }
+        indexPositions(0, m_domainsPerLastVisit.count() - 1);
     }
 }
 
+/*
+    Entries of known domains are handled by the corresponding domain models,
+    only new domains are inserted here.
+*/
 void HistoryDomainListModel::onRowsInserted(const QModelIndex& parent, int start, int end)
 {
     for (int i = start; i <= end; ++i) {
         QString domain = getDomainFromSourceModel(m_sourceModel->index(i, 0, parent));
         if (!m_domains.contains(domain)) {
-            QStringList domains = m_domainsPerLastVisit;
-            int insertAt = 0;
-            while (insertAt < domains.count()) {
-                if (domain.compare(domains.at(insertAt)) < 0) {
-                    break;
-                }
-                ++insertAt;
-            }
-            beginInsertRows(QModelIndex(), insertAt, insertAt);
             insertNewDomain(domain);
-            endInsertRows();
         }
     }
 }
 
-void HistoryDomainListModel::onModelReset()
+/*
+    The domain models are deleted before the source model resets them, so
+    that they don’t get removed one by one.
+*/
+void HistoryDomainListModel::onModelAboutToBeReset()
 {
     beginResetModel();
     clearDomains();
+}
+
+void HistoryDomainListModel::onModelReset()
+{
     populateModel();
     endResetModel();
 }
 
-void HistoryDomainListModel::insertNewDomain(const QString& domain)
+HistoryDomainModel* HistoryDomainListModel::createDomainModel(const QString& domain)
 {
     HistoryDomainModel* model = new HistoryDomainModel(this);
     model->setSourceModel(m_sourceModel);
     model->setDomain(domain);
-    connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(onDomainDataChanged()));
-    connect(model, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(onDomainRowsRemoved(QModelIndex, int, int)));
-    connect(model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), SLOT(onDomainDataChanged()));
-    connect(model, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)), SLOT(onDomainDataChanged()));
-    connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), SLOT(onDomainDataChanged()));
-    connect(model, SIGNAL(modelReset()), SLOT(onDomainDataChanged()));
-    connect(model, SIGNAL(lastVisitChanged()), SLOT(onDomainDataChanged()));
-    m_domains.insert(domain, model);
-    m_domainsPerLastVisit.append(domain);
+    connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(onDomainChanged()));
+    connect(model, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(onDomainChanged()));
+    connect(model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), SLOT(onDomainChanged()));
+    connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)), SLOT(onDomainChanged()));
+    connect(model, SIGNAL(modelReset()), SLOT(onDomainChanged()));
+    return model;
 }
 
-QString HistoryDomainListModel::getDomainFromSourceModel(const QModelIndex& index) const
+void HistoryDomainListModel::insertNewDomain(const QString& domain)
 {
-    return m_sourceModel->data(index, HistoryModel::Domain).toString();
+    int position = sortedPosition(domain);
+    int row = m_domainsPerLastVisit.count() - position;
+    beginInsertRows(QModelIndex(), row, row);
+    m_domains.insert(domain, createDomainModel(domain));
+    m_domainsPerLastVisit.insert(position, domain);
+    indexPositions(position, m_domainsPerLastVisit.count() - 1);
+    endInsertRows();
 }
 
-void HistoryDomainListModel::onDomainRowsRemoved(const QModelIndex& parent, int start, int end)
+/*
+    The entries of a domain changed: the corresponding item is removed if
+    there are none left, moved if its last visit changed, and updated.
+*/
+void HistoryDomainListModel::updateDomain(const QString& domain)
 {
-    Q_UNUSED(parent);
-    Q_UNUSED(start);
-    Q_UNUSED(end);
-    HistoryDomainModel* model = qobject_cast<HistoryDomainModel*>(sender());
-    if (model != 0) {
-        const QString& domain = model->domain();
-        if (model->rowCount() == 0) {
-            int removeAt = m_domainsPerLastVisit.indexOf(domain);
-            beginRemoveRows(QModelIndex(), removeAt, removeAt);
-            delete m_domains.take(domain);
-            m_domainsPerLastVisit.removeAt(removeAt);
-            endRemoveRows();
+    HistoryDomainModel* model = m_domains.value(domain);
+    if (model->rowCount() == 0) {
+        removeDomain(domain);
+        return;
+    }
+    int count = m_domainsPerLastVisit.count();
+    int from = m_domainPositions.value(domain);
+    int to = sortedPosition(domain, from);
+    if (to != from) {
+        int fromRow = count - 1 - from;
+        int toRow = count - 1 - to;
+        beginMoveRows(QModelIndex(), fromRow, fromRow, QModelIndex(), (toRow > fromRow) ? toRow + 1 : toRow);
+        m_domainsPerLastVisit.remove(from);
+        m_domainsPerLastVisit.insert(to, domain);
+        indexPositions(qMin(from, to), qMax(from, to));
+        endMoveRows();
+    }
+    emitDataChanged(count - 1 - to);
+}
+
+void HistoryDomainListModel::removeDomain(const QString& domain)
+{
+    int position = m_domainPositions.value(domain);
+    int row = m_domainsPerLastVisit.count() - 1 - position;
+    beginRemoveRows(QModelIndex(), row, row);
+    HistoryDomainModel* model = m_domains.take(domain);
+    // This may be called from a signal emitted by the domain model
+    model->disconnect(this);
+    model->deleteLater();
+    m_domainsPerLastVisit.remove(position);
+    m_domainPositions.remove(domain);
+    indexPositions(position, m_domainsPerLastVisit.count() - 1);
+    endRemoveRows();
+}
+
+/*
+    Binary search for the position of a domain in m_domainsPerLastVisit,
+    ignoring the current position of the domain (skip) if it is already
+    in there.
+*/
+int HistoryDomainListModel::sortedPosition(const QString& domain, int skip) const
+{
+    int row = m_sourceModel->domainEntryRow(domain, 0);
+    int first = 0;
+    int last = m_domainsPerLastVisit.count() - ((skip >= 0) ? 1 : 0);
+    while (first < last) {
+        int middle = (first + last) / 2;
+        int position = ((skip >= 0) && (middle >= skip)) ? middle + 1 : middle;
+        if (m_sourceModel->domainEntryRow(m_domainsPerLastVisit.at(position), 0) > row) {
+            first = middle + 1;
         } else {
-            emitDataChanged(domain);
+            last = middle;
         }
     }
+    return first;
 }
 
-void HistoryDomainListModel::onDomainDataChanged()
+/*
+    Domains are stored least recently visited first, so that the most common
+    changes (a domain is visited, or a new one is) only affect the end of
+    m_domainsPerLastVisit, and the few positions that need to be updated in
+    m_domainPositions (domain to position lookups are constant-time).
+*/
+void HistoryDomainListModel::indexPositions(int first, int last)
+{
+    for (int i = first; i <= last; ++i) {
+        m_domainPositions.insert(m_domainsPerLastVisit.at(i), i);
+    }
+}
+
+QString HistoryDomainListModel::getDomainFromSourceModel(const QModelIndex& index) const
+{
+    return m_sourceModel->data(index, HistoryModel::Domain).toString();
+}
+
+void HistoryDomainListModel::onDomainChanged()
 {
     HistoryDomainModel* model = qobject_cast<HistoryDomainModel*>(sender());
     if (model != 0) {
-        emitDataChanged(model->domain());
+        updateDomain(model->domain());
     }
 }
 
-void HistoryDomainListModel::emitDataChanged(const QString& domain)
+void HistoryDomainListModel::emitDataChanged(int row)
 {
-    int i = m_domainsPerLastVisit.indexOf(domain);
-    if (i != -1) {
-        QModelIndex index = this->index(i, 0);
-        Q_EMIT dataChanged(index, index, QVector<int>() << LastVisit << LastVisitDate << LastVisitedTitle << LastVisitedIcon << Entries);
-    }
+    QModelIndex index = this->index(row, 0);
+    Q_EMIT dataChanged(index, index, QVector<int>() << LastVisit << LastVisitDate << LastVisitedTitle << LastVisitedIcon << Entries);
 }
@@ -21,8 +21,9 @@
 
 // Qt
 #include <QtCore/QAbstractListModel>
-#include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QString>
+#include <QtCore/QVector>
 
 class HistoryDomainModel;
 class HistoryModel;
@@ -63,21 +64,27 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void onRowsInserted(const QModelIndex& parent, int start, int end);
+    void onModelAboutToBeReset();
     void onModelReset();
 
-    void onDomainRowsRemoved(const QModelIndex& parent, int start, int end);
-    void onDomainDataChanged();
+    void onDomainChanged();
 
 private:
     HistoryModel* m_sourceModel;
-    QMap<QString, HistoryDomainModel*> m_domains;
-    QStringList m_domainsPerLastVisit;
+    QHash<QString, HistoryDomainModel*> m_domains;
+    QVector<QString> m_domainsPerLastVisit;
+    QHash<QString, int> m_domainPositions;
 
     void clearDomains();
     void populateModel();
+    HistoryDomainModel* createDomainModel(const QString& domain);
     void insertNewDomain(const QString& domain);
+    void updateDomain(const QString& domain);
+    void removeDomain(const QString& domain);
+    int sortedPosition(const QString& domain, int skip=-1) const;
+    void indexPositions(int first, int last);
     QString getDomainFromSourceModel(const QModelIndex& index) const;
-    void emitDataChanged(const QString& domain);
+    void emitDataChanged(int row);
 };
 
 #endif // __HISTORY_DOMAINLIST_MODEL_H__
@@ -35,10 +35,15 @@
     The source model needs to expose a role named 'lastVisitDate', from which
     the input dates will be read. If such role is not present, this model will
     not expose any dates.
+
+    The model only keeps track of the number of source rows for each date, and
+    of the date of each source row so that changes can be accounted for. All
+    updates are logarithmic in the number of dates.
 */
 HistoryLastVisitDateListModel::HistoryLastVisitDateListModel(QObject* parent)
     : QAbstractListModel(parent)
     , m_sourceModel(0)
+    , m_sourceModelRole(-1)
 {
 }
 
@@ -109,9 +114,12 @@ void HistoryLastVisitDateListModel::setSourceModel(QVariant sourceModel)
             connect(m_sourceModel,
                     SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)),
                     SLOT(onRowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+            connect(m_sourceModel,
+                    SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)),
+                    SLOT(onDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
             connect(m_sourceModel, SIGNAL(modelReset()), SLOT(onModelReset()));
             connect(m_sourceModel, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)),
-                    SLOT(onModelReset()));
+                    SLOT(onLayoutChanged()));
         }
         endResetModel();
         Q_EMIT sourceModelChanged();
@@ -121,96 +129,110 @@ void HistoryLastVisitDateListModel::setSourceModel(QVariant sourceModel)
 void HistoryLastVisitDateListModel::clearLastVisitDates()
 {
     m_orderedDates.clear();
-    Q_FOREACH(const QDate& lastVisitDate, m_lastVisitDates.keys()) {
-        delete m_lastVisitDates.take(lastVisitDate);
-    }
+    m_dateCounts.clear();
+    m_rowDates.clear();
 }
 
+/*
+    The dates of the source rows are stored in reverse order (last row first),
+    as rows are most commonly inserted at the top of history models.
+*/
 void HistoryLastVisitDateListModel::populateModel()
 {
-    if (m_sourceModel != 0) {
+    if ((m_sourceModel != 0) && (m_sourceModelRole != -1)) {
         int count = m_sourceModel->rowCount();
+        m_rowDates.resize(count);
         for (int i = 0; i < count; ++i) {
-            insertNewHistoryEntry(new QPersistentModelIndex(m_sourceModel->index(i, 0)), false);
+            QDate date = sourceDate(i);
+            m_rowDates[count - 1 - i] = date;
+            addDate(date, false);
         }
     }
 }
 
 void HistoryLastVisitDateListModel::onRowsInserted(const QModelIndex& parent, int start, int end)
 {
+    Q_UNUSED(parent);
+    if (m_sourceModelRole == -1) {
+        return;
+    }
+    int position = m_rowDates.count() - start;
+    m_rowDates.insert(position, end - start + 1, QDate());
     for (int i = start; i <= end; ++i) {
-        insertNewHistoryEntry(new QPersistentModelIndex(m_sourceModel->index(i, 0)), true);
+        QDate date = sourceDate(i);
+        m_rowDates[position + end - i] = date;
+        addDate(date, true);
     }
 }
 
 void HistoryLastVisitDateListModel::onRowsRemoved(const QModelIndex& parent, int start, int end)
 {
-    QMap<QDate, QList<QPersistentModelIndex*>*>::iterator lastVisitDate = m_lastVisitDates.begin();
-    while (lastVisitDate != m_lastVisitDates.end()) {
-
-        QList<QPersistentModelIndex*>::iterator entry = lastVisitDate.value()->begin();
-        while (entry != lastVisitDate.value()->end()) {
-            QPersistentModelIndex *index = *entry;
-            if (!index->isValid()) {
-                entry = lastVisitDate.value()->erase(entry);
-            } else {
-                ++entry;
-            }
-        }
-
-        if (lastVisitDate.value()->isEmpty()) {
-            int removeAt = m_orderedDates.indexOf(lastVisitDate.key());
-            beginRemoveRows(QModelIndex(), removeAt, removeAt);
-            m_orderedDates.removeAt(removeAt);
-            delete lastVisitDate.value();
-            lastVisitDate = m_lastVisitDates.erase(lastVisitDate);
-            endRemoveRows();
-        } else {
-            ++lastVisitDate;
-        }
+    Q_UNUSED(parent);
+    if (m_sourceModelRole == -1) {
+        return;
     }
-
-    if (m_lastVisitDates.isEmpty()) {
-        // Remove the default entry if model is empty
-        beginRemoveRows(QModelIndex(), 0, 0);
-        m_orderedDates.clear();
-        endRemoveRows();
+    int position = m_rowDates.count() - 1 - end;
+    int count = end - start + 1;
+    for (int i = position; i < position + count; ++i) {
+        removeDate(m_rowDates.at(i));
     }
+    m_rowDates.remove(position, count);
 }
 
 void HistoryLastVisitDateListModel::onRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row)
 {
     Q_UNUSED(parent);
     Q_UNUSED(destination);
+    if (m_sourceModelRole == -1) {
+        return;
+    }
 
-    // Rows were moved in the source model, meaning that their last visit dates
-    // were potentially updated, so we remove all the dates corresponding to
-    // the rows before they were moved, and we add all the dates corresponding
-    // to the rows after they were moved.
-
-    // Determine a lower and upper bound for the dates that should be removed
-    // by looking at the indexes surrounding the rows before they were moved.
-    QDate lower = m_sourceModel->data(m_sourceModel->index((row < start) ? end + 1 : start, 0), m_sourceModelRole).toDate();
-    if (!lower.isValid()) {
-        // The last row was moved too, we don’t have a strict lower bound.
-        lower = m_orderedDates.last().addDays(-1);
+    // Move the dates along with the rows. Rows are usually moved because
+    // they were visited again, so their dates may have changed too.
+    int count = end - start + 1;
+    int position = m_rowDates.count() - 1 - end;
+    QVector<QDate> moved = m_rowDates.mid(position, count);
+    m_rowDates.remove(position, count);
+    int first = (row > end) ? row - count : row;
+    position = m_rowDates.count() - first;
+    m_rowDates.insert(position, count, QDate());
+    for (int i = 0; i < count; ++i) {
+        m_rowDates[position + i] = moved.at(i);
     }
-    QDate upper = m_sourceModel->data(m_sourceModel->index((row < start) ? end : start - 1, 0), m_sourceModelRole).toDate();
-    for (QDate i = upper.addDays(-1); i > lower; i = i.addDays(-1)) {
-        if (m_orderedDates.contains(i)) {
-            int removeAt = m_orderedDates.indexOf(i);
-            beginRemoveRows(QModelIndex(), removeAt, removeAt);
-            m_orderedDates.removeAt(removeAt);
-            delete m_lastVisitDates.take(i);
-            endRemoveRows();
-        }
+    updateDates(first, first + count - 1);
+}
+
+void HistoryLastVisitDateListModel::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+{
+    if (m_sourceModelRole == -1) {
+        return;
     }
+    if (roles.isEmpty() || roles.contains(m_sourceModelRole)) {
+        updateDates(topLeft.row(), bottomRight.row());
+    }
+}
 
-    // Now add back dates for all the rows after they were moved.
-    for (int i = 0; i <= (end - start); ++i) {
-        int index = i + row + ((row < start) ? 0 : start - end);
-        insertNewHistoryEntry(new QPersistentModelIndex(m_sourceModel->index(index, 0)), true);
+/*
+    The rows of the source model were reordered, but the number of rows for
+    each date remains the same, unless their data changed too. In any case,
+    only the dates that actually appear or disappear are notified.
+*/
+void HistoryLastVisitDateListModel::onLayoutChanged()
+{
+    if (m_sourceModelRole == -1) {
+        return;
+    }
+    int count = m_sourceModel->rowCount();
+    QVector<QDate> rowDates(count);
+    for (int i = 0; i < count; ++i) {
+        QDate date = sourceDate(i);
+        rowDates[count - 1 - i] = date;
+        addDate(date, true);
+    }
+    Q_FOREACH(const QDate& date, m_rowDates) {
+        removeDate(date);
     }
+    m_rowDates.swap(rowDates);
 }
 
 void HistoryLastVisitDateListModel::updateSourceModelRole()
@@ -233,45 +255,99 @@ void HistoryLastVisitDateListModel::onModelReset()
     endResetModel();
 }
 
-void HistoryLastVisitDateListModel::insertNewHistoryEntry(QPersistentModelIndex* index, bool notify)
+QDate HistoryLastVisitDateListModel::sourceDate(int row) const
 {
-    if (m_sourceModelRole == -1) {
-        return;
-    }
+    return m_sourceModel->data(m_sourceModel->index(row, 0), m_sourceModelRole).toDate();
+}
 
-    QDate lastVisitDate = index->data(m_sourceModelRole).toDate();
-    if (!m_lastVisitDates.contains(lastVisitDate)) {
-        if (m_orderedDates.isEmpty()) {
-            // Add default entry to represent all dates
-            if (notify) {
-                beginInsertRows(QModelIndex(), 0, 0);
-            }
-            m_orderedDates.append(QDate());
-            if (notify) {
-                endInsertRows();
-            }
+/*
+    Binary search for a date in m_orderedDates (most recent first, after the
+    default entry), or for the position where it would be inserted.
+*/
+int HistoryLastVisitDateListModel::datePosition(const QDate& date) const
+{
+    int first = 1;
+    int last = m_orderedDates.count();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (m_orderedDates.at(middle) > date) {
+            first = middle + 1;
+        } else {
+            last = middle;
         }
+    }
+    return first;
+}
 
-        int insertAt = 1;
-        QList<QPersistentModelIndex*> *entries = new QList<QPersistentModelIndex*>();
-        while (insertAt < m_orderedDates.count()) {
-            if (lastVisitDate > m_orderedDates.at(insertAt)) {
-                break;
-            }
-            ++insertAt;
-        }
+void HistoryLastVisitDateListModel::addDate(const QDate& date, bool notify)
+{
+    int position = datePosition(date);
+    if ((position < m_orderedDates.count()) && (m_orderedDates.at(position) == date)) {
+        ++m_dateCounts[position];
+        return;
+    }
 
+    if (m_orderedDates.isEmpty()) {
+        // Add default entry to represent all dates
         if (notify) {
-            beginInsertRows(QModelIndex(), insertAt, insertAt);
+            beginInsertRows(QModelIndex(), 0, 0);
         }
-
-        m_orderedDates.insert(insertAt, lastVisitDate);
-        m_lastVisitDates.insert(lastVisitDate, entries);
-
+        m_orderedDates.append(QDate());
+        m_dateCounts.append(0);
         if (notify) {
             endInsertRows();
         }
     }
 
-    m_lastVisitDates[lastVisitDate]->append(index);
+    if (notify) {
+        beginInsertRows(QModelIndex(), position, position);
+    }
+    m_orderedDates.insert(position, date);
+    m_dateCounts.insert(position, 1);
+    if (notify) {
+        endInsertRows();
+    }
+}
+
+void HistoryLastVisitDateListModel::removeDate(const QDate& date)
+{
+    int position = datePosition(date);
+    if ((position >= m_orderedDates.count()) || (m_orderedDates.at(position) != date)) {
+        return;
+    }
+    if (--m_dateCounts[position] > 0) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), position, position);
+    m_orderedDates.remove(position);
+    m_dateCounts.remove(position);
+    endRemoveRows();
+
+    if (m_orderedDates.count() == 1) {
+        // Remove the default entry if model is empty
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_orderedDates.clear();
+        m_dateCounts.clear();
+        endRemoveRows();
+    }
+}
+
+/*
+    Account for the dates of the given source rows that changed. New dates are
+    added before the old ones are removed, so that the default entry doesn’t
+    transiently go away.
+*/
+void HistoryLastVisitDateListModel::updateDates(int first, int last)
+{
+    int count = m_rowDates.count();
+    for (int i = first; i <= last; ++i) {
+        QDate date = sourceDate(i);
+        QDate& previous = m_rowDates[count - 1 - i];
+        if (date != previous) {
+            addDate(date, true);
+            removeDate(previous);
+            previous = date;
+        }
+    }
 }
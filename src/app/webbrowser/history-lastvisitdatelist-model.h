@@ -21,9 +21,9 @@
 
 // Qt
 #include <QtCore/QAbstractListModel>
-#include <QtCore/QMap>
-#include <QtCore/QSortFilterProxyModel>
+#include <QtCore/QDate>
 #include <QtCore/QString>
+#include <QtCore/QVector>
 
 class HistoryLastVisitDateListModel : public QAbstractListModel
 {
@@ -56,17 +56,24 @@ private Q_SLOTS:
     void onRowsInserted(const QModelIndex& parent, int start, int end);
     void onRowsRemoved(const QModelIndex& parent, int start, int end);
     void onRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onLayoutChanged();
     void onModelReset();
 
 private:
     QAbstractItemModel* m_sourceModel;
     int m_sourceModelRole;
-    QMap<QDate, QList<QPersistentModelIndex*>*> m_lastVisitDates;
-    QList<QDate> m_orderedDates;
+    QVector<QDate> m_orderedDates;
+    QVector<int> m_dateCounts;
+    QVector<QDate> m_rowDates;
 
     void clearLastVisitDates();
     void populateModel();
-    void insertNewHistoryEntry(QPersistentModelIndex* index, bool notify);
+    QDate sourceDate(int row) const;
+    int datePosition(const QDate& date) const;
+    void addDate(const QDate& date, bool notify);
+    void removeDate(const QDate& date);
+    void updateDates(int first, int last);
     void updateSourceModelRole();
 };
 
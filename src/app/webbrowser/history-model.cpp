@@ -17,15 +17,67 @@
  */
 
 #include "../domain-utils.h"
+#include "full-text-search.h"
+#include "history-domain-model.h"
 #include "history-model.h"
 
 // Qt
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QReadLocker>
+#include <QtCore/QStringList>
+#include <QtCore/QTimeZone>
 #include <QtCore/QTimer>
 #include <QtCore/QWriteLocker>
+#include <QtCore/QtMath>
 #include <QtSql/QSqlQuery>
 
 #define SQL_DRIVER QStringLiteral("QSQLITE")
 #define CONNECTION_NAME QStringLiteral("morph-browser-history")
+#define FETCH_CHUNK_SIZE 2000
+#define SCHEMA_VERSION 4
+#define BACKFILL_BATCH_SIZE 200
+#define FRECENCY_HALF_LIFE (30 * 24 * 3600)
+#define PRUNE_BATCH_SIZE 500
+#define TIMEZONE_CHECK_INTERVAL 60000
+#define FRECENCY_REFRESH_INTERVAL (3600 * 1000)
+
+/*
+    The frecency of an entry is the sum of the weights of its visits, each of
+    them halved every FRECENCY_HALF_LIFE seconds. Since all the terms decay at
+    the same rate, the score can be updated incrementally: it is stored as of
+    the last visit, and decayed from there whenever needed (timestamps are in
+    milliseconds).
+*/
+static double decayFrecency(double frecency, qint64 from, qint64 to)
+{
+    if (to <= from) {
+        return frecency;
+    }
+    return frecency * qPow(0.5, double(to - from) / (FRECENCY_HALF_LIFE * 1000.0));
+}
+
+/*
+    The local date of each entry is computed once (on the database thread
+    for fetched entries) instead of every time it is queried, as this
+    involves a time zone conversion.
+*/
+static qint32 localDate(qint64 timestamp)
+{
+    return QDateTime::fromMSecsSinceEpoch(timestamp).date().toJulianDay();
+}
+
+static double transitionWeight(HistoryModel::Transition transition)
+{
+    switch (transition) {
+    case HistoryModel::Typed:
+        return 2.0;
+    case HistoryModel::Bookmark:
+        return 1.5;
+    default:
+        return 1.0;
+    }
+}
 
 /*!
     \class HistoryModel
@@ -43,22 +95,76 @@
     However the model doesn’t monitor the database for external changes.
     All database operations are performed on a separate thread in order not to
     block the UI thread.
+
+    When pageSize is set to a positive value, only the most recent entries
+    (up to pageSize) are loaded at startup, and older entries are fetched on
+    demand, one page at a time, through canFetchMore() and fetchMore().
+    Adding a URL that is not resident in the model yet looks it up in the
+    database so that its visits count is preserved.
+
+    The URLs and titles of all the entries (resident or not) can be searched
+    without loading them, see matchUrls().
+
+    Each visit is also logged individually, and a frecency score (that
+    accounts for both the number and the recency of visits) is maintained
+    for every entry, so that the most relevant entries can be ranked without
+    going through the whole history. The frecency role returns the scores
+    decayed to a common reference time, which only changes when the scores
+    are refreshed (see refreshFrecency()), so that they remain stable while
+    views sort on them.
+
+    History can be bounded by a retention policy (see maxAge, maxCount and
+    maxDatabaseSize). Entries beyond the limits are not loaded, and they are
+    removed from the database in the background, oldest first.
+
+    The entries are also grouped by domain (see domains(), domainEntryCount()
+    and domainEntryRow()), which is what HistoryDomainModel views are built
+    upon: each of them is only notified of changes to its own entries.
 */
 HistoryModel::HistoryModel(QObject* parent)
     : QAbstractListModel(parent)
+    , m_pageSize(0)
+    , m_maxAge(0)
+    , m_maxCount(0)
+    , m_maxDatabaseSize(0)
+    , m_canFetchMore(false)
+    , m_fetchingMore(false)
+    , m_urlIndexOffset(0)
+    , m_lastMatchRequest(0)
+    , m_timeZoneId(QTimeZone::systemTimeZoneId())
+    , m_frecencyReferenceTime(QDateTime::currentMSecsSinceEpoch())
 {
     m_dbWorker = new DbWorker;
     m_dbWorker->moveToThread(&m_dbWorkerThread);
-    connect(m_dbWorker, SIGNAL(hiddenEntryFetched(const QUrl&)),
-            SLOT(onHiddenEntryFetched(const QUrl&)), Qt::QueuedConnection);
-    connect(m_dbWorker,
-            SIGNAL(entryFetched(const QUrl&, const QString&, const QString&,
-                                const QUrl&, int, const QDateTime&)),
-            SLOT(onEntryFetched(const QUrl&, const QString&, const QString&,
-                                const QUrl&, int, const QDateTime&)),
+    connect(m_dbWorker, SIGNAL(hiddenEntriesFetched(const QList<QUrl>&)),
+            SLOT(onHiddenEntriesFetched(const QList<QUrl>&)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(entriesFetched(const QVector<HistoryModel::HistoryEntry>&)),
+            SLOT(onEntriesFetched(const QVector<HistoryModel::HistoryEntry>&)),
             Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(pageFetched(bool)),
+            SLOT(onPageFetched(bool)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(entryLookedUp(const QUrl&, int, double)),
+            SLOT(onEntryLookedUp(const QUrl&, int, double)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(urlsMatched(int, const QList<QUrl>&)),
+            SIGNAL(urlsMatched(int, const QList<QUrl>&)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(entriesPruned(qint64, const QByteArray&)),
+            SLOT(onEntriesPruned(qint64, const QByteArray&)), Qt::QueuedConnection);
+    connect(m_dbWorker, SIGNAL(pruned(int)), SIGNAL(pruned(int)), Qt::QueuedConnection);
     connect(m_dbWorker, SIGNAL(loaded()), SIGNAL(loaded()));
+    connect(m_dbWorker, SIGNAL(flushed(int, qint64)), SIGNAL(databaseFlushed(int, qint64)));
     m_dbWorkerThread.start(QThread::LowPriority);
+
+    m_timeZoneCheck = new QTimer(this);
+    m_timeZoneCheck->setInterval(TIMEZONE_CHECK_INTERVAL);
+    m_timeZoneCheck->setTimerType(Qt::VeryCoarseTimer);
+    connect(m_timeZoneCheck, SIGNAL(timeout()), SLOT(checkTimeZone()));
+    m_timeZoneCheck->start();
+
+    m_frecencyRefresh = new QTimer(this);
+    m_frecencyRefresh->setInterval(FRECENCY_REFRESH_INTERVAL);
+    m_frecencyRefresh->setTimerType(Qt::VeryCoarseTimer);
+    connect(m_frecencyRefresh, SIGNAL(timeout()), SLOT(refreshFrecency()));
+    m_frecencyRefresh->start();
 }
 
 HistoryModel::~HistoryModel()
@@ -73,35 +179,239 @@ void HistoryModel::resetDatabase(const QString& databaseName)
     beginResetModel();
     m_hiddenEntries.clear();
     m_entries.clear();
+    resetDomainModels();
+    rebuildUrlIndex();
+    m_canFetchMore = false;
+    m_fetchingMore = true;
+    m_frecencyReferenceTime = QDateTime::currentMSecsSinceEpoch();
     Q_EMIT m_dbWorker->resetDatabase(databaseName);
     endResetModel();
-    Q_EMIT m_dbWorker->fetchEntries();
+    Q_EMIT m_dbWorker->fetchEntries(m_pageSize);
 }
 
-void HistoryModel::onHiddenEntryFetched(const QUrl& url)
+void HistoryModel::onHiddenEntriesFetched(const QList<QUrl>& urls)
 {
-    m_hiddenEntries.insert(url);
+    Q_FOREACH(const QUrl& url, urls) {
+        m_hiddenEntries.insert(url.toEncoded());
+    }
 }
 
-void HistoryModel::onEntryFetched(const QUrl& url, const QString& domain, const QString& title,
-                                  const QUrl& icon, int visits, const QDateTime& lastVisit)
+/*
+    Entries are fetched from the database in chunks, each one of them is
+    appended to the model with a single row insertion notification.
+    Fetched entries are older than the resident ones, so they are inserted
+    at the front of m_entries.
+*/
+void HistoryModel::onEntriesFetched(const QVector<HistoryEntry>& entries)
 {
-    HistoryEntry entry;
-    entry.url = url;
-    if (domain.isEmpty()) {
-        entry.domain = DomainUtils::extractTopLevelDomainName(url);
+    QVector<HistoryEntry> fetched;
+    fetched.reserve(entries.count());
+    for (int i = entries.count() - 1; i >= 0; --i) {
+        HistoryEntry entry = entries.at(i);
+        if (m_urlIndex.contains(entry.url)) {
+            // Visited again while older entries were being fetched
+            continue;
+        }
+        entry.domain = internDomain(entry.domain);
+        entry.hidden = m_hiddenEntries.contains(entry.url);
+        fetched.append(entry);
+    }
+    if (fetched.isEmpty()) {
+        return;
+    }
+    // Fetched entries are the oldest ones of their domains too
+    QHash<QString, QVector<QByteArray>> fetchedByDomain;
+    Q_FOREACH(const HistoryEntry& entry, fetched) {
+        fetchedByDomain[entry.domain].append(entry.url);
+    }
+    QList<HistoryDomainModel*> models;
+    QHash<QString, QVector<QByteArray>>::const_iterator group;
+    for (group = fetchedByDomain.constBegin(); group != fetchedByDomain.constEnd(); ++group) {
+        int domainCount = domainEntryCount(group.key());
+        Q_FOREACH(HistoryDomainModel* model, m_domainModels.values(group.key())) {
+            model->beginInsertRows(QModelIndex(), domainCount, domainCount + group.value().count() - 1);
+            models.append(model);
+        }
+    }
+    int first = m_entries.count();
+    int count = fetched.count();
+    beginInsertRows(QModelIndex(), first, first + count - 1);
+    if (m_entries.isEmpty()) {
+        m_entries.swap(fetched);
     } else {
-        entry.domain = domain;
-    }
-    entry.title = title;
-    entry.icon = icon;
-    entry.visits = visits;
-    entry.lastVisit = lastVisit;
-    entry.hidden = m_hiddenEntries.contains(url);
-    int index = m_entries.count();
-    beginInsertRows(QModelIndex(), index, index);
-    m_entries.append(entry);
+        m_entries.insert(0, count, HistoryEntry());
+        for (int i = 0; i < count; ++i) {
+            m_entries[i] = fetched.at(i);
+        }
+    }
+    m_urlIndexOffset += count;
+    indexPositions(0, count - 1);
+    for (group = fetchedByDomain.constBegin(); group != fetchedByDomain.constEnd(); ++group) {
+        QVector<QByteArray>& urls = m_domainIndex[group.key()];
+        urls = group.value() + urls;
+    }
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->endInsertRows();
+    }
     endInsertRows();
+    Q_EMIT rowCountChanged();
+}
+
+void HistoryModel::onPageFetched(bool canFetchMore)
+{
+    m_canFetchMore = canFetchMore;
+    m_fetchingMore = false;
+}
+
+void HistoryModel::onEntryLookedUp(const QUrl& url, int visits, double frecency)
+{
+    int index = getEntryIndex(url.toEncoded());
+    if (index != -1) {
+        HistoryEntry& entry = entryAt(index);
+        entry.visits += visits;
+        entry.frecency += frecency;
+        emitEntryChanged(index, QVector<int>() << Visits << Frecency);
+        updateExistingEntryInDatabase(entry);
+    }
+}
+
+/*
+    All the entries up to a (lastVisit, url) key were removed from the
+    database. As the model is sorted chronologically they are the oldest
+    ones, and are removed in as few ranges as possible.
+*/
+void HistoryModel::onEntriesPruned(qint64 lastVisit, const QByteArray& url)
+{
+    int count = m_entries.count();
+    int first = 0;
+    while (first < m_entries.count()) {
+        if (!isPruned(m_entries.at(first), lastVisit, url)) {
+            if ((m_entries.at(first).lastVisit / 1000) > lastVisit) {
+                break;
+            }
+            ++first;
+            continue;
+        }
+        int last = first;
+        while ((last + 1 < m_entries.count()) && isPruned(m_entries.at(last + 1), lastVisit, url)) {
+            ++last;
+        }
+        // The entries of a given domain in the range are contiguous in the
+        // domain index too: (position in the index, count) for each domain.
+        QHash<QString, QPair<int, int>> ranges;
+        for (int i = first; i <= last; ++i) {
+            const HistoryEntry& entry = m_entries.at(i);
+            QHash<QString, QPair<int, int>>::iterator range = ranges.find(entry.domain);
+            if (range == ranges.end()) {
+                int position = domainEntryPosition(m_domainIndex.value(entry.domain), entry.url);
+                ranges.insert(entry.domain, qMakePair(position, 1));
+            } else {
+                ++range.value().second;
+            }
+        }
+        QList<HistoryDomainModel*> models;
+        QHash<QString, QPair<int, int>>::const_iterator range;
+        for (range = ranges.constBegin(); range != ranges.constEnd(); ++range) {
+            int domainCount = domainEntryCount(range.key());
+            int position = range.value().first;
+            int removed = range.value().second;
+            Q_FOREACH(HistoryDomainModel* model, m_domainModels.values(range.key())) {
+                model->beginRemoveRows(QModelIndex(), domainCount - position - removed,
+                                       domainCount - 1 - position);
+                models.append(model);
+            }
+        }
+        int total = m_entries.count();
+        beginRemoveRows(QModelIndex(), total - 1 - last, total - 1 - first);
+        for (int i = first; i <= last; ++i) {
+            m_urlIndex.remove(m_entries.at(i).url);
+        }
+        m_entries.remove(first, last - first + 1);
+        if (first == 0) {
+            m_urlIndexOffset -= last + 1;
+        } else {
+            indexPositions(first, m_entries.count() - 1);
+        }
+        for (range = ranges.constBegin(); range != ranges.constEnd(); ++range) {
+            removeFromDomainIndex(range.key(), range.value().first, range.value().second);
+        }
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            model->endRemoveRows();
+        }
+        endRemoveRows();
+    }
+    if (m_entries.count() != count) {
+        Q_EMIT rowCountChanged();
+    }
+}
+
+/*
+    There is no notification for changes of the system time zone, it is
+    checked every once in a while. If it changed, the cached local dates of
+    all the entries are updated at once.
+*/
+void HistoryModel::checkTimeZone()
+{
+    QByteArray timeZoneId = QTimeZone::systemTimeZoneId();
+    if (timeZoneId == m_timeZoneId) {
+        return;
+    }
+    m_timeZoneId = timeZoneId;
+    if (m_entries.isEmpty()) {
+        return;
+    }
+    for (int i = 0; i < m_entries.count(); ++i) {
+        HistoryEntry& entry = m_entries[i];
+        entry.lastVisitDate = localDate(entry.lastVisit);
+    }
+    QVector<int> roles;
+    roles << LastVisitDate << LastVisitDateString;
+    Q_EMIT dataChanged(index(0, 0), index(m_entries.count() - 1, 0), roles);
+    Q_FOREACH(HistoryDomainModel* model, m_domainModels) {
+        int count = model->rowCount();
+        if (count > 0) {
+            Q_EMIT model->dataChanged(model->index(0, 0), model->index(count - 1, 0), roles);
+        }
+    }
+}
+
+/*!
+    Decay the frecency scores of all the entries to the current time.
+
+    This happens every once in a while (and when the database is loaded),
+    all the entries being notified of the change at once.
+*/
+void HistoryModel::refreshFrecency()
+{
+    m_frecencyReferenceTime = QDateTime::currentMSecsSinceEpoch();
+    if (m_entries.isEmpty()) {
+        return;
+    }
+    QVector<int> roles;
+    roles << Frecency;
+    Q_EMIT dataChanged(index(0, 0), index(m_entries.count() - 1, 0), roles);
+    Q_FOREACH(HistoryDomainModel* model, m_domainModels) {
+        int count = model->rowCount();
+        if (count > 0) {
+            Q_EMIT model->dataChanged(model->index(0, 0), model->index(count - 1, 0), roles);
+        }
+    }
+}
+
+/*
+    Entries are pruned in the order of the (lastVisit, url) index of the
+    database. SQLite compares the URLs as stored, byte by byte in UTF-8
+    (BINARY collation), which differs from the ordering of QString (UTF-16
+    code units) for characters beyond the basic multilingual plane, so the
+    entries visited in the same second are compared the same way.
+*/
+bool HistoryModel::isPruned(const HistoryEntry& entry, qint64 lastVisit, const QByteArray& url)
+{
+    qint64 entryLastVisit = entry.lastVisit / 1000;
+    if (entryLastVisit != lastVisit) {
+        return (entryLastVisit < lastVisit);
+    }
+    return (QUrl::fromEncoded(entry.url).toString().toUtf8() <= url);
 }
 
 QHash<int, QByteArray> HistoryModel::roleNames() const
@@ -117,6 +427,7 @@ QHash<int, QByteArray> HistoryModel::roleNames() const
         roles[LastVisitDate] = "lastVisitDate";
         roles[LastVisitDateString] = "lastVisitDateString";
         roles[Hidden] = "hidden";
+        roles[Frecency] = "frecency";
     }
     return roles;
 }
@@ -132,31 +443,55 @@ QVariant HistoryModel::data(const QModelIndex& index, int role) const
     if (!index.isValid()) {
         return QVariant();
     }
-    const HistoryEntry& entry = m_entries.at(index.row());
+    const HistoryEntry& entry = entryAt(index.row());
     switch (role) {
     case Url:
-        return entry.url;
+        return QUrl::fromEncoded(entry.url);
     case Domain:
         return entry.domain;
     case Title:
         return entry.title;
     case Icon:
-        return entry.icon;
+        return QUrl::fromEncoded(entry.icon);
     case Visits:
-        return entry.visits;
+        return uint(entry.visits);
     case LastVisit:
-        return entry.lastVisit;
+        return QDateTime::fromMSecsSinceEpoch(entry.lastVisit, Qt::UTC);
     case LastVisitDate:
-        return entry.lastVisit.toLocalTime().date();
-    case LastVisitDateString:
-        return entry.lastVisit.toLocalTime().date().toString(Qt::ISODate);
+        return QDate::fromJulianDay(entry.lastVisitDate);
+    case LastVisitDateString: {
+        // Many entries share the same date, so do the strings
+        QHash<qint32, QString>::const_iterator i = m_dateStrings.constFind(entry.lastVisitDate);
+        if (i == m_dateStrings.constEnd()) {
+            QString date = QDate::fromJulianDay(entry.lastVisitDate).toString(Qt::ISODate);
+            i = m_dateStrings.insert(entry.lastVisitDate, date);
+        }
+        return i.value();
+    }
     case Hidden:
-        return entry.hidden;
+        return bool(entry.hidden);
+    case Frecency:
+        return decayFrecency(entry.frecency, entry.lastVisit, m_frecencyReferenceTime);
     default:
         return QVariant();
     }
 }
 
+bool HistoryModel::canFetchMore(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return m_canFetchMore && !m_fetchingMore;
+}
+
+void HistoryModel::fetchMore(const QModelIndex& parent)
+{
+    Q_UNUSED(parent);
+    if (canFetchMore()) {
+        m_fetchingMore = true;
+        Q_EMIT m_dbWorker->fetchPage();
+    }
+}
+
 const QString HistoryModel::databasePath() const
 {
     return m_databasePath;
@@ -175,14 +510,242 @@ void HistoryModel::setDatabasePath(const QString& path)
     }
 }
 
-int HistoryModel::getEntryIndex(const QUrl& url) const
+int HistoryModel::pageSize() const
 {
-    for (int i = 0; i < m_entries.count(); ++i) {
-        if (m_entries.at(i).url == url) {
-            return i;
+    return m_pageSize;
+}
+
+/*!
+    Set the maximum number of entries loaded at once (0 loads the whole
+    history). This takes effect the next time the database is loaded.
+*/
+void HistoryModel::setPageSize(int pageSize)
+{
+    pageSize = qMax(0, pageSize);
+    if (pageSize != m_pageSize) {
+        m_pageSize = pageSize;
+        Q_EMIT pageSizeChanged();
+    }
+}
+
+/*!
+    Maximum age of the entries to keep, in days (0 means no limit).
+*/
+int HistoryModel::maxAge() const
+{
+    return m_maxAge;
+}
+
+void HistoryModel::setMaxAge(int maxAge)
+{
+    maxAge = qMax(0, maxAge);
+    if (maxAge != m_maxAge) {
+        m_maxAge = maxAge;
+        updateRetentionPolicy();
+        Q_EMIT maxAgeChanged();
+    }
+}
+
+/*!
+    Maximum number of entries to keep (0 means no limit).
+*/
+int HistoryModel::maxCount() const
+{
+    return m_maxCount;
+}
+
+void HistoryModel::setMaxCount(int maxCount)
+{
+    maxCount = qMax(0, maxCount);
+    if (maxCount != m_maxCount) {
+        m_maxCount = maxCount;
+        updateRetentionPolicy();
+        Q_EMIT maxCountChanged();
+    }
+}
+
+/*!
+    Maximum size of the data stored in the database, in bytes
+    (0 means no limit).
+*/
+qint64 HistoryModel::maxDatabaseSize() const
+{
+    return m_maxDatabaseSize;
+}
+
+void HistoryModel::setMaxDatabaseSize(qint64 maxDatabaseSize)
+{
+    maxDatabaseSize = qMax(Q_INT64_C(0), maxDatabaseSize);
+    if (maxDatabaseSize != m_maxDatabaseSize) {
+        m_maxDatabaseSize = maxDatabaseSize;
+        updateRetentionPolicy();
+        Q_EMIT maxDatabaseSizeChanged();
+    }
+}
+
+void HistoryModel::updateRetentionPolicy()
+{
+    Q_EMIT m_dbWorker->setRetentionPolicy(m_maxAge, m_maxCount, m_maxDatabaseSize);
+}
+
+/*
+    Entries are stored in m_entries oldest first (i.e. in reverse order of
+    the rows), so that adding a new entry (the common case when navigating)
+    is an append.
+    Lookups by URL go through m_urlIndex, which maps each URL to its position
+    in m_entries minus m_urlIndexOffset. Changing the offset shifts all the
+    positions at once, so inserting older entries at the front is O(1) per
+    entry. Moving or removing an entry only re-indexes the entries on the
+    shorter side of the affected position.
+*/
+int HistoryModel::getEntryIndex(const QByteArray& url) const
+{
+    QHash<QByteArray, int>::const_iterator i = m_urlIndex.constFind(url);
+    if (i == m_urlIndex.constEnd()) {
+        return -1;
+    }
+    return m_entries.count() - 1 - (i.value() + m_urlIndexOffset);
+}
+
+void HistoryModel::indexPositions(int first, int last)
+{
+    for (int i = first; i <= last; ++i) {
+        m_urlIndex.insert(m_entries.at(i).url, i - m_urlIndexOffset);
+    }
+}
+
+void HistoryModel::rebuildUrlIndex()
+{
+    m_urlIndex.clear();
+    m_urlIndexOffset = 0;
+    m_urlIndex.reserve(m_entries.count());
+    indexPositions(0, m_entries.count() - 1);
+}
+
+HistoryModel::HistoryEntry& HistoryModel::entryAt(int row)
+{
+    return m_entries[m_entries.count() - 1 - row];
+}
+
+const HistoryModel::HistoryEntry& HistoryModel::entryAt(int row) const
+{
+    return m_entries.at(m_entries.count() - 1 - row);
+}
+
+/*
+    The same domain is shared by many entries, all of them hold a reference
+    to a single copy of the string (the key in the domain index).
+*/
+QString HistoryModel::internDomain(const QString& domain)
+{
+    QHash<QString, QVector<QByteArray>>::const_iterator i = m_domainIndex.constFind(domain);
+    if (i == m_domainIndex.constEnd()) {
+        i = m_domainIndex.insert(domain, QVector<QByteArray>());
+    }
+    return i.key();
+}
+
+/*
+    The domain index maps each domain to the URLs of its entries, in the same
+    order as m_entries (oldest first). Entries are located in there by binary
+    search on their positions in m_urlIndex.
+*/
+int HistoryModel::domainEntryPosition(const QVector<QByteArray>& urls, const QByteArray& url) const
+{
+    int position = m_urlIndex.value(url);
+    int first = 0;
+    int last = urls.count();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (m_urlIndex.value(urls.at(middle)) < position) {
+            first = middle + 1;
+        } else {
+            last = middle;
         }
     }
-    return -1;
+    return first;
+}
+
+int HistoryModel::domainRow(const HistoryEntry& entry) const
+{
+    const QVector<QByteArray>& urls = *m_domainIndex.constFind(entry.domain);
+    return urls.count() - 1 - domainEntryPosition(urls, entry.url);
+}
+
+void HistoryModel::removeFromDomainIndex(const QString& domain, int position, int count)
+{
+    QHash<QString, QVector<QByteArray>>::iterator i = m_domainIndex.find(domain);
+    i.value().remove(position, count);
+    if (i.value().isEmpty()) {
+        m_domainIndex.erase(i);
+    }
+}
+
+void HistoryModel::emitEntryChanged(int row, const QVector<int>& roles)
+{
+    Q_EMIT dataChanged(this->index(row, 0), this->index(row, 0), roles);
+    const HistoryEntry& entry = entryAt(row);
+    QList<HistoryDomainModel*> models = m_domainModels.values(entry.domain);
+    if (!models.isEmpty()) {
+        int domainRow = this->domainRow(entry);
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            QModelIndex index = model->index(domainRow, 0);
+            Q_EMIT model->dataChanged(index, index, roles);
+        }
+    }
+}
+
+void HistoryModel::resetDomainModels()
+{
+    QList<HistoryDomainModel*> models = m_domainModels.values();
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->beginResetModel();
+    }
+    m_domainIndex.clear();
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->endResetModel();
+    }
+}
+
+void HistoryModel::registerDomainModel(HistoryDomainModel* model)
+{
+    m_domainModels.insert(model->m_key, model);
+}
+
+void HistoryModel::unregisterDomainModel(HistoryDomainModel* model)
+{
+    m_domainModels.remove(model->m_key, model);
+}
+
+/*!
+    Return the domains of all the entries in the model, in no particular order.
+*/
+QStringList HistoryModel::domains() const
+{
+    return m_domainIndex.keys();
+}
+
+/*!
+    Return the number of entries in the model for a given domain.
+*/
+int HistoryModel::domainEntryCount(const QString& domain) const
+{
+    QHash<QString, QVector<QByteArray>>::const_iterator i = m_domainIndex.constFind(domain);
+    return (i == m_domainIndex.constEnd()) ? 0 : i.value().count();
+}
+
+/*!
+    Return the row of the entry at a given index among the entries of a given
+    domain (sorted chronologically, most recent visit first), or -1 if out of
+    range.
+*/
+int HistoryModel::domainEntryRow(const QString& domain, int index) const
+{
+    QHash<QString, QVector<QByteArray>>::const_iterator i = m_domainIndex.constFind(domain);
+    if ((i == m_domainIndex.constEnd()) || (index < 0) || (index >= i.value().count())) {
+        return -1;
+    }
+    return getEntryIndex(i.value().at(i.value().count() - 1 - index));
 }
 
 /*!
@@ -191,78 +754,115 @@ int HistoryModel::getEntryIndex(const QUrl& url) const
     If an entry with the same URL already exists, it is updated.
     Otherwise a new entry is created and added to the model.
 
-    Return the total number of visits for the URL.
+    The transition (how the user got to the URL) weighs on the frecency score
+    of the entry.
+
+    Return the total number of visits for the URL. This is provisional when
+    the URL is not resident while the model is still loading or paged (see
+    pageSize): it may have been visited before, which is only known once it
+    is looked up in the database in the background. The visits role of the
+    entry is then updated and notified as changed.
 */
-int HistoryModel::add(const QUrl& url, const QString& title, const QUrl& icon)
+int HistoryModel::add(const QUrl& url, const QString& title, const QUrl& icon,
+                      Transition transition)
 {
     if (url.isEmpty()) {
         return 0;
     }
     int count = 1;
-    QDateTime now = QDateTime::currentDateTimeUtc();
-    int index = getEntryIndex(url);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QByteArray encodedUrl = url.toEncoded();
+    int index = getEntryIndex(encodedUrl);
     if (index == -1) {
         HistoryEntry entry;
-        entry.url = url;
-        entry.domain = DomainUtils::extractTopLevelDomainName(url);
+        entry.url = encodedUrl;
+        entry.domain = internDomain(DomainUtils::extractTopLevelDomainName(url));
         entry.title = title;
-        entry.icon = icon;
+        entry.icon = icon.toEncoded();
         entry.visits = 1;
         entry.lastVisit = now;
-        entry.hidden = m_hiddenEntries.contains(entry.url);
+        entry.lastVisitDate = localDate(now);
+        entry.hidden = m_hiddenEntries.contains(encodedUrl);
+        entry.frecency = transitionWeight(transition);
+        if (m_canFetchMore || m_fetchingMore) {
+            // The URL may have been visited before without being resident
+            Q_EMIT m_dbWorker->lookupEntry(url);
+        }
+        QList<HistoryDomainModel*> models = m_domainModels.values(entry.domain);
         beginInsertRows(QModelIndex(), 0, 0);
-        m_entries.prepend(entry);
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            model->beginInsertRows(QModelIndex(), 0, 0);
+        }
+        m_entries.append(entry);
+        indexPositions(m_entries.count() - 1, m_entries.count() - 1);
+        m_domainIndex[entry.domain].append(entry.url);
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            model->endInsertRows();
+        }
         endInsertRows();
         insertNewEntryInDatabase(entry);
         Q_EMIT rowCountChanged();
     } else {
-        QVector<int> roles;
-        roles << Visits;
-        if (index == 0) {
-            HistoryEntry& entry = m_entries.first();
-            if (title != entry.title) {
-                entry.title = title;
-                roles << Title;
-            }
-            if (icon != entry.icon) {
-                entry.icon = icon;
-                roles << Icon;
+        if (index > 0) {
+            const HistoryEntry& moved = entryAt(index);
+            QVector<QByteArray>& urls = m_domainIndex[moved.domain];
+            int domainPosition = domainEntryPosition(urls, moved.url);
+            int domainRow = urls.count() - 1 - domainPosition;
+            QList<HistoryDomainModel*> models;
+            if (domainRow > 0) {
+                models = m_domainModels.values(moved.domain);
             }
-            count = ++entry.visits;
-            if (now != entry.lastVisit) {
-                if (now.date() != entry.lastVisit.date()) {
-                    roles << LastVisitDate;
-                    roles << LastVisitDateString;
-                }
-                entry.lastVisit = now;
-                roles << LastVisit;
-            }
-        } else {
             beginMoveRows(QModelIndex(), index, index, QModelIndex(), 0);
-            HistoryEntry entry = m_entries.takeAt(index);
-            if (title != entry.title) {
-                entry.title = title;
-                roles << Title;
+            Q_FOREACH(HistoryDomainModel* model, models) {
+                model->beginMoveRows(QModelIndex(), domainRow, domainRow, QModelIndex(), 0);
+            }
+            if (domainRow > 0) {
+                urls.append(urls.takeAt(domainPosition));
             }
-            if (icon != entry.icon) {
-                entry.icon = icon;
-                roles << Icon;
+            int position = m_entries.count() - 1 - index;
+            m_entries.append(m_entries.takeAt(position));
+            int last = m_entries.count() - 1;
+            if (index < position) {
+                indexPositions(position, last);
+            } else {
+                --m_urlIndexOffset;
+                indexPositions(0, position - 1);
+                indexPositions(last, last);
             }
-            count = ++entry.visits;
-            if (now != entry.lastVisit) {
-                if (now.date() != entry.lastVisit.date()) {
-                    roles << LastVisitDate;
-                    roles << LastVisitDateString;
-                }
-                entry.lastVisit = now;
-                roles << LastVisit;
+            Q_FOREACH(HistoryDomainModel* model, models) {
+                model->endMoveRows();
             }
-            m_entries.prepend(entry);
             endMoveRows();
         }
-        Q_EMIT dataChanged(this->index(0, 0), this->index(0, 0), roles);
-        updateExistingEntryInDatabase(m_entries.first());
+        QVector<int> roles;
+        roles << Visits << Frecency;
+        HistoryEntry& entry = m_entries.last();
+        if (title != entry.title) {
+            entry.title = title;
+            roles << Title;
+        }
+        QByteArray encodedIcon = icon.toEncoded();
+        if (encodedIcon != entry.icon) {
+            entry.icon = encodedIcon;
+            roles << Icon;
+        }
+        count = ++entry.visits;
+        entry.frecency = decayFrecency(entry.frecency, entry.lastVisit, now)
+                         + transitionWeight(transition);
+        if (now != entry.lastVisit) {
+            qint32 date = localDate(now);
+            if (date != entry.lastVisitDate) {
+                entry.lastVisitDate = date;
+                roles << LastVisitDate;
+                roles << LastVisitDateString;
+            }
+            entry.lastVisit = now;
+            roles << LastVisit;
+        }
+        emitEntryChanged(0, roles);
+        updateExistingEntryInDatabase(entry);
     }
+    insertVisitInDatabase(m_entries.last(), transition);
     return count;
 }
 
@@ -280,24 +880,25 @@ bool HistoryModel::update(const QUrl& url, const QString& title, const QUrl& ico
     if (url.isEmpty()) {
         return false;
     }
-    int index = getEntryIndex(url);
+    int index = getEntryIndex(url.toEncoded());
     if (index == -1) {
         return false;
     }
     QVector<int> roles;
-    const HistoryEntry& entry = m_entries.at(index);
+    HistoryEntry& entry = entryAt(index);
     if (title != entry.title) {
-        m_entries[index].title = title;
+        entry.title = title;
         roles << Title;
     }
-    if (icon != entry.icon) {
-        m_entries[index].icon = icon;
+    QByteArray encodedIcon = icon.toEncoded();
+    if (encodedIcon != entry.icon) {
+        entry.icon = encodedIcon;
         roles << Icon;
     }
     if (roles.isEmpty()) {
         return false;
     }
-    Q_EMIT dataChanged(this->index(index, 0), this->index(index, 0), roles);
+    emitEntryChanged(index, roles);
     updateExistingEntryInDatabase(entry);
     return true;
 }
@@ -313,7 +914,7 @@ void HistoryModel::removeEntryByUrl(const QUrl& url)
         return;
     }
 
-    removeByIndex(getEntryIndex(url));
+    removeByIndex(getEntryIndex(url.toEncoded()));
     removeEntryFromDatabaseByUrl(url);
     Q_EMIT rowCountChanged();
 }
@@ -327,11 +928,47 @@ void HistoryModel::removeEntriesByDate(const QDate& date)
         return;
     }
 
+    // The views of the affected domains are reset at once
+    qint32 day = date.toJulianDay();
+    QSet<QString> domains;
+    Q_FOREACH(const HistoryEntry& entry, m_entries) {
+        if (entry.lastVisitDate == day) {
+            domains.insert(entry.domain);
+        }
+    }
+    QList<HistoryDomainModel*> models;
+    Q_FOREACH(const QString& domain, domains) {
+        models.append(m_domainModels.values(domain));
+    }
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->beginResetModel();
+    }
     for (int i = m_entries.count() - 1; i >= 0; --i) {
-        if (m_entries.at(i).lastVisit.toLocalTime().date() == date) {
-            removeByIndex(i);
+        if (entryAt(i).lastVisitDate == day) {
+            beginRemoveRows(QModelIndex(), i, i);
+            int position = m_entries.count() - 1 - i;
+            m_urlIndex.remove(m_entries.at(position).url);
+            m_entries.remove(position);
+            endRemoveRows();
+        }
+    }
+    rebuildUrlIndex();
+    Q_FOREACH(const QString& domain, domains) {
+        QVector<QByteArray> urls;
+        Q_FOREACH(const QByteArray& url, m_domainIndex.value(domain)) {
+            if (m_urlIndex.contains(url)) {
+                urls.append(url);
+            }
+        }
+        if (urls.isEmpty()) {
+            m_domainIndex.remove(domain);
+        } else {
+            m_domainIndex.insert(domain, urls);
         }
     }
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->endResetModel();
+    }
     removeEntriesFromDatabaseByDate(date);
     Q_EMIT rowCountChanged();
 }
@@ -345,11 +982,24 @@ void HistoryModel::removeEntriesByDomain(const QString& domain)
         return;
     }
 
+    QList<HistoryDomainModel*> models = m_domainModels.values(domain);
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->beginResetModel();
+    }
     for (int i = m_entries.count() - 1; i >= 0; --i) {
-        if (m_entries.at(i).domain == domain) {
-            removeByIndex(i);
+        if (entryAt(i).domain == domain) {
+            beginRemoveRows(QModelIndex(), i, i);
+            int position = m_entries.count() - 1 - i;
+            m_urlIndex.remove(m_entries.at(position).url);
+            m_entries.remove(position);
+            endRemoveRows();
         }
     }
+    rebuildUrlIndex();
+    m_domainIndex.remove(domain);
+    Q_FOREACH(HistoryDomainModel* model, models) {
+        model->endResetModel();
+    }
     removeEntriesFromDatabaseByDomain(domain);
     Q_EMIT rowCountChanged();
 }
@@ -357,8 +1007,29 @@ void HistoryModel::removeEntriesByDomain(const QString& domain)
 void HistoryModel::removeByIndex(int index)
 {
     if (index >= 0) {
+        int position = m_entries.count() - 1 - index;
+        const HistoryEntry& entry = m_entries.at(position);
+        QString domain = entry.domain;
+        const QVector<QByteArray>& urls = m_domainIndex[domain];
+        int domainPosition = domainEntryPosition(urls, entry.url);
+        int domainRow = urls.count() - 1 - domainPosition;
+        QList<HistoryDomainModel*> models = m_domainModels.values(domain);
         beginRemoveRows(QModelIndex(), index, index);
-        m_entries.removeAt(index);
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            model->beginRemoveRows(QModelIndex(), domainRow, domainRow);
+        }
+        m_urlIndex.remove(entry.url);
+        m_entries.remove(position);
+        if (index < position) {
+            indexPositions(position, m_entries.count() - 1);
+        } else {
+            --m_urlIndexOffset;
+            indexPositions(0, position - 1);
+        }
+        removeFromDomainIndex(domain, domainPosition);
+        Q_FOREACH(HistoryDomainModel* model, models) {
+            model->endRemoveRows();
+        }
         endRemoveRows();
     }
 }
@@ -366,11 +1037,13 @@ void HistoryModel::removeByIndex(int index)
 void HistoryModel::insertNewEntryInDatabase(const HistoryEntry& entry)
 {
     QVariantList values;
-    values << entry.url.toString();
+    values << QUrl::fromEncoded(entry.url).toString();
     values << entry.domain;
     values << entry.title;
-    values << entry.icon.toString();
-    values << entry.lastVisit.toTime_t();
+    values << QUrl::fromEncoded(entry.icon).toString();
+    values << uint(entry.visits);
+    values << entry.lastVisit / 1000;
+    values << entry.frecency;
     Q_EMIT m_dbWorker->enqueue(DbWorker::InsertNewEntry, values);
 }
 
@@ -384,13 +1057,23 @@ void HistoryModel::updateExistingEntryInDatabase(const HistoryEntry& entry)
     QVariantList values;
     values << entry.domain;
     values << entry.title;
-    values << entry.icon.toString();
-    values << entry.visits;
-    values << entry.lastVisit.toTime_t();
-    values << entry.url.toString();
+    values << QUrl::fromEncoded(entry.icon).toString();
+    values << uint(entry.visits);
+    values << entry.lastVisit / 1000;
+    values << entry.frecency;
+    values << QUrl::fromEncoded(entry.url).toString();
     Q_EMIT m_dbWorker->enqueue(DbWorker::UpdateExistingEntry, values);
 }
 
+void HistoryModel::insertVisitInDatabase(const HistoryEntry& entry, Transition transition)
+{
+    QVariantList values;
+    values << entry.lastVisit / 1000;
+    values << int(transition);
+    values << QUrl::fromEncoded(entry.url).toString();
+    Q_EMIT m_dbWorker->enqueue(DbWorker::InsertVisit, values);
+}
+
 void HistoryModel::removeEntryFromDatabaseByUrl(const QUrl& url)
 {
     Q_EMIT m_dbWorker->enqueue(DbWorker::RemoveEntryByUrl, QVariantList() << url.toString());
@@ -422,6 +1105,9 @@ void HistoryModel::clearAll()
         beginResetModel();
         m_hiddenEntries.clear();
         m_entries.clear();
+        resetDomainModels();
+        rebuildUrlIndex();
+        m_canFetchMore = false;
         endResetModel();
         clearDatabase();
         Q_EMIT rowCountChanged();
@@ -442,22 +1128,21 @@ void HistoryModel::clearDatabase()
 */
 void HistoryModel::hide(const QUrl& url)
 {
-    if (url.isEmpty() || m_hiddenEntries.contains(url)) {
+    QByteArray encodedUrl = url.toEncoded();
+    if (url.isEmpty() || m_hiddenEntries.contains(encodedUrl)) {
         return;
     }
 
-    m_hiddenEntries.insert(url);
+    m_hiddenEntries.insert(encodedUrl);
 
     QVector<int> roles;
     roles << Hidden;
 
-    for (int i = 0; i < m_entries.count(); ++i) {
-        HistoryEntry& entry = m_entries[i];
-        if (entry.url == url) {
-            entry.hidden = true;
-            Q_EMIT dataChanged(this->index(i, 0), this->index(i, 0), roles);
-        }
-    }                                                                   
+    int index = getEntryIndex(encodedUrl);
+    if (index != -1) {
+        entryAt(index).hidden = true;
+        emitEntryChanged(index, roles);
+    }
 
     insertNewEntryInHiddenDatabase(url);
 }
@@ -470,22 +1155,21 @@ void HistoryModel::hide(const QUrl& url)
 */
 void HistoryModel::unHide(const QUrl& url)
 {
-    if (url.isEmpty() || !m_hiddenEntries.contains(url)) {
+    QByteArray encodedUrl = url.toEncoded();
+    if (url.isEmpty() || !m_hiddenEntries.contains(encodedUrl)) {
         return;
     }
 
-    m_hiddenEntries.remove(url);
+    m_hiddenEntries.remove(encodedUrl);
 
     QVector<int> roles;
     roles << Hidden;
 
-    for (int i = 0; i < m_entries.count(); ++i) {
-        HistoryEntry& entry = m_entries[i];
-        if (entry.url == url) {
-            entry.hidden = false;
-            Q_EMIT dataChanged(this->index(i, 0), this->index(i, 0), roles);
-        }
-    }                                                                   
+    int index = getEntryIndex(encodedUrl);
+    if (index != -1) {
+        entryAt(index).hidden = false;
+        emitEntryChanged(index, roles);
+    }
 
     removeEntryFromHiddenDatabaseByUrl(url);
 }
@@ -505,16 +1189,60 @@ QVariantMap HistoryModel::get(int i) const
     return item;
 }
 
+/*!
+    Asynchronously look up the URLs of the entries whose URL or title contain
+    all the given terms, most visited first.
+    Non-resident entries are considered too.
+    The results are delivered by the urlsMatched() signal along with the
+    request identifier returned by this method.
+*/
+int HistoryModel::matchUrls(const QStringList& terms, int limit)
+{
+    int requestId = ++m_lastMatchRequest;
+    Q_EMIT m_dbWorker->matchUrls(requestId, terms, limit);
+    return requestId;
+}
+
+/*!
+    Remove the entries that are beyond the limits of the retention policy,
+    in the background. This happens automatically when the database is
+    loaded and when the policy changes.
+    The pruned() signal is emitted once done.
+*/
+void HistoryModel::prune()
+{
+    Q_EMIT m_dbWorker->prune();
+}
+
 DbWorker::DbWorker()
     : QObject()
+    , m_pageSize(0)
+    , m_maxAge(0)
+    , m_maxCount(0)
+    , m_maxDatabaseSize(0)
+    , m_prunedCount(0)
+    , m_cursorLastVisit(0)
     , m_flush(nullptr)
+    , m_backfill(nullptr)
+    , m_prune(nullptr)
 {
     // Ensure all database operations are performed on the same thread
     connect(this, SIGNAL(resetDatabase(const QString&)),
             SLOT(doResetDatabase(const QString&)), Qt::QueuedConnection);
-    connect(this, SIGNAL(fetchEntries()),
-            SLOT(doFetchEntries()), Qt::QueuedConnection);
+    connect(this, SIGNAL(fetchEntries(int)),
+            SLOT(doFetchEntries(int)), Qt::QueuedConnection);
+    connect(this, SIGNAL(fetchPage()),
+            SLOT(doFetchPage()), Qt::QueuedConnection);
+    connect(this, SIGNAL(lookupEntry(const QUrl&)),
+            SLOT(doLookupEntry(const QUrl&)), Qt::QueuedConnection);
+    connect(this, SIGNAL(matchUrls(int, const QStringList&, int)),
+            SLOT(doMatchUrls(int, const QStringList&, int)), Qt::QueuedConnection);
+    connect(this, SIGNAL(setRetentionPolicy(int, int, qint64)),
+            SLOT(doSetRetentionPolicy(int, int, qint64)), Qt::QueuedConnection);
+    connect(this, SIGNAL(prune()), SLOT(doPrune()), Qt::QueuedConnection);
     qRegisterMetaType<Operation>("Operation");
+    qRegisterMetaType<QList<QUrl>>("QList<QUrl>");
+    qRegisterMetaType<QVector<HistoryModel::HistoryEntry>>("QVector<HistoryModel::HistoryEntry>");
     connect(this, SIGNAL(enqueue(Operation, QVariantList)),
             SLOT(doEnqueue(Operation, QVariantList)), Qt::QueuedConnection);
 }
@@ -526,7 +1254,18 @@ DbWorker::~DbWorker()
         delete m_flush;
         m_flush = nullptr;
     }
+    if (m_backfill) {
+        m_backfill->stop();
+        delete m_backfill;
+        m_backfill = nullptr;
+    }
+    if (m_prune) {
+        m_prune->stop();
+        delete m_prune;
+        m_prune = nullptr;
+    }
     doFlush();
+    m_preparedQueries.clear();
     if (m_database.isOpen()) {
         m_database.close();
     }
@@ -541,7 +1280,22 @@ void DbWorker::doResetDatabase(const QString& databaseName)
         delete m_flush;
         m_flush = nullptr;
     }
+    if (m_backfill) {
+        m_backfill->stop();
+        delete m_backfill;
+        m_backfill = nullptr;
+    }
+    if (m_prune) {
+        m_prune->stop();
+        delete m_prune;
+        m_prune = nullptr;
+    }
     doFlush();
+    m_preparedQueries.clear();
+    m_existingUrls.clear();
+    m_prunedCount = 0;
+    m_cursorLastVisit = 0;
+    m_cursorUrl.clear();
     if (m_database.isOpen()) {
         m_database.close();
     }
@@ -579,41 +1333,295 @@ void DbWorker::doCreateOrAlterDatabaseSchema()
         addDomainColumnQuery.exec();
         // Updating all the entries in the database to add the domain is a
         // costly operation that would slow down the application startup,
-        // do not do it here.
+        // it is done in the background by doBackfillDomains().
     }
 
     QSqlQuery createHiddenQuery(m_database);
     query = QStringLiteral("CREATE TABLE IF NOT EXISTS history_hidden (url VARCHAR);");
     createHiddenQuery.prepare(query);
     createHiddenQuery.exec();
+
+    migrateDatabaseSchema();
+}
+
+/*
+    Changes to the schema beyond the tables above are applied as numbered
+    migrations, the current version being tracked in the user_version pragma.
+    Each migration runs in its own transaction, and a failed migration is
+    retried the next time the database is opened.
+*/
+void DbWorker::migrateDatabaseSchema()
+{
+    QSqlQuery versionQuery(m_database);
+    versionQuery.exec(QStringLiteral("PRAGMA user_version;"));
+    int version = versionQuery.next() ? versionQuery.value(0).toInt() : 0;
+    versionQuery.finish();
+
+    while (version < SCHEMA_VERSION) {
+        ++version;
+        m_database.transaction();
+        if (!migrateToSchemaVersion(version)) {
+            qWarning() << "Failed to migrate the history database to version" << version;
+            m_database.rollback();
+            return;
+        }
+        QSqlQuery updateVersionQuery(m_database);
+        updateVersionQuery.exec(QStringLiteral("PRAGMA user_version = %1;").arg(version));
+        m_database.commit();
+    }
 }
 
-void DbWorker::doFetchEntries()
+bool DbWorker::migrateToSchemaVersion(int version)
 {
+    QStringList statements;
+    switch (version) {
+    case 1:
+        // Merge duplicate entries into the most recently visited one,
+        // then index the columns used by lookups, sorting and removals.
+        statements << QStringLiteral("UPDATE history SET visits = "
+                                     "(SELECT SUM(h.visits) FROM history h WHERE h.url = history.url) "
+                                     "WHERE url IN (SELECT url FROM history GROUP BY url HAVING COUNT(*) > 1);")
+                   << QStringLiteral("DELETE FROM history WHERE rowid NOT IN "
+                                     "(SELECT rowid FROM (SELECT rowid, MAX(lastVisit) FROM history GROUP BY url));")
+                   << QStringLiteral("DELETE FROM history_hidden WHERE rowid NOT IN "
+                                     "(SELECT MIN(rowid) FROM history_hidden GROUP BY url);")
+                   << QStringLiteral("CREATE UNIQUE INDEX IF NOT EXISTS history_url ON history (url);")
+                   << QStringLiteral("CREATE INDEX IF NOT EXISTS history_lastVisit ON history (lastVisit, url);")
+                   << QStringLiteral("CREATE INDEX IF NOT EXISTS history_domain ON history (domain);")
+                   << QStringLiteral("CREATE UNIQUE INDEX IF NOT EXISTS history_hidden_url ON history_hidden (url);");
+        break;
+    case 2:
+        // Log every visit, and keep a frecency score for each entry. Past
+        // visits were not logged, so existing entries start with a score
+        // as if they had all happened at the time of the last visit.
+        statements << QStringLiteral("CREATE TABLE IF NOT EXISTS visits "
+                                     "(historyId INTEGER, timestamp INTEGER, transition INTEGER);")
+                   << QStringLiteral("CREATE INDEX IF NOT EXISTS visits_historyId ON visits (historyId);")
+                   << QStringLiteral("CREATE TRIGGER IF NOT EXISTS history_visits_delete AFTER DELETE ON history "
+                                     "BEGIN DELETE FROM visits WHERE historyId = old.rowid; END;")
+                   << QStringLiteral("ALTER TABLE history ADD COLUMN frecency REAL;")
+                   << QStringLiteral("UPDATE history SET frecency = visits;")
+                   << QStringLiteral("CREATE INDEX IF NOT EXISTS history_frecency ON history (frecency);");
+        break;
+    case 3:
+        // Drop the full-text index that used to be created when opening the
+        // database: nothing queried it, and its triggers slowed down writes.
+        statements << QStringLiteral("DROP TRIGGER IF EXISTS history_fts_insert;")
+                   << QStringLiteral("DROP TRIGGER IF EXISTS history_fts_delete;")
+                   << QStringLiteral("DROP TRIGGER IF EXISTS history_fts_update;")
+                   << QStringLiteral("DROP TABLE IF EXISTS history_fts;");
+        break;
+    case 4:
+        // Visits refer to their entry by id. Implicit rowids may be
+        // renumbered by a VACUUM (see compactDatabase()), so the table is
+        // rebuilt with an explicit primary key that keeps the same values.
+        statements << QStringLiteral("CREATE TABLE history_new (id INTEGER PRIMARY KEY, url VARCHAR, "
+                                     "domain VARCHAR, title VARCHAR, icon VARCHAR, visits INTEGER, "
+                                     "lastVisit DATETIME, frecency REAL);")
+                   << QStringLiteral("INSERT INTO history_new (id, url, domain, title, icon, visits, "
+                                     "lastVisit, frecency) SELECT rowid, url, domain, title, icon, "
+                                     "visits, lastVisit, frecency FROM history;")
+                   << QStringLiteral("DROP TABLE history;")
+                   << QStringLiteral("ALTER TABLE history_new RENAME TO history;")
+                   << QStringLiteral("CREATE UNIQUE INDEX history_url ON history (url);")
+                   << QStringLiteral("CREATE INDEX history_lastVisit ON history (lastVisit, url);")
+                   << QStringLiteral("CREATE INDEX history_domain ON history (domain);")
+                   << QStringLiteral("CREATE INDEX history_frecency ON history (frecency);")
+                   << QStringLiteral("CREATE TRIGGER history_visits_delete AFTER DELETE ON history "
+                                     "BEGIN DELETE FROM visits WHERE historyId = old.id; END;");
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+    Q_FOREACH(const QString& statement, statements) {
+        QSqlQuery query(m_database);
+        if (!query.exec(statement)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DbWorker::doFetchEntries(int pageSize)
+{
+    m_pageSize = pageSize;
+
     QSqlQuery populateHiddenQuery(m_database);
     QString query = QStringLiteral("SELECT url FROM history_hidden;");
     populateHiddenQuery.prepare(query);
     populateHiddenQuery.exec();
+    QList<QUrl> hiddenUrls;
     while (populateHiddenQuery.next()) {
-        Q_EMIT hiddenEntryFetched(populateHiddenQuery.value(0).toUrl());
+        hiddenUrls.append(populateHiddenQuery.value(0).toUrl());
     }
+    Q_EMIT hiddenEntriesFetched(hiddenUrls);
 
+    // Entries are sorted by URL too when visited at the same time,
+    // so that pages can be fetched with a (lastVisit, url) cursor.
+    // Entries beyond the limits of the retention policy are not loaded,
+    // they are about to be pruned anyway.
+    int limit = m_pageSize;
+    if ((m_maxCount > 0) && ((limit == 0) || (m_maxCount < limit))) {
+        limit = m_maxCount;
+    }
     QSqlQuery populateQuery(m_database);
-    query = QStringLiteral("SELECT url, domain, title, icon, visits, lastVisit "
-                           "FROM history ORDER BY lastVisit DESC;");
+    query = QStringLiteral("SELECT url, domain, title, icon, visits, lastVisit, frecency FROM history");
+    if (m_maxAge > 0) {
+        query.append(QStringLiteral(" WHERE lastVisit >= ?"));
+    }
+    query.append(QStringLiteral(" ORDER BY lastVisit DESC, url DESC"));
+    if (limit > 0) {
+        query.append(QStringLiteral(" LIMIT ?"));
+    }
     populateQuery.prepare(query);
-    populateQuery.exec();
-    while (populateQuery.next()) {
-        Q_EMIT entryFetched(populateQuery.value(0).toUrl(),
-                            populateQuery.value(1).toString(),
-                            populateQuery.value(2).toString(),
-                            populateQuery.value(3).toUrl(),
-                            populateQuery.value(4).toInt(),
-                            QDateTime::fromTime_t(populateQuery.value(5).toInt()));
+    if (m_maxAge > 0) {
+        populateQuery.addBindValue(QDateTime::currentDateTimeUtc().addDays(-m_maxAge).toTime_t());
+    }
+    if (limit > 0) {
+        populateQuery.addBindValue(limit);
     }
+    populateQuery.exec();
+    int count = fetchChunks(populateQuery);
+    Q_EMIT pageFetched((m_pageSize > 0) && (limit == m_pageSize) && (count == m_pageSize));
     Q_EMIT loaded();
+
+    if (!m_backfill) {
+        m_backfill = new QTimer;
+        m_backfill->setInterval(500);
+        m_backfill->setSingleShot(true);
+        connect(m_backfill, SIGNAL(timeout()), SLOT(doBackfillDomains()));
+    }
+    m_backfill->start();
+    doPrune();
 }
 
+void DbWorker::doFetchPage()
+{
+    // Pending removals must not bring back entries in the next page
+    doFlush();
+
+    // As when loading, entries beyond the limits of the retention policy
+    // are not fetched: pages stop at the maxCount-th entry of the database
+    // (which may hold entries added since the first page was fetched).
+    int limit = m_pageSize;
+    if (m_maxCount > 0) {
+        QSqlQuery rankQuery(m_database);
+        rankQuery.prepare(QStringLiteral("SELECT COUNT(*) FROM history WHERE lastVisit > ? OR "
+                                         "(lastVisit = ? AND url >= ?);"));
+        rankQuery.addBindValue(m_cursorLastVisit);
+        rankQuery.addBindValue(m_cursorLastVisit);
+        rankQuery.addBindValue(m_cursorUrl);
+        if (rankQuery.exec() && rankQuery.next()) {
+            limit = qMin(limit, m_maxCount - rankQuery.value(0).toInt());
+        }
+    }
+    if (limit <= 0) {
+        Q_EMIT pageFetched(false);
+        return;
+    }
+
+    QSqlQuery pageQuery(m_database);
+    QString query = QStringLiteral("SELECT url, domain, title, icon, visits, lastVisit, frecency "
+                                   "FROM history WHERE (lastVisit < ? OR "
+                                   "(lastVisit = ? AND url < ?))");
+    if (m_maxAge > 0) {
+        query.append(QStringLiteral(" AND lastVisit >= ?"));
+    }
+    query.append(QStringLiteral(" ORDER BY lastVisit DESC, url DESC LIMIT ?;"));
+    pageQuery.prepare(query);
+    pageQuery.addBindValue(m_cursorLastVisit);
+    pageQuery.addBindValue(m_cursorLastVisit);
+    pageQuery.addBindValue(m_cursorUrl);
+    if (m_maxAge > 0) {
+        pageQuery.addBindValue(QDateTime::currentDateTimeUtc().addDays(-m_maxAge).toTime_t());
+    }
+    pageQuery.addBindValue(limit);
+    pageQuery.exec();
+    int count = fetchChunks(pageQuery);
+    Q_EMIT pageFetched((limit == m_pageSize) && (count == m_pageSize));
+}
+
+int DbWorker::fetchChunks(QSqlQuery& query)
+{
+    int count = 0;
+    QVector<HistoryModel::HistoryEntry> entries;
+    entries.reserve(FETCH_CHUNK_SIZE);
+    while (query.next()) {
+        HistoryModel::HistoryEntry entry;
+        QUrl url = query.value(0).toUrl();
+        entry.url = url.toEncoded();
+        entry.domain = query.value(1).toString();
+        if (entry.domain.isEmpty()) {
+            // Not backfilled yet, see doBackfillDomains()
+            entry.domain = DomainUtils::extractTopLevelDomainName(url);
+        }
+        entry.title = query.value(2).toString();
+        entry.icon = query.value(3).toUrl().toEncoded();
+        entry.visits = query.value(4).toUInt();
+        entry.lastVisit = query.value(5).toLongLong() * 1000;
+        entry.lastVisitDate = localDate(entry.lastVisit);
+        entry.hidden = false;
+        entry.frecency = query.value(6).toDouble();
+        entries.append(entry);
+        m_cursorLastVisit = query.value(5).toLongLong();
+        m_cursorUrl = query.value(0).toString();
+        if (entries.count() == FETCH_CHUNK_SIZE) {
+            Q_EMIT entriesFetched(entries);
+            entries.clear();
+            entries.reserve(FETCH_CHUNK_SIZE);
+        }
+        ++count;
+    }
+    Q_EMIT entriesFetched(entries);
+    return count;
+}
+
+/*
+    Look up an entry that is not resident in the model. If it exists, the
+    insertion that follows is turned into an update (see doEnqueue()), and
+    the stored visits count is reported back to the model.
+*/
+void DbWorker::doLookupEntry(const QUrl& url)
+{
+    doFlush();
+    QSqlQuery* query = preparedQuery(QStringLiteral("SELECT visits, frecency, lastVisit "
+                                                    "FROM history WHERE url=?;"));
+    if (!query) {
+        return;
+    }
+    query->bindValue(0, url.toString());
+    if (query->exec() && query->next()) {
+        int visits = query->value(0).toInt();
+        double frecency = decayFrecency(query->value(1).toDouble(), query->value(2).toLongLong() * 1000,
+                                        QDateTime::currentMSecsSinceEpoch());
+        m_existingUrls.insert(url.toString());
+        Q_EMIT entryLookedUp(url, visits, frecency);
+    }
+    query->finish();
+}
+
+/*
+    Pending operations are flushed first so that the results reflect the
+    state of the model.
+*/
+void DbWorker::doMatchUrls(int requestId, const QStringList& terms, int limit)
+{
+    doFlush();
+    QList<QUrl> urls = FullTextSearch::matchUrls(m_database, QStringLiteral("history"),
+                                                 terms, limit,
+                                                 QStringLiteral("visits DESC, lastVisit DESC"));
+    Q_EMIT urlsMatched(requestId, urls);
+}
+
+/*
+    The pending queue is a write-behind buffer keyed by URL: redundant
+    operations on the same entry are merged before they hit the disk.
+    Successive updates of an entry overwrite each other, an update is folded
+    into a pending insertion, an insertion followed by a removal cancels out,
+    and clearing a table discards everything queued for it before.
+    Cancelled operations stay in the queue with no values (and are skipped
+    when flushing) so that the positions recorded in the keys remain valid.
+*/
 void DbWorker::doEnqueue(DbWorker::Operation operation, QVariantList values)
 {
     if (!m_flush) {
@@ -623,27 +1631,138 @@ void DbWorker::doEnqueue(DbWorker::Operation operation, QVariantList values)
         connect(m_flush, SIGNAL(timeout()), SLOT(doFlush()));
     }
     QWriteLocker locker(&m_lock);
-    m_pending.enqueue(qMakePair(operation, values));
     m_flush->start();
+    if ((operation == InsertNewEntry) && m_existingUrls.remove(values.first().toString())) {
+        // Already on disk although not resident in the model
+        operation = UpdateExistingEntry;
+        values.append(values.takeFirst());
+    }
+    switch (operation) {
+    case InsertNewEntry:
+        m_pendingEntries.insert(values.first().toString(), m_pending.count());
+        break;
+    case InsertNewHiddenEntry:
+        m_pendingHiddenEntries.insert(values.first().toString(), m_pending.count());
+        break;
+    case UpdateExistingEntry: {
+        QString url = values.last().toString();
+        QHash<QString, int>::const_iterator i = m_pendingEntries.constFind(url);
+        if (i != m_pendingEntries.constEnd()) {
+            QPair<Operation, QVariantList>& pending = m_pending[i.value()];
+            if (pending.first == InsertNewEntry) {
+                // Same values, except for the URL that comes first
+                values.prepend(values.takeLast());
+            }
+            pending.second = values;
+            return;
+        }
+        m_pendingEntries.insert(url, m_pending.count());
+        break;
+    }
+    case RemoveEntryByUrl: {
+        QHash<QString, int>::iterator i = m_pendingEntries.find(values.first().toString());
+        if (i != m_pendingEntries.end()) {
+            int index = i.value();
+            m_pendingEntries.erase(i);
+            cancelPending(index);
+            if (m_pending.at(index).first == InsertNewEntry) {
+                // The entry never made it to the disk
+                return;
+            }
+        }
+        break;
+    }
+    case RemoveHiddenEntryByUrl: {
+        QHash<QString, int>::iterator i = m_pendingHiddenEntries.find(values.first().toString());
+        if (i != m_pendingHiddenEntries.end()) {
+            cancelPending(i.value());
+            m_pendingHiddenEntries.erase(i);
+            return;
+        }
+        break;
+    }
+    case RemoveEntriesByDate:
+    case RemoveEntriesByDomain:
+        // The removal may match entries queued before it, so operations
+        // queued after it must not be merged into those.
+        m_pendingEntries.clear();
+        break;
+    case Clear: {
+        bool hidden = (values.first().toString() == QStringLiteral("history_hidden"));
+        for (int i = 0; i < m_pending.count(); ++i) {
+            if (!m_pending.at(i).second.isEmpty() && (isHiddenOperation(m_pending.at(i)) == hidden)) {
+                cancelPending(i);
+            }
+        }
+        if (hidden) {
+            m_pendingHiddenEntries.clear();
+        } else {
+            m_pendingEntries.clear();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    m_pending.enqueue(qMakePair(operation, values));
+}
+
+bool DbWorker::isHiddenOperation(const QPair<Operation, QVariantList>& operation)
+{
+    switch (operation.first) {
+    case InsertNewHiddenEntry:
+    case RemoveHiddenEntryByUrl:
+        return true;
+    case Clear:
+        return (operation.second.first().toString() == QStringLiteral("history_hidden"));
+    default:
+        return false;
+    }
+}
+
+void DbWorker::cancelPending(int index)
+{
+    m_pending[index].second.clear();
 }
 
+/*
+    All pending operations are executed in a single transaction, so that a
+    burst of changes costs one journal sync instead of one per statement.
+    The number of operations and the time spent (in microseconds) are
+    reported through the flushed() signal.
+*/
 void DbWorker::doFlush()
 {
     QWriteLocker locker(&m_lock);
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    int count = 0;
+    bool transaction = m_database.transaction();
     while (!m_pending.isEmpty()) {
         QPair<Operation, QVariantList> args = m_pending.dequeue();
+        if (args.second.isEmpty()) {
+            // cancelled by a subsequent operation
+            continue;
+        }
         QString statement;
         switch (args.first) {
         case InsertNewEntry:
-            statement = QStringLiteral("INSERT INTO history (url, domain, title, icon, "
-                                       "visits, lastVisit) VALUES (?, ?, ?, ?, 1, ?);");
+            statement = QStringLiteral("INSERT OR IGNORE INTO history (url, domain, title, icon, "
+                                       "visits, lastVisit, frecency) VALUES (?, ?, ?, ?, ?, ?, ?);");
             break;
         case InsertNewHiddenEntry:
-            statement = QStringLiteral("INSERT INTO history_hidden (url) VALUES (?);");
+            statement = QStringLiteral("INSERT OR IGNORE INTO history_hidden (url) VALUES (?);");
+            break;
+        case InsertVisit:
+            statement = QStringLiteral("INSERT INTO visits (historyId, timestamp, transition) "
+                                       "SELECT id, ?, ? FROM history WHERE url=?;");
             break;
         case UpdateExistingEntry:
             statement = QStringLiteral("UPDATE history SET domain=?, title=?, icon=?, "
-                                       "visits=?, lastVisit=? WHERE url=?;");
+                                       "visits=?, lastVisit=?, frecency=? WHERE url=?;");
             break;
         case RemoveEntryByUrl:
             statement = QStringLiteral("DELETE FROM history WHERE url=?;");
@@ -663,16 +1782,246 @@ void DbWorker::doFlush()
         default:
             Q_UNREACHABLE();
         }
-        if (statement.isEmpty()) {
+        QSqlQuery* query = preparedQuery(statement);
+        if (!query) {
+            continue;
+        }
+        for (int i = 0; i < args.second.count(); ++i) {
+            query->bindValue(i, args.second.at(i));
+        }
+        query->exec();
+        if ((args.first == UpdateExistingEntry) && (query->numRowsAffected() == 0)) {
+            // The entry was pruned in the meantime, write it back
+            QVariantList values = args.second;
+            values.prepend(values.takeLast());
+            m_pending.prepend(qMakePair(InsertNewEntry, values));
+        } else if ((args.first == InsertNewEntry) && (query->numRowsAffected() == 0)) {
+            // The entry is already in the database (not resident in the
+            // model), update it in place: replacing the row would delete
+            // it first, and its visits along with it.
+            QVariantList values = args.second;
+            values.append(values.takeFirst());
+            m_pending.prepend(qMakePair(UpdateExistingEntry, values));
+        }
+        ++count;
+    }
+    m_pendingEntries.clear();
+    m_pendingHiddenEntries.clear();
+    if (transaction) {
+        m_database.commit();
+    }
+    Q_EMIT flushed(count, timer.nsecsElapsed() / 1000);
+}
+
+/*
+    The first version of the database schema didn't have a 'domain' column.
+    Entries missing it are updated in small batches, each in a transaction,
+    whenever the worker is idle (i.e. no write operations are pending).
+    The progress is thus persisted in the database itself, and the backfill
+    resumes where it left off the next time the database is opened.
+*/
+void DbWorker::doBackfillDomains()
+{
+    {
+        QReadLocker locker(&m_lock);
+        if (!m_pending.isEmpty()) {
+            m_backfill->start();
             return;
         }
+    }
+
+    QSqlQuery selectQuery(m_database);
+    QString query = QStringLiteral("SELECT rowid, url FROM history "
+                                   "WHERE domain IS NULL OR domain = '' LIMIT ?;");
+    selectQuery.prepare(query);
+    selectQuery.addBindValue(BACKFILL_BATCH_SIZE);
+    selectQuery.exec();
+    QList<QPair<qint64, QString>> domains;
+    while (selectQuery.next()) {
+        QUrl url = selectQuery.value(1).toUrl();
+        domains.append(qMakePair(selectQuery.value(0).toLongLong(),
+                                 DomainUtils::extractTopLevelDomainName(url)));
+    }
+    selectQuery.finish();
+    if (domains.isEmpty()) {
+        return;
+    }
+
+    QSqlQuery* updateQuery = preparedQuery(QStringLiteral("UPDATE history SET domain=? WHERE rowid=?;"));
+    if (!updateQuery) {
+        return;
+    }
+    bool transaction = m_database.transaction();
+    for (int i = 0; i < domains.count(); ++i) {
+        updateQuery->bindValue(0, domains.at(i).second);
+        updateQuery->bindValue(1, domains.at(i).first);
+        updateQuery->exec();
+    }
+    if (transaction) {
+        m_database.commit();
+    }
+    if (domains.count() == BACKFILL_BATCH_SIZE) {
+        m_backfill->start();
+    }
+}
+
+void DbWorker::doSetRetentionPolicy(int maxAge, int maxCount, qint64 maxDatabaseSize)
+{
+    m_maxAge = maxAge;
+    m_maxCount = maxCount;
+    m_maxDatabaseSize = maxDatabaseSize;
+    if (m_database.isOpen()) {
+        doPrune();
+    }
+}
+
+void DbWorker::doPrune()
+{
+    if ((m_maxAge == 0) && (m_maxCount == 0) && (m_maxDatabaseSize == 0)) {
+        return;
+    }
+    if (!m_prune) {
+        m_prune = new QTimer;
+        m_prune->setInterval(0);
+        m_prune->setSingleShot(true);
+        connect(m_prune, SIGNAL(timeout()), SLOT(doPruneBatch()));
+    }
+    m_prune->start();
+}
+
+/*
+    Entries are pruned oldest first, in batches of PRUNE_BATCH_SIZE, each of
+    them in a transaction, and the worker goes back to its event loop in
+    between so that other requests are not delayed. For each batch the model
+    is told the (lastVisit, url) key of the most recent entry removed, so that
+    it can drop all the entries up to it at once.
+    Once done, the free pages are returned to the file system.
+*/
+void DbWorker::doPruneBatch()
+{
+    doFlush();
+    int count = qMin(countEntriesToPrune(), PRUNE_BATCH_SIZE);
+    if (count == 0) {
+        if (m_prunedCount > 0) {
+            compactDatabase();
+        }
+        Q_EMIT pruned(m_prunedCount);
+        m_prunedCount = 0;
+        return;
+    }
+
+    QSqlQuery keyQuery(m_database);
+    keyQuery.prepare(QStringLiteral("SELECT lastVisit, url FROM history "
+                                    "ORDER BY lastVisit ASC, url ASC LIMIT 1 OFFSET ?;"));
+    keyQuery.addBindValue(count - 1);
+    if (!keyQuery.exec() || !keyQuery.next()) {
+        return;
+    }
+    qint64 lastVisit = keyQuery.value(0).toLongLong();
+    QString url = keyQuery.value(1).toString();
+    keyQuery.finish();
+
+    QSqlQuery deleteQuery(m_database);
+    deleteQuery.prepare(QStringLiteral("DELETE FROM history WHERE lastVisit < ? "
+                                       "OR (lastVisit = ? AND url <= ?);"));
+    deleteQuery.addBindValue(lastVisit);
+    deleteQuery.addBindValue(lastVisit);
+    deleteQuery.addBindValue(url);
+    bool transaction = m_database.transaction();
+    bool removed = deleteQuery.exec();
+    if (transaction) {
+        m_database.commit();
+    }
+    if (!removed) {
+        qWarning() << "Failed to prune the history database";
+        Q_EMIT pruned(m_prunedCount);
+        m_prunedCount = 0;
+        return;
+    }
+    m_prunedCount += deleteQuery.numRowsAffected();
+    Q_EMIT entriesPruned(lastVisit, url.toUtf8());
+    m_prune->start();
+}
+
+int DbWorker::countEntriesToPrune()
+{
+    int count = 0;
+    if (m_maxAge > 0) {
         QSqlQuery query(m_database);
-        if (!query.prepare(statement)) {
-            continue;
+        query.prepare(QStringLiteral("SELECT COUNT(*) FROM history WHERE lastVisit < ?;"));
+        query.addBindValue(QDateTime::currentDateTimeUtc().addDays(-m_maxAge).toTime_t());
+        if (query.exec() && query.next()) {
+            count = qMax(count, query.value(0).toInt());
         }
-        Q_FOREACH(const QVariant& value, args.second) {
-            query.addBindValue(value);
+    }
+    if (m_maxCount > 0) {
+        QSqlQuery query(m_database);
+        if (query.exec(QStringLiteral("SELECT COUNT(*) FROM history;")) && query.next()) {
+            count = qMax(count, query.value(0).toInt() - m_maxCount);
+        }
+    }
+    if ((m_maxDatabaseSize > 0) && (databaseSize() > m_maxDatabaseSize)) {
+        // The size freed by removing entries cannot be predicted,
+        // so it is checked again after each batch.
+        count = qMax(count, PRUNE_BATCH_SIZE);
+    }
+    return count;
+}
+
+/*
+    The size of the data in the database, not counting free pages.
+*/
+qint64 DbWorker::databaseSize()
+{
+    QSqlQuery query(m_database);
+    qint64 pageSize = 0;
+    if (query.exec(QStringLiteral("PRAGMA page_size;")) && query.next()) {
+        pageSize = query.value(0).toLongLong();
+    }
+    qint64 pageCount = 0;
+    if (query.exec(QStringLiteral("PRAGMA page_count;")) && query.next()) {
+        pageCount = query.value(0).toLongLong();
+    }
+    if (query.exec(QStringLiteral("PRAGMA freelist_count;")) && query.next()) {
+        pageCount -= query.value(0).toLongLong();
+    }
+    return pageCount * pageSize;
+}
+
+/*
+    Databases created before pruning was introduced don't support incremental
+    vacuuming, they are converted (with a full VACUUM) the first time.
+*/
+void DbWorker::compactDatabase()
+{
+    m_preparedQueries.clear();
+    QSqlQuery query(m_database);
+    int mode = 0;
+    if (query.exec(QStringLiteral("PRAGMA auto_vacuum;")) && query.next()) {
+        mode = query.value(0).toInt();
+    }
+    query.finish();
+    if (mode == 2) {
+        // Pages are freed one step at a time
+        query.exec(QStringLiteral("PRAGMA incremental_vacuum;"));
+        while (query.next()) {}
+    } else {
+        query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL;"));
+        if (!query.exec(QStringLiteral("VACUUM;"))) {
+            qWarning() << "Failed to compact the history database";
+        }
+    }
+}
+
+QSqlQuery* DbWorker::preparedQuery(const QString& statement)
+{
+    QHash<QString, QSqlQuery>::iterator i = m_preparedQueries.find(statement);
+    if (i == m_preparedQueries.end()) {
+        QSqlQuery query(m_database);
+        if (!query.prepare(statement)) {
+            return nullptr;
         }
-        query.exec();
+        i = m_preparedQueries.insert(statement, query);
     }
+    return &i.value();
 }
@@ -21,21 +21,27 @@
 
 // Qt
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QByteArray>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QPair>
 #include <QtCore/QQueue>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QSet>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 #include <QtCore/QThread>
 #include <QtCore/QUrl>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
 #include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
 
 class QTimer;
 
 class DbWorker;
+class HistoryDomainModel;
 
 class HistoryModel : public QAbstractListModel
 {
@@ -43,8 +49,13 @@ class HistoryModel : public QAbstractListModel
 
     Q_PROPERTY(QString databasePath READ databasePath WRITE setDatabasePath NOTIFY databasePathChanged)
     Q_PROPERTY(int count READ rowCount NOTIFY rowCountChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+    Q_PROPERTY(int maxAge READ maxAge WRITE setMaxAge NOTIFY maxAgeChanged)
+    Q_PROPERTY(int maxCount READ maxCount WRITE setMaxCount NOTIFY maxCountChanged)
+    Q_PROPERTY(qint64 maxDatabaseSize READ maxDatabaseSize WRITE setMaxDatabaseSize NOTIFY maxDatabaseSizeChanged)
 
     Q_ENUMS(Roles)
+    Q_ENUMS(Transition)
 
 public:
     HistoryModel(QObject* parent=0);
@@ -60,17 +71,37 @@ public:
         LastVisitDate,
         LastVisitDateString,
         Hidden,
+        Frecency,
+    };
+
+    enum Transition {
+        Link,
+        Typed,
+        Bookmark,
     };
 
     // reimplemented from QAbstractListModel
     QHash<int, QByteArray> roleNames() const;
     int rowCount(const QModelIndex& parent=QModelIndex()) const;
     QVariant data(const QModelIndex& index, int role) const;
+    bool canFetchMore(const QModelIndex& parent=QModelIndex()) const;
+    void fetchMore(const QModelIndex& parent=QModelIndex());
 
     const QString databasePath() const;
     void setDatabasePath(const QString& path);
 
-    Q_INVOKABLE int add(const QUrl& url, const QString& title, const QUrl& icon);
+    int pageSize() const;
+    void setPageSize(int pageSize);
+
+    int maxAge() const;
+    void setMaxAge(int maxAge);
+    int maxCount() const;
+    void setMaxCount(int maxCount);
+    qint64 maxDatabaseSize() const;
+    void setMaxDatabaseSize(qint64 maxDatabaseSize);
+
+    Q_INVOKABLE int add(const QUrl& url, const QString& title, const QUrl& icon,
+                        Transition transition=Link);
     Q_INVOKABLE bool update(const QUrl& url, const QString& title, const QUrl& icon);
     Q_INVOKABLE void removeEntryByUrl(const QUrl& url);
     Q_INVOKABLE void removeEntriesByDate(const QDate& date);
@@ -79,44 +110,101 @@ public:
     Q_INVOKABLE void hide(const QUrl& url);
     Q_INVOKABLE void unHide(const QUrl& url);
     Q_INVOKABLE QVariantMap get(int index) const;
+    Q_INVOKABLE int matchUrls(const QStringList& terms, int limit);
+    Q_INVOKABLE void prune();
+    Q_INVOKABLE void refreshFrecency();
+
+    QStringList domains() const;
+    int domainEntryCount(const QString& domain) const;
+    int domainEntryRow(const QString& domain, int index) const;
+
+    // URLs are stored encoded, and converted to QUrl on demand only.
+    // Domains are interned (see internDomain()), and timestamps are in
+    // milliseconds since the epoch. The local date of the last visit is
+    // cached as a julian day.
+    struct HistoryEntry {
+        QByteArray url;
+        QString domain;
+        QString title;
+        QByteArray icon;
+        qint64 lastVisit;
+        qint32 lastVisitDate;
+        double frecency;
+        quint32 visits : 31;
+        quint32 hidden : 1;
+    };
 
 Q_SIGNALS:
     void databasePathChanged() const;
     void rowCountChanged();
+    void pageSizeChanged() const;
+    void maxAgeChanged() const;
+    void maxCountChanged() const;
+    void maxDatabaseSizeChanged() const;
+    void pruned(int count) const;
     void loaded() const;
+    void databaseFlushed(int operationCount, qint64 duration) const;
+    void urlsMatched(int requestId, const QList<QUrl>& urls) const;
 
 protected:
-    struct HistoryEntry {
-        QUrl url;
-        QString domain;
-        QString title;
-        QUrl icon;
-        uint visits;
-        QDateTime lastVisit;
-        bool hidden;
-    };
-    QList<HistoryEntry> m_entries;
-    int getEntryIndex(const QUrl& url) const;
+    QVector<HistoryEntry> m_entries;
+    int getEntryIndex(const QByteArray& url) const;
+    void indexPositions(int first, int last);
+    void rebuildUrlIndex();
+    HistoryEntry& entryAt(int row);
+    const HistoryEntry& entryAt(int row) const;
+    QString internDomain(const QString& domain);
     void updateExistingEntryInDatabase(const HistoryEntry& entry);
 
 private Q_SLOTS:
-    void onHiddenEntryFetched(const QUrl& url);
-    void onEntryFetched(const QUrl& url, const QString& domain, const QString& title,
-                        const QUrl& icon, int visits, const QDateTime& lastVisit);
+    void onHiddenEntriesFetched(const QList<QUrl>& urls);
+    void onEntriesFetched(const QVector<HistoryModel::HistoryEntry>& entries);
+    void onPageFetched(bool canFetchMore);
+    void onEntryLookedUp(const QUrl& url, int visits, double frecency);
+    void onEntriesPruned(qint64 lastVisit, const QByteArray& url);
+    void checkTimeZone();
 
 private:
+    friend class HistoryDomainModel;
+
     QString m_databasePath;
-    QSet<QUrl> m_hiddenEntries;
+    int m_pageSize;
+    int m_maxAge;
+    int m_maxCount;
+    qint64 m_maxDatabaseSize;
+    bool m_canFetchMore;
+    bool m_fetchingMore;
+    QSet<QByteArray> m_hiddenEntries;
+    QHash<QString, QVector<QByteArray>> m_domainIndex;
+    QMultiHash<QString, HistoryDomainModel*> m_domainModels;
+    QHash<QByteArray, int> m_urlIndex;
+    int m_urlIndexOffset;
+    int m_lastMatchRequest;
+    QByteArray m_timeZoneId;
+    QTimer* m_timeZoneCheck;
+    qint64 m_frecencyReferenceTime;
+    QTimer* m_frecencyRefresh;
+    mutable QHash<qint32, QString> m_dateStrings;
 
     void resetDatabase(const QString& databaseName);
     void removeByIndex(int index);
+    int domainEntryPosition(const QVector<QByteArray>& urls, const QByteArray& url) const;
+    int domainRow(const HistoryEntry& entry) const;
+    void removeFromDomainIndex(const QString& domain, int position, int count=1);
+    void emitEntryChanged(int row, const QVector<int>& roles);
+    void resetDomainModels();
+    void registerDomainModel(HistoryDomainModel* model);
+    void unregisterDomainModel(HistoryDomainModel* model);
+    static bool isPruned(const HistoryEntry& entry, qint64 lastVisit, const QByteArray& url);
     void insertNewEntryInDatabase(const HistoryEntry& entry);
     void insertNewEntryInHiddenDatabase(const QUrl& url);
+    void insertVisitInDatabase(const HistoryEntry& entry, Transition transition);
     void removeEntryFromDatabaseByUrl(const QUrl& url);
     void removeEntryFromHiddenDatabaseByUrl(const QUrl& url);
     void removeEntriesFromDatabaseByDate(const QDate& date);
     void removeEntriesFromDatabaseByDomain(const QString& domain);
     void clearDatabase();
+    void updateRetentionPolicy();
 
     QThread m_dbWorkerThread;
     DbWorker* m_dbWorker;
@@ -134,6 +222,7 @@ public:
     enum Operation {
         InsertNewEntry,
         InsertNewHiddenEntry,
+        InsertVisit,
         UpdateExistingEntry,
         RemoveEntryByUrl,
         RemoveHiddenEntryByUrl,
@@ -144,25 +233,68 @@ public:
 
 Q_SIGNALS:
     void resetDatabase(const QString& databaseName);
-    void fetchEntries();
-    void hiddenEntryFetched(const QUrl& url);
-    void entryFetched(const QUrl& url, const QString& domain, const QString& title,
-                      const QUrl& icon, int visits, const QDateTime& lastVisit);
+    void fetchEntries(int pageSize);
+    void fetchPage();
+    void lookupEntry(const QUrl& url);
+    void matchUrls(int requestId, const QStringList& terms, int limit);
+    void setRetentionPolicy(int maxAge, int maxCount, qint64 maxDatabaseSize);
+    void prune();
+    void hiddenEntriesFetched(const QList<QUrl>& urls);
+    void entriesFetched(const QVector<HistoryModel::HistoryEntry>& entries);
+    void pageFetched(bool canFetchMore);
+    void entryLookedUp(const QUrl& url, int visits, double frecency);
+    void urlsMatched(int requestId, const QList<QUrl>& urls);
+    void entriesPruned(qint64 lastVisit, const QByteArray& url);
+    void pruned(int count);
     void loaded();
     void enqueue(Operation operation, QVariantList values);
+    void flushed(int operationCount, qint64 duration);
 
 private Q_SLOTS:
     void doResetDatabase(const QString& databaseName);
     void doCreateOrAlterDatabaseSchema();
-    void doFetchEntries();
+    void doFetchEntries(int pageSize);
+    void doFetchPage();
+    void doLookupEntry(const QUrl& url);
+    void doMatchUrls(int requestId, const QStringList& terms, int limit);
     void doEnqueue(Operation operation, QVariantList values);
     void doFlush();
+    void doBackfillDomains();
+    void doSetRetentionPolicy(int maxAge, int maxCount, qint64 maxDatabaseSize);
+    void doPrune();
+    void doPruneBatch();
 
 private:
+    QSqlQuery* preparedQuery(const QString& statement);
+    void migrateDatabaseSchema();
+    bool migrateToSchemaVersion(int version);
+    int fetchChunks(QSqlQuery& query);
+    static bool isHiddenOperation(const QPair<Operation, QVariantList>& operation);
+    void cancelPending(int index);
+    int countEntriesToPrune();
+    qint64 databaseSize();
+    void compactDatabase();
+
     QSqlDatabase m_database;
+    QHash<QString, QSqlQuery> m_preparedQueries;
     QReadWriteLock m_lock;
     QQueue<QPair<Operation, QVariantList>> m_pending;
+    QHash<QString, int> m_pendingEntries;
+    QHash<QString, int> m_pendingHiddenEntries;
+    QSet<QString> m_existingUrls;
+    int m_pageSize;
+    int m_maxAge;
+    int m_maxCount;
+    qint64 m_maxDatabaseSize;
+    int m_prunedCount;
+    qint64 m_cursorLastVisit;
+    QString m_cursorUrl;
     QTimer* m_flush;
+    QTimer* m_backfill;
+    QTimer* m_prune;
 };
 
+Q_DECLARE_TYPEINFO(HistoryModel::HistoryEntry, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(QVector<HistoryModel::HistoryEntry>)
+
 #endif // __HISTORY_MODEL_H__
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "history-model.h"
+#include "history-topsites-model.h"
+
+// std
+#include <algorithm>
+
+#define DEFAULT_LIMIT 10
+
+/*!
+    \class HistoryTopSitesModel
+    \brief List model that exposes the most relevant entries of a history
+           model
+
+    HistoryTopSitesModel exposes the entries of a history model that have the
+    highest frecency scores (up to limit), best first, with the same roles.
+    Hidden entries are excluded.
+
+    Only the top sites are tracked: the history model is scanned once, then
+    the entries that are added or changed are checked against the current
+    top sites, which doesn’t require sorting the whole history. The history
+    model is only scanned again when a top site is removed, hidden or loses
+    score while another entry might take its place.
+*/
+HistoryTopSitesModel::HistoryTopSitesModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_limit(DEFAULT_LIMIT)
+{
+    connect(this, SIGNAL(modelReset()), SIGNAL(countChanged()));
+    connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)), SIGNAL(countChanged()));
+    connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)), SIGNAL(countChanged()));
+}
+
+QHash<int, QByteArray> HistoryTopSitesModel::roleNames() const
+{
+    if (m_sourceModel.isNull()) {
+        return QHash<int, QByteArray>();
+    }
+    return m_sourceModel->roleNames();
+}
+
+int HistoryTopSitesModel::rowCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return m_sites.count();
+}
+
+QVariant HistoryTopSitesModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || m_sourceModel.isNull()) {
+        return QVariant();
+    }
+    const QPersistentModelIndex& sourceIndex = m_sites.at(index.row()).index;
+    if (!sourceIndex.isValid()) {
+        return QVariant();
+    }
+    return m_sourceModel->data(sourceIndex, role);
+}
+
+HistoryModel* HistoryTopSitesModel::sourceModel() const
+{
+    return m_sourceModel;
+}
+
+void HistoryTopSitesModel::setSourceModel(HistoryModel* sourceModel)
+{
+    if (sourceModel != m_sourceModel) {
+        if (!m_sourceModel.isNull()) {
+            m_sourceModel->disconnect(this);
+        }
+        m_sourceModel = sourceModel;
+        if (!m_sourceModel.isNull()) {
+            connect(m_sourceModel, SIGNAL(rowsInserted(QModelIndex, int, int)),
+                    SLOT(onSourceRowsInserted(QModelIndex, int, int)));
+            connect(m_sourceModel, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+                    SLOT(onSourceRowsRemoved()));
+            connect(m_sourceModel, SIGNAL(modelReset()), SLOT(populate()));
+            connect(m_sourceModel, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)),
+                    SLOT(onSourceDataChanged(QModelIndex, QModelIndex, QVector<int>)));
+        }
+        populate();
+        Q_EMIT sourceModelChanged();
+    }
+}
+
+int HistoryTopSitesModel::limit() const
+{
+    return m_limit;
+}
+
+void HistoryTopSitesModel::setLimit(int limit)
+{
+    if (limit != m_limit) {
+        m_limit = limit;
+        populate();
+        Q_EMIT limitChanged();
+    }
+}
+
+/*
+    Scan the whole history model for its top sites. If they are the same as
+    before (which is most often the case when the frecency scores are
+    refreshed), only their data is notified as changed.
+*/
+void HistoryTopSitesModel::populate()
+{
+    typedef QPair<double, int> Candidate;
+    QVector<Candidate> top;
+    int count = (m_sourceModel.isNull() || (m_limit <= 0)) ? 0 : m_sourceModel->rowCount();
+    for (int sourceRow = 0; sourceRow < count; ++sourceRow) {
+        double frecency;
+        if (!isCandidate(sourceRow, &frecency)) {
+            continue;
+        }
+        if ((top.count() == m_limit) && (frecency <= top.last().first)) {
+            continue;
+        }
+        // Entries with the same score are ranked chronologically
+        QVector<Candidate>::iterator i =
+            std::upper_bound(top.begin(), top.end(), frecency,
+                             [] (double frecency, const Candidate& candidate) {
+                                 return frecency > candidate.first;
+                             });
+        top.insert(i, qMakePair(frecency, sourceRow));
+        if (top.count() > m_limit) {
+            top.removeLast();
+        }
+    }
+
+    bool same = (top.count() == m_sites.count());
+    for (int row = 0; same && (row < top.count()); ++row) {
+        same = (m_sites.at(row).index.row() == top.at(row).second);
+    }
+    if (same) {
+        for (int row = 0; row < top.count(); ++row) {
+            m_sites[row].frecency = top.at(row).first;
+        }
+        if (!m_sites.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 0), index(m_sites.count() - 1, 0));
+        }
+        return;
+    }
+
+    beginResetModel();
+    m_sites.clear();
+    Q_FOREACH(const Candidate& candidate, top) {
+        TopSite site;
+        site.index = QPersistentModelIndex(m_sourceModel->index(candidate.second, 0));
+        site.frecency = candidate.first;
+        m_sites.append(site);
+    }
+    endResetModel();
+}
+
+bool HistoryTopSitesModel::isCandidate(int sourceRow, double* frecency) const
+{
+    QModelIndex index = m_sourceModel->index(sourceRow, 0);
+    if (m_sourceModel->data(index, HistoryModel::Hidden).toBool()) {
+        return false;
+    }
+    *frecency = m_sourceModel->data(index, HistoryModel::Frecency).toDouble();
+    return true;
+}
+
+int HistoryTopSitesModel::insertionRow(double frecency) const
+{
+    QList<TopSite>::const_iterator i =
+        std::upper_bound(m_sites.constBegin(), m_sites.constEnd(), frecency,
+                         [] (double frecency, const TopSite& site) {
+                             return frecency > site.frecency;
+                         });
+    return i - m_sites.constBegin();
+}
+
+int HistoryTopSitesModel::siteRow(int sourceRow) const
+{
+    for (int row = 0; row < m_sites.count(); ++row) {
+        if (m_sites.at(row).index.row() == sourceRow) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+/*
+    Add an entry of the history model to the top sites if it ranks high
+    enough, the last top site being dropped if there are too many of them.
+*/
+bool HistoryTopSitesModel::consider(int sourceRow)
+{
+    double frecency;
+    if (!isCandidate(sourceRow, &frecency)) {
+        return false;
+    }
+    int row = insertionRow(frecency);
+    if (row >= m_limit) {
+        return false;
+    }
+    TopSite site;
+    site.index = QPersistentModelIndex(m_sourceModel->index(sourceRow, 0));
+    site.frecency = frecency;
+    beginInsertRows(QModelIndex(), row, row);
+    m_sites.insert(row, site);
+    endInsertRows();
+    if (m_sites.count() > m_limit) {
+        beginRemoveRows(QModelIndex(), m_limit, m_limit);
+        m_sites.removeLast();
+        endRemoveRows();
+    }
+    return true;
+}
+
+/*
+    Move a top site to its new rank after its score changed. If it was
+    hidden or lost score while there may be other entries beyond the top
+    sites, return false as the history model needs to be scanned again.
+*/
+bool HistoryTopSitesModel::updateSite(int row)
+{
+    double frecency;
+    bool candidate = isCandidate(m_sites.at(row).index.row(), &frecency);
+    bool full = (m_sites.count() == m_limit);
+    if (full && (!candidate || (frecency < m_sites.at(row).frecency))) {
+        return false;
+    }
+    if (!candidate) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_sites.removeAt(row);
+        endRemoveRows();
+        return true;
+    }
+    TopSite site = m_sites.takeAt(row);
+    site.frecency = frecency;
+    int destination = insertionRow(frecency);
+    m_sites.insert(row, site);
+    if (destination != row) {
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(),
+                      (destination < row) ? destination : destination + 1);
+        m_sites.move(row, destination);
+        endMoveRows();
+    }
+    QModelIndex index = this->index(destination, 0);
+    Q_EMIT dataChanged(index, index);
+    return true;
+}
+
+void HistoryTopSitesModel::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    for (int sourceRow = first; sourceRow <= last; ++sourceRow) {
+        consider(sourceRow);
+    }
+}
+
+void HistoryTopSitesModel::onSourceRowsRemoved()
+{
+    bool full = (m_sites.count() == m_limit);
+    for (int row = m_sites.count() - 1; row >= 0; --row) {
+        if (m_sites.at(row).index.isValid()) {
+            continue;
+        }
+        if (full) {
+            populate();
+            return;
+        }
+        beginRemoveRows(QModelIndex(), row, row);
+        m_sites.removeAt(row);
+        endRemoveRows();
+    }
+}
+
+void HistoryTopSitesModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                               const QVector<int>& roles)
+{
+    int first = topLeft.row();
+    int last = bottomRight.row();
+    if (!roles.isEmpty() && !roles.contains(HistoryModel::Frecency) &&
+            !roles.contains(HistoryModel::Hidden)) {
+        for (int row = 0; row < m_sites.count(); ++row) {
+            int sourceRow = m_sites.at(row).index.row();
+            if ((sourceRow >= first) && (sourceRow <= last)) {
+                QModelIndex index = this->index(row, 0);
+                Q_EMIT dataChanged(index, index, roles);
+            }
+        }
+        return;
+    }
+    if (last - first >= m_limit) {
+        // e.g. all the scores were refreshed
+        populate();
+        return;
+    }
+    for (int sourceRow = first; sourceRow <= last; ++sourceRow) {
+        int row = siteRow(sourceRow);
+        if (row == -1) {
+            consider(sourceRow);
+        } else if (!updateSite(row)) {
+            populate();
+            return;
+        }
+    }
+}
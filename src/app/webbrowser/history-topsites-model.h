@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __HISTORY_TOPSITES_MODEL_H__
+#define __HISTORY_TOPSITES_MODEL_H__
+
+// Qt
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QList>
+#include <QtCore/QPersistentModelIndex>
+#include <QtCore/QPointer>
+#include <QtCore/QVector>
+
+class HistoryModel;
+
+class HistoryTopSitesModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(HistoryModel* sourceModel READ sourceModel WRITE setSourceModel NOTIFY sourceModelChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    HistoryTopSitesModel(QObject* parent=0);
+
+    // reimplemented from QAbstractListModel
+    QHash<int, QByteArray> roleNames() const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+
+    HistoryModel* sourceModel() const;
+    void setSourceModel(HistoryModel* sourceModel);
+
+    int limit() const;
+    void setLimit(int limit);
+
+Q_SIGNALS:
+    void sourceModelChanged() const;
+    void limitChanged() const;
+    void countChanged() const;
+
+private Q_SLOTS:
+    void populate();
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved();
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                             const QVector<int>& roles);
+
+private:
+    struct TopSite {
+        QPersistentModelIndex index;
+        double frecency;
+    };
+
+    QPointer<HistoryModel> m_sourceModel;
+    int m_limit;
+    QList<TopSite> m_sites;
+
+    bool isCandidate(int sourceRow, double* frecency) const;
+    int insertionRow(double frecency) const;
+    int siteRow(int sourceRow) const;
+    bool consider(int sourceRow);
+    bool updateSite(int row);
+};
+
+#endif // __HISTORY_TOPSITES_MODEL_H__
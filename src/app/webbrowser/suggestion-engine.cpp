@@ -0,0 +1,727 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "folded-text-search.h"
+#include "suggestion-engine.h"
+
+// Qt
+#include <QtCore/QDateTime>
+#include <QtCore/QUrl>
+
+// system
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// How well a term matches a field
+const double PREFIX_HIT = 3.0;
+const double WORD_HIT = 2.0;
+const double SUBSTRING_HIT = 1.0;
+
+const double TEXT_WEIGHT = 10.0;
+const double VISITS_WEIGHT = 2.0;
+const double RECENCY_WEIGHT = 5.0;
+const double RECENCY_HALF_LIFE_DAYS = 7.0;
+const double BOOKMARK_BONUS = 5.0;
+const double TAB_BONUS = 3.0;
+
+const qint64 MSECS_PER_DAY = 24 * 60 * 60 * 1000;
+
+/*
+    Best hit for a term in a case-folded field: at the given start position
+    (beginning of the title, or host of a URL), at the beginning of a word, or
+    anywhere else. Zero if the term is not found.
+*/
+double termScore(const QString& text, const QString& term, int start)
+{
+    double best = 0;
+    int index = FoldedTextSearch::indexOf(text, term);
+    while (index != -1) {
+        if (index == start) {
+            return PREFIX_HIT;
+        } else if ((index == 0) || !text.at(index - 1).isLetterOrNumber()) {
+            best = WORD_HIT;
+        } else {
+            best = qMax(best, SUBSTRING_HIT);
+        }
+        index = FoldedTextSearch::indexOf(text, term, index + 1);
+    }
+    return best;
+}
+
+// Position of the host in a URL, not counting any "www." prefix
+int hostStart(const QString& url)
+{
+    int start = url.indexOf(QStringLiteral("://"));
+    start = (start == -1) ? 0 : start + 3;
+    if (url.midRef(start, 4) == QLatin1String("www.")) {
+        start += 4;
+    }
+    return start;
+}
+
+}
+
+/*!
+    \class SuggestionEngine
+    \brief List model of the best suggestions for a list of search terms
+
+    SuggestionEngine ranks the entries of a history model, a bookmarks model
+    and a tabs model against a list of search terms, and exposes the best
+    matches (up to the limit, most relevant first).
+
+    Source models are read through their "url" and "title" roles, and also
+    "visits" and "lastVisit" when they exist. Entries with the same URL in
+    several models are merged. Each search term must be found in the URL or
+    the title of an entry. Entries score higher when terms are found at the
+    beginning of their title or host, or at the beginning of a word, and when
+    they are visited often or recently, bookmarked, or open in a tab.
+
+    The contents of the source models are cached as case-folded candidates,
+    which are read once and then only updated for the rows that change. The
+    candidates that match the current terms are kept as well: when new terms
+    refine them (e.g. while typing), only those are searched again, and
+    candidates that change are checked against the terms as they change.
+    Only the best matches are kept while ranking, in a heap bounded by the
+    limit, and matches that can't rank high enough whatever their text score
+    are skipped before looking up where the terms are found.
+*/
+SuggestionEngine::SuggestionEngine(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_limit(4)
+    , m_candidatesDirty(true)
+{
+    for (int source = 0; source < SourceCount; ++source) {
+        m_sources[source].urlRole = -1;
+        m_sources[source].titleRole = -1;
+        m_sources[source].visitsRole = -1;
+        m_sources[source].lastVisitRole = -1;
+    }
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(0);
+    connect(&m_updateTimer, SIGNAL(timeout()), SLOT(update()));
+}
+
+QHash<int, QByteArray> SuggestionEngine::roleNames() const
+{
+    static QHash<int, QByteArray> roles;
+    if (roles.isEmpty()) {
+        roles[Url] = "url";
+        roles[Title] = "title";
+        roles[Icon] = "icon";
+        roles[DisplayUrl] = "displayUrl";
+        roles[Sources] = "sources";
+        roles[Score] = "score";
+    }
+    return roles;
+}
+
+int SuggestionEngine::rowCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return m_suggestions.count();
+}
+
+QVariant SuggestionEngine::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    const Suggestion& suggestion = m_suggestions.at(index.row());
+    const Candidate& candidate = m_candidates.at(suggestion.candidate);
+
+    switch (role) {
+    case Url:
+        return QUrl(candidate.url);
+    case Title:
+        return candidate.title;
+    case Icon:
+        if (candidate.sources & Tab) {
+            return QStringLiteral("browser-tabs");
+        } else if (candidate.sources & Bookmark) {
+            return QStringLiteral("non-starred");
+        } else {
+            return QStringLiteral("history");
+        }
+    case DisplayUrl:
+        return true;
+    case Sources:
+        return candidate.sources;
+    case Score:
+        return suggestion.score;
+    default:
+        return QVariant();
+    }
+}
+
+QVariantMap SuggestionEngine::get(int i) const
+{
+    QVariantMap item;
+    if ((i >= 0) && (i < m_suggestions.count())) {
+        QModelIndex index = this->index(i, 0);
+        QHashIterator<int, QByteArray> roles(roleNames());
+        while (roles.hasNext()) {
+            roles.next();
+            item.insert(QString::fromUtf8(roles.value()), data(index, roles.key()));
+        }
+    }
+    return item;
+}
+
+QObject* SuggestionEngine::historyModel() const
+{
+    return m_sources[HistorySource].model;
+}
+
+void SuggestionEngine::setHistoryModel(QObject* model)
+{
+    if (model != historyModel()) {
+        setSourceModel(HistorySource, model);
+        Q_EMIT historyModelChanged();
+    }
+}
+
+QObject* SuggestionEngine::bookmarksModel() const
+{
+    return m_sources[BookmarkSource].model;
+}
+
+void SuggestionEngine::setBookmarksModel(QObject* model)
+{
+    if (model != bookmarksModel()) {
+        setSourceModel(BookmarkSource, model);
+        Q_EMIT bookmarksModelChanged();
+    }
+}
+
+QObject* SuggestionEngine::tabsModel() const
+{
+    return m_sources[TabSource].model;
+}
+
+void SuggestionEngine::setTabsModel(QObject* model)
+{
+    if (model != tabsModel()) {
+        setSourceModel(TabSource, model);
+        Q_EMIT tabsModelChanged();
+    }
+}
+
+int SuggestionEngine::sourceIndex(QObject* model) const
+{
+    for (int source = 0; source < SourceCount; ++source) {
+        if (m_sources[source].model.data() == model) {
+            return source;
+        }
+    }
+    return -1;
+}
+
+void SuggestionEngine::setSourceModel(SourceIndex source, QObject* model)
+{
+    QPointer<QAbstractItemModel>& member = m_sources[source].model;
+    if (member) {
+        member->disconnect(this);
+    }
+    member = qobject_cast<QAbstractItemModel*>(model);
+    if (member) {
+        connect(member, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+                SLOT(onSourceRowsInserted(const QModelIndex&, int, int)));
+        connect(member, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
+                SLOT(onSourceRowsRemoved(const QModelIndex&, int, int)));
+        connect(member, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)),
+                SLOT(onSourceRowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+        connect(member, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)),
+                SLOT(onSourceDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+        connect(member, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)),
+                SLOT(onSourceReset()));
+        connect(member, SIGNAL(modelReset()), SLOT(onSourceReset()));
+        connect(member, SIGNAL(destroyed()), SLOT(onSourceReset()));
+    }
+    onSourceReset();
+}
+
+const QStringList& SuggestionEngine::terms() const
+{
+    return m_terms;
+}
+
+void SuggestionEngine::setTerms(const QStringList& terms)
+{
+    if (terms != m_terms) {
+        m_terms = terms;
+        m_foldedTerms.clear();
+        Q_FOREACH(const QString& term, m_terms) {
+            QString folded = term.toCaseFolded();
+            if (!folded.isEmpty() && !m_foldedTerms.contains(folded)) {
+                m_foldedTerms.append(folded);
+            }
+        }
+        update();
+        Q_EMIT termsChanged();
+    }
+}
+
+int SuggestionEngine::limit() const
+{
+    return m_limit;
+}
+
+void SuggestionEngine::setLimit(int limit)
+{
+    if (limit != m_limit) {
+        m_limit = limit;
+        update();
+        Q_EMIT limitChanged();
+    }
+}
+
+void SuggestionEngine::scheduleUpdate()
+{
+    if (!m_foldedTerms.isEmpty()) {
+        m_updateTimer.start();
+    }
+}
+
+/*
+    The candidates are read again from all the source models, the next time
+    suggestions are needed.
+*/
+void SuggestionEngine::onSourceReset()
+{
+    m_candidatesDirty = true;
+    scheduleUpdate();
+}
+
+void SuggestionEngine::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    int source = sourceIndex(sender());
+    if (m_candidatesDirty || (source == -1) || parent.isValid()) {
+        return;
+    }
+    QVector<int>& candidates = m_sources[source].candidates;
+    candidates.insert(first, last - first + 1, -1);
+    for (int row = first; row <= last; ++row) {
+        candidates[row] = attachRow(source, row);
+    }
+    scheduleUpdate();
+}
+
+void SuggestionEngine::onSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    int source = sourceIndex(sender());
+    if (m_candidatesDirty || (source == -1) || parent.isValid()) {
+        return;
+    }
+    QVector<int>& candidates = m_sources[source].candidates;
+    QVector<int> removed = candidates.mid(first, last - first + 1);
+    candidates.remove(first, last - first + 1);
+    // Rows with the same URL are detached at once
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+    Q_FOREACH(int candidate, removed) {
+        if (candidate != -1) {
+            detachRow(source, candidate);
+        }
+    }
+    scheduleUpdate();
+}
+
+void SuggestionEngine::onSourceRowsMoved(const QModelIndex& parent, int start, int end,
+                                         const QModelIndex& destination, int row)
+{
+    int source = sourceIndex(sender());
+    if (m_candidatesDirty || (source == -1) || parent.isValid() || destination.isValid()) {
+        return;
+    }
+    // The candidates don't change, only the rows they are read from
+    QVector<int>& candidates = m_sources[source].candidates;
+    if (row > end) {
+        std::rotate(candidates.begin() + start, candidates.begin() + end + 1, candidates.begin() + row);
+    } else {
+        std::rotate(candidates.begin() + row, candidates.begin() + start, candidates.begin() + end + 1);
+    }
+}
+
+void SuggestionEngine::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                           const QVector<int>& roles)
+{
+    int source = sourceIndex(sender());
+    if (m_candidatesDirty || (source == -1) || topLeft.parent().isValid()) {
+        return;
+    }
+    const SourceModel& model = m_sources[source];
+    if (!roles.isEmpty() && !roles.contains(model.urlRole) && !roles.contains(model.titleRole) &&
+            !roles.contains(model.visitsRole) && !roles.contains(model.lastVisitRole)) {
+        // e.g. the frecency scores of the history being refreshed
+        return;
+    }
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        updateRow(source, row);
+    }
+    scheduleUpdate();
+}
+
+void SuggestionEngine::buildCandidates()
+{
+    m_candidates.clear();
+    m_candidateIndex.clear();
+    m_freeCandidates.clear();
+    m_releasedCandidates.clear();
+    m_matches.clear();
+    m_matchTerms.clear();
+    for (int source = 0; source < SourceCount; ++source) {
+        SourceModel& model = m_sources[source];
+        model.candidates.clear();
+        if (!model.model) {
+            continue;
+        }
+        QHash<int, QByteArray> roles = model.model->roleNames();
+        model.urlRole = roles.key("url", -1);
+        model.titleRole = roles.key("title", -1);
+        model.visitsRole = roles.key("visits", -1);
+        model.lastVisitRole = roles.key("lastVisit", -1);
+        int count = model.model->rowCount();
+        model.candidates.resize(count);
+        for (int row = 0; row < count; ++row) {
+            model.candidates[row] = attachRow(source, row);
+        }
+    }
+    m_candidatesDirty = false;
+}
+
+/*
+    Read a row of a source model, return false if it has no URL.
+*/
+bool SuggestionEngine::readRow(int source, int row, QString* url, Origin* origin) const
+{
+    const SourceModel& model = m_sources[source];
+    if (model.urlRole == -1) {
+        return false;
+    }
+    QModelIndex index = model.model->index(row, 0);
+    *url = model.model->data(index, model.urlRole).toString();
+    if (url->isEmpty()) {
+        return false;
+    }
+    origin->count = 1;
+    origin->title = (model.titleRole != -1) ? model.model->data(index, model.titleRole).toString() : QString();
+    origin->visits = (model.visitsRole != -1) ? model.model->data(index, model.visitsRole).toInt() : 0;
+    origin->lastVisit = (model.lastVisitRole != -1) ?
+        model.model->data(index, model.lastVisitRole).toDateTime().toMSecsSinceEpoch() : 0;
+    return true;
+}
+
+void SuggestionEngine::addToOrigin(Origin* origin, const Origin& row)
+{
+    if (origin->title.isEmpty()) {
+        origin->title = row.title;
+    }
+    origin->visits = qMax(origin->visits, row.visits);
+    origin->lastVisit = qMax(origin->lastVisit, row.lastVisit);
+    origin->count += row.count;
+}
+
+/*
+    Read again what the rows of a source model contribute to a candidate,
+    when there are several rows with the same URL (e.g. tabs).
+*/
+SuggestionEngine::Origin SuggestionEngine::collectOrigin(int source, int candidate) const
+{
+    Origin origin = {0, QString(), 0, 0};
+    const QVector<int>& candidates = m_sources[source].candidates;
+    for (int row = 0; row < candidates.count(); ++row) {
+        QString url;
+        Origin other;
+        if ((candidates.at(row) == candidate) && readRow(source, row, &url, &other)) {
+            addToOrigin(&origin, other);
+        }
+    }
+    return origin;
+}
+
+/*
+    Add a row of a source model to the candidate for its URL, and return that
+    candidate (or -1 if the row has no URL).
+*/
+int SuggestionEngine::attachRow(int source, int row)
+{
+    QString url;
+    Origin origin;
+    if (!readRow(source, row, &url, &origin)) {
+        return -1;
+    }
+
+    int candidate;
+    QHash<QString, int>::const_iterator i = m_candidateIndex.constFind(url);
+    if (i != m_candidateIndex.constEnd()) {
+        candidate = i.value();
+    } else {
+        if (m_freeCandidates.isEmpty()) {
+            candidate = m_candidates.count();
+            m_candidates.append(Candidate());
+        } else {
+            candidate = m_freeCandidates.takeLast();
+        }
+        // A free candidate may still be listed among the matches
+        Candidate& created = m_candidates[candidate];
+        created.url = url;
+        created.title.clear();
+        created.foldedUrl = url.toCaseFolded();
+        created.foldedTitle.clear();
+        created.hostStart = hostStart(created.foldedUrl);
+        for (int other = 0; other < SourceCount; ++other) {
+            created.origins[other] = {0, QString(), 0, 0};
+        }
+        created.matched = false;
+        m_candidateIndex.insert(url, candidate);
+    }
+
+    addToOrigin(&m_candidates[candidate].origins[source], origin);
+    mergeOrigins(candidate);
+    return candidate;
+}
+
+/*
+    Remove the rows of a source model that were mapped to a candidate, which
+    is released once no row refers to it anymore. The rows must already be
+    unmapped.
+*/
+void SuggestionEngine::detachRow(int source, int candidate)
+{
+    Candidate& current = m_candidates[candidate];
+    Origin& origin = current.origins[source];
+    if (origin.count > 1) {
+        origin = collectOrigin(source, candidate);
+    } else {
+        origin = {0, QString(), 0, 0};
+    }
+    mergeOrigins(candidate);
+    if (current.sources == 0) {
+        m_candidateIndex.remove(current.url);
+        // Suggestions may refer to it until the next update
+        if (m_suggestions.isEmpty()) {
+            m_freeCandidates.append(candidate);
+        } else {
+            m_releasedCandidates.append(candidate);
+        }
+    }
+}
+
+void SuggestionEngine::updateRow(int source, int row)
+{
+    QVector<int>& candidates = m_sources[source].candidates;
+    int candidate = candidates.at(row);
+    QString url;
+    Origin origin;
+    bool hasUrl = readRow(source, row, &url, &origin);
+    if ((candidate != -1) && hasUrl && (m_candidates.at(candidate).url == url)) {
+        Origin& current = m_candidates[candidate].origins[source];
+        current = (current.count > 1) ? collectOrigin(source, candidate) : origin;
+        mergeOrigins(candidate);
+        return;
+    }
+    candidates[row] = -1;
+    if (candidate != -1) {
+        detachRow(source, candidate);
+    }
+    candidates[row] = attachRow(source, row);
+}
+
+/*
+    Merge what each source model contributes to a candidate, then check it
+    against the terms of the current matches.
+*/
+void SuggestionEngine::mergeOrigins(int candidate)
+{
+    Candidate& current = m_candidates[candidate];
+    QString title;
+    int visits = 0;
+    qint64 lastVisit = 0;
+    int sources = 0;
+    for (int source = 0; source < SourceCount; ++source) {
+        const Origin& origin = current.origins[source];
+        if (origin.count == 0) {
+            continue;
+        }
+        sources |= (1 << source);
+        if (title.isEmpty()) {
+            title = origin.title;
+        }
+        visits = qMax(visits, origin.visits);
+        lastVisit = qMax(lastVisit, origin.lastVisit);
+    }
+    if (title != current.title) {
+        current.title = title;
+        current.foldedTitle = title.toCaseFolded();
+    }
+    current.visits = visits;
+    current.lastVisit = lastVisit;
+    current.sources = sources;
+    rematch(candidate);
+}
+
+void SuggestionEngine::rematch(int candidate)
+{
+    if (m_matchTerms.isEmpty()) {
+        return;
+    }
+    Candidate& current = m_candidates[candidate];
+    current.matched = (current.sources != 0) && matches(current, m_matchTerms);
+    if (current.matched && !current.listed) {
+        current.listed = true;
+        m_matches.append(candidate);
+    }
+}
+
+/*
+    Find the candidates that match the current terms. If they refine the
+    terms of the previous matches, only those need to be searched again.
+*/
+void SuggestionEngine::matchCandidates()
+{
+    bool refined = !m_matchTerms.isEmpty() &&
+                   FoldedTextSearch::isRefinement(m_matchTerms, m_foldedTerms);
+    m_matchTerms = m_foldedTerms;
+    if (refined) {
+        int count = 0;
+        for (int i = 0; i < m_matches.count(); ++i) {
+            int candidate = m_matches.at(i);
+            Candidate& current = m_candidates[candidate];
+            current.matched = current.matched && matches(current, m_matchTerms);
+            current.listed = current.matched;
+            if (current.matched) {
+                m_matches[count++] = candidate;
+            }
+        }
+        m_matches.resize(count);
+    } else {
+        m_matches.clear();
+        for (int candidate = 0; candidate < m_candidates.count(); ++candidate) {
+            Candidate& current = m_candidates[candidate];
+            current.matched = (current.sources != 0) && matches(current, m_matchTerms);
+            current.listed = current.matched;
+            if (current.matched) {
+                m_matches.append(candidate);
+            }
+        }
+    }
+}
+
+bool SuggestionEngine::matches(const Candidate& candidate, const QVector<QString>& terms) const
+{
+    Q_FOREACH(const QString& term, terms) {
+        if (!FoldedTextSearch::contains(candidate.foldedTitle, term) &&
+                !FoldedTextSearch::contains(candidate.foldedUrl, term)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    How well a matching candidate matches the current terms.
+*/
+double SuggestionEngine::textScore(const Candidate& candidate) const
+{
+    double text = 0;
+    Q_FOREACH(const QString& term, m_foldedTerms) {
+        text += qMax(termScore(candidate.foldedTitle, term, 0),
+                     termScore(candidate.foldedUrl, term, candidate.hostStart));
+    }
+    return text * TEXT_WEIGHT;
+}
+
+/*
+    The part of the relevance of a candidate that doesn't depend on the terms.
+*/
+double SuggestionEngine::usageScore(const Candidate& candidate, qint64 now) const
+{
+    double score = std::log2(1.0 + candidate.visits) * VISITS_WEIGHT;
+    if (candidate.lastVisit > 0) {
+        double days = double(qMax(Q_INT64_C(0), now - candidate.lastVisit)) / MSECS_PER_DAY;
+        score += RECENCY_WEIGHT / (1.0 + days / RECENCY_HALF_LIFE_DAYS);
+    }
+    if (candidate.sources & Bookmark) {
+        score += BOOKMARK_BONUS;
+    }
+    if (candidate.sources & Tab) {
+        score += TAB_BONUS;
+    }
+    return score;
+}
+
+void SuggestionEngine::update()
+{
+    m_updateTimer.stop();
+
+    // Suggestions that rank first compare lower, so that the heap's top is
+    // the worst suggestion kept so far.
+    auto ranksBefore = [] (const Suggestion& a, const Suggestion& b) {
+        return (a.score > b.score) || ((a.score == b.score) && (a.candidate < b.candidate));
+    };
+
+    QVector<Suggestion> suggestions;
+    if (!m_foldedTerms.isEmpty() && (m_limit != 0)) {
+        if (m_candidatesDirty) {
+            buildCandidates();
+        }
+        if (m_matchTerms != m_foldedTerms) {
+            matchCandidates();
+        }
+
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        double maxTextScore = m_foldedTerms.count() * PREFIX_HIT * TEXT_WEIGHT;
+        int count = 0;
+        for (int i = 0; i < m_matches.count(); ++i) {
+            int candidate = m_matches.at(i);
+            Candidate& current = m_candidates[candidate];
+            if (!current.matched) {
+                // changed since it was listed
+                current.listed = false;
+                continue;
+            }
+            m_matches[count++] = candidate;
+
+            double usage = usageScore(current, now);
+            bool full = (m_limit > 0) && (suggestions.count() == m_limit);
+            if (full && (usage + maxTextScore < suggestions.first().score)) {
+                continue;
+            }
+            Suggestion suggestion = {candidate, usage + textScore(current)};
+            if (!full) {
+                suggestions.append(suggestion);
+                std::push_heap(suggestions.begin(), suggestions.end(), ranksBefore);
+            } else if (ranksBefore(suggestion, suggestions.first())) {
+                std::pop_heap(suggestions.begin(), suggestions.end(), ranksBefore);
+                suggestions.last() = suggestion;
+                std::push_heap(suggestions.begin(), suggestions.end(), ranksBefore);
+            }
+        }
+        m_matches.resize(count);
+        std::sort_heap(suggestions.begin(), suggestions.end(), ranksBefore);
+    }
+
+    beginResetModel();
+    m_suggestions.swap(suggestions);
+    endResetModel();
+    m_freeCandidates += m_releasedCandidates;
+    m_releasedCandidates.clear();
+    Q_EMIT countChanged();
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SUGGESTION_ENGINE_H__
+#define __SUGGESTION_ENGINE_H__
+
+// Qt
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/QVariantMap>
+#include <QtCore/QVector>
+
+class SuggestionEngine : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QObject* historyModel READ historyModel WRITE setHistoryModel NOTIFY historyModelChanged)
+    Q_PROPERTY(QObject* bookmarksModel READ bookmarksModel WRITE setBookmarksModel NOTIFY bookmarksModelChanged)
+    Q_PROPERTY(QObject* tabsModel READ tabsModel WRITE setTabsModel NOTIFY tabsModelChanged)
+    Q_PROPERTY(QStringList terms READ terms WRITE setTerms NOTIFY termsChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+    Q_ENUMS(Roles)
+    Q_ENUMS(Source)
+
+public:
+    SuggestionEngine(QObject* parent=0);
+
+    enum Roles {
+        Url = Qt::UserRole + 1,
+        Title,
+        Icon,
+        DisplayUrl,
+        Sources,
+        Score
+    };
+
+    enum Source {
+        History = 0x1,
+        Bookmark = 0x2,
+        Tab = 0x4
+    };
+
+    // reimplemented from QAbstractListModel
+    QHash<int, QByteArray> roleNames() const;
+    int rowCount(const QModelIndex& parent=QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+
+    QObject* historyModel() const;
+    void setHistoryModel(QObject* model);
+    QObject* bookmarksModel() const;
+    void setBookmarksModel(QObject* model);
+    QObject* tabsModel() const;
+    void setTabsModel(QObject* model);
+
+    const QStringList& terms() const;
+    void setTerms(const QStringList& terms);
+
+    int limit() const;
+    void setLimit(int limit);
+
+    Q_INVOKABLE QVariantMap get(int index) const;
+
+Q_SIGNALS:
+    void historyModelChanged() const;
+    void bookmarksModelChanged() const;
+    void tabsModelChanged() const;
+    void termsChanged() const;
+    void limitChanged() const;
+    void countChanged() const;
+
+private Q_SLOTS:
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsMoved(const QModelIndex& parent, int start, int end,
+                           const QModelIndex& destination, int row);
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                             const QVector<int>& roles);
+    void onSourceReset();
+    void update();
+
+private:
+    enum SourceIndex {
+        HistorySource,
+        BookmarkSource,
+        TabSource,
+        SourceCount
+    };
+
+    struct SourceModel {
+        QPointer<QAbstractItemModel> model;
+        int urlRole;
+        int titleRole;
+        int visitsRole;
+        int lastVisitRole;
+        QVector<int> candidates; // for each row, -1 if it has no URL
+    };
+
+    // What the rows of a source model with the same URL contribute
+    struct Origin {
+        int count;
+        QString title;
+        int visits;
+        qint64 lastVisit;
+    };
+
+    struct Candidate {
+        QString url;
+        QString title;
+        QString foldedUrl;
+        QString foldedTitle;
+        int hostStart;
+        int visits;
+        qint64 lastVisit;
+        int sources;
+        Origin origins[SourceCount];
+        bool matched;
+        bool listed;
+    };
+
+    struct Suggestion {
+        int candidate;
+        double score;
+    };
+
+    SourceModel m_sources[SourceCount];
+    QStringList m_terms;
+    QVector<QString> m_foldedTerms;
+    QVector<QString> m_matchTerms;
+    int m_limit;
+    QVector<Candidate> m_candidates;
+    QHash<QString, int> m_candidateIndex;
+    QVector<int> m_freeCandidates;
+    QVector<int> m_releasedCandidates;
+    bool m_candidatesDirty;
+    QVector<int> m_matches;
+    QVector<Suggestion> m_suggestions;
+    QTimer m_updateTimer;
+
+    int sourceIndex(QObject* model) const;
+    void setSourceModel(SourceIndex source, QObject* model);
+    void scheduleUpdate();
+    void buildCandidates();
+    bool readRow(int source, int row, QString* url, Origin* origin) const;
+    static void addToOrigin(Origin* origin, const Origin& row);
+    Origin collectOrigin(int source, int candidate) const;
+    int attachRow(int source, int row);
+    void detachRow(int source, int candidate);
+    void updateRow(int source, int row);
+    void mergeOrigins(int candidate);
+    void rematch(int candidate);
+    void matchCandidates();
+    bool matches(const Candidate& candidate, const QVector<QString>& terms) const;
+    double textScore(const Candidate& candidate) const;
+    double usageScore(const Candidate& candidate, qint64 now) const;
+};
+
+#endif // __SUGGESTION_ENGINE_H__
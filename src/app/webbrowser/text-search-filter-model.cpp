@@ -16,10 +16,64 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "folded-text-search.h"
 #include "text-search-filter-model.h"
 
 #include <QtCore/QDebug>
-#include <QtCore/QSet>
+#include <QtCore/QtAlgorithms>
+#include <QtConcurrent/QtConcurrentMap>
+
+// system
+#include <algorithm>
+#include <climits>
+
+/*
+    Matches chunks of search keys against the search terms, on worker threads.
+    Keys of rows that are already known to be rejected are null.
+*/
+struct TermsMatcher
+{
+    typedef QVector<bool> result_type;
+
+    TermsMatcher(const QVector<QString>& terms)
+        : terms(terms)
+    {
+    }
+
+    QVector<bool> operator()(const QVector<QString>& keys) const
+    {
+        QVector<bool> accepted(keys.count());
+        for (int i = 0; i < keys.count(); ++i) {
+            const QString& key = keys.at(i);
+            bool matches = !key.isNull();
+            for (int j = 0; matches && (j < terms.count()); ++j) {
+                matches = FoldedTextSearch::contains(key, terms.at(j));
+            }
+            accepted[i] = matches;
+        }
+        return accepted;
+    }
+
+    QVector<QString> terms;
+};
+
+static const int FILTER_CHUNK_SIZE = 4096;
+
+/*
+    Move rows the way a source model notifies it with rowsMoved().
+*/
+template<typename T>
+static void moveRows(QVector<T>& rows, int start, int end, int row)
+{
+    int count = end - start + 1;
+    QVector<T> moved = rows.mid(start, count);
+    rows.remove(start, count);
+    int first = (row > end) ? row - count : row;
+    rows.insert(first, count, T());
+    for (int i = 0; i < count; ++i) {
+        rows[first + i] = moved.at(i);
+    }
+}
 
 /*!
     \class TextSearchFilterModel
@@ -37,10 +91,41 @@
 
     If no searchTerms and/or no searchFields are present, all entries from the
     source model are returned.
+
+    Matching is case-insensitive. The case-folded contents of the search fields
+    are cached for each row of the source model, and updated when it changes.
+
+    When the new terms refine the previous ones (e.g. while typing), rows that
+    were rejected are known to still be rejected and are not matched again.
+
+    If the asynchronous property is set, changes to the search terms are
+    matched on worker threads, and the model is updated once all rows have
+    been matched. The busy property is true in the meantime, during which the
+    model keeps filtering with the previous terms. Changes to the source
+    model while busy are recorded and applied to the results once done: only
+    the rows inserted or changed in the meantime are then matched again. A
+    change to the terms or a reset of the source model while busy restarts
+    the matching.
+
+    If the limit property is set (it is -1 by default), only the first rows
+    that match, in the order of the source model, are returned. The source
+    model is only matched until that many rows have been found, and matched
+    again only when the limit is raised or rows up to the last match change.
 */
 TextSearchFilterModel::TextSearchFilterModel(QObject* parent)
     : QSortFilterProxyModel(parent)
+    , m_asynchronous(false)
+    , m_busy(false)
+    , m_limit(-1)
+    , m_limitRow(INT_MAX)
+    , m_limitDirty(false)
+{
+    connect(&m_filterWatcher, SIGNAL(finished()), SLOT(onFilterFinished()));
+}
+
+TextSearchFilterModel::~TextSearchFilterModel()
 {
+    m_filterWatcher.cancel();
 }
 
 QVariant TextSearchFilterModel::sourceModel() const
@@ -54,8 +139,45 @@ void TextSearchFilterModel::setSourceModel(QVariant sourceModel)
     QAbstractItemModel* currentSource = QSortFilterProxyModel::sourceModel();
     QAbstractItemModel* newSource = qvariant_cast<QAbstractItemModel*>(sourceModel);
     if (newSource != currentSource) {
+        cancelFiltering();
+        if (currentSource) {
+            currentSource->disconnect(this);
+        }
         updateSearchRoles(newSource);
+        m_searchRows = QVector<SearchRow>(newSource ? newSource->rowCount() : 0);
+        if (newSource) {
+            // Connect before the proxy model does, so that the cache is up
+            // to date when it filters the rows again.
+            connect(newSource, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+                    SLOT(onSourceRowsInserted(const QModelIndex&, int, int)));
+            connect(newSource, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
+                    SLOT(onSourceRowsRemoved(const QModelIndex&, int, int)));
+            connect(newSource, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)),
+                    SLOT(onSourceRowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+            connect(newSource, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)),
+                    SLOT(onSourceDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+            connect(newSource, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)),
+                    SLOT(resetSearchRows()));
+            connect(newSource, SIGNAL(modelReset()), SLOT(resetSearchRows()));
+        }
+        m_limitRow = INT_MAX;
         QSortFilterProxyModel::setSourceModel(newSource);
+        if (newSource) {
+            // Once the proxy model has been updated, check whether the last
+            // row within the limit changed.
+            connect(newSource, SIGNAL(rowsInserted(const QModelIndex&, int, int)), SLOT(updateLimitRow()));
+            connect(newSource, SIGNAL(rowsRemoved(const QModelIndex&, int, int)), SLOT(updateLimitRow()));
+            connect(newSource, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)),
+                    SLOT(updateLimitRow()));
+            connect(newSource, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)),
+                    SLOT(updateLimitRow()));
+            connect(newSource, SIGNAL(layoutChanged(QList<QPersistentModelIndex>, QAbstractItemModel::LayoutChangeHint)),
+                    SLOT(updateLimitRow()));
+            connect(newSource, SIGNAL(modelReset()), SLOT(updateLimitRow()));
+            if (m_limit >= 0) {
+                applyFilter();
+            }
+        }
         Q_EMIT sourceModelChanged();
         Q_EMIT countChanged();
     }
@@ -65,9 +187,26 @@ void TextSearchFilterModel::setTerms(const QStringList& terms)
 {
     if (terms != m_terms) {
         m_terms = terms;
-        invalidateFilter();
+        QVector<QString> foldedTerms;
+        Q_FOREACH(const QString& term, m_terms) {
+            QString folded = term.toCaseFolded();
+            if (!foldedTerms.contains(folded)) {
+                foldedTerms.append(folded);
+            }
+        }
+        // Longer terms are less likely to match, try them first
+        std::stable_sort(foldedTerms.begin(), foldedTerms.end(),
+                         [] (const QString& a, const QString& b) { return a.size() > b.size(); });
+        if (m_asynchronous) {
+            startFiltering(foldedTerms);
+        } else {
+            setFoldedTerms(foldedTerms);
+            applyFilter();
+        }
         Q_EMIT termsChanged();
-        Q_EMIT countChanged();
+        if (!m_busy) {
+            Q_EMIT countChanged();
+        }
     }
 }
 
@@ -80,8 +219,10 @@ void TextSearchFilterModel::setSearchFields(const QStringList& searchFields)
 {
     if (searchFields != m_searchFields) {
         m_searchFields = searchFields;
+        cancelFiltering();
         updateSearchRoles(QSortFilterProxyModel::sourceModel());
-        invalidateFilter();
+        m_searchRows.fill(SearchRow());
+        applyFilter();
         Q_EMIT searchFieldsChanged();
         Q_EMIT countChanged();
     }
@@ -92,6 +233,56 @@ const QStringList& TextSearchFilterModel::searchFields() const
     return m_searchFields;
 }
 
+bool TextSearchFilterModel::asynchronous() const
+{
+    return m_asynchronous;
+}
+
+void TextSearchFilterModel::setAsynchronous(bool asynchronous)
+{
+    if (asynchronous != m_asynchronous) {
+        m_asynchronous = asynchronous;
+        if (!m_asynchronous && m_busy) {
+            cancelFiltering();
+            applyFilter();
+            Q_EMIT countChanged();
+        }
+        Q_EMIT asynchronousChanged();
+    }
+}
+
+bool TextSearchFilterModel::busy() const
+{
+    return m_busy;
+}
+
+void TextSearchFilterModel::setBusy(bool busy)
+{
+    if (busy != m_busy) {
+        m_busy = busy;
+        Q_EMIT busyChanged();
+    }
+}
+
+int TextSearchFilterModel::limit() const
+{
+    return m_limit;
+}
+
+void TextSearchFilterModel::setLimit(int limit)
+{
+    if (limit != m_limit) {
+        m_limit = limit;
+        if (!m_busy) {
+            applyFilter();
+        }
+        Q_EMIT limitChanged();
+        if (!m_busy) {
+            Q_EMIT countChanged();
+        }
+    }
+}
+
 void TextSearchFilterModel::updateSearchRoles(const QAbstractItemModel* model) {
     m_searchRoles.clear();
     if (model) {
@@ -106,30 +297,318 @@ void TextSearchFilterModel::updateSearchRoles(const QAbstractItemModel* model) {
     }
 }
 
+/*
+    The search key of a row is the concatenation of its case-folded search
+    fields, separated by a null character so that a term cannot match across
+    two fields. Keys of top-level rows are cached.
+*/
+QString TextSearchFilterModel::searchKey(int row, const QModelIndex& parent) const
+{
+    bool cached = !parent.isValid() && (row < m_searchRows.count());
+    if (cached && !m_searchRows.at(row).key.isNull()) {
+        return m_searchRows.at(row).key;
+    }
+
+    QAbstractItemModel* source = QSortFilterProxyModel::sourceModel();
+    QModelIndex index = source->index(row, 0, parent);
+    QString key;
+    Q_FOREACH(int role, m_searchRoles) {
+        key.append(source->data(index, role).toString());
+        key.append(QChar(QChar::Null));
+    }
+    key = key.toCaseFolded();
+    if (cached) {
+        m_searchRows[row].key = key;
+    }
+    return key;
+}
+
 bool TextSearchFilterModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
 {
-    if (m_terms.isEmpty() || m_searchFields.isEmpty()) {
+    if (!source_parent.isValid() && (source_row >= m_limitRow)) {
+        return false;
+    }
+    return matchesRow(source_row, source_parent);
+}
+
+bool TextSearchFilterModel::matchesRow(int source_row, const QModelIndex& source_parent) const
+{
+    if (m_foldedTerms.isEmpty() || m_searchFields.isEmpty()) {
         return true;
     }
+    if (m_searchRoles.isEmpty()) {
+        return false;
+    }
+
+    if (!source_parent.isValid() && (source_row < m_filterResult.count()) &&
+            (m_filterResult.at(source_row) != Unmatched)) {
+        return (m_filterResult.at(source_row) == Accepted);
+    }
+
+    bool cached = !source_parent.isValid() && (source_row < m_searchRows.count());
+    if (cached && m_searchRows.at(source_row).rejected) {
+        return false;
+    }
+
+    const QString key = searchKey(source_row, source_parent);
+    Q_FOREACH(const QString& term, m_foldedTerms) {
+        if (!FoldedTextSearch::contains(key, term)) {
+            if (cached) {
+                m_searchRows[source_row].rejected = true;
+            }
+            return false;
+        }
+    }
+    return true;
+}
 
+/*
+    The new terms refine the current ones if each current term is contained
+    in one of the new terms: a row that matches the new terms then also
+    matches the current ones, so a row rejected now will still be rejected.
+*/
+bool TextSearchFilterModel::isRefinedBy(const QVector<QString>& foldedTerms) const
+{
+    return FoldedTextSearch::isRefinement(m_foldedTerms, foldedTerms);
+}
+
+/*
+    The first top-level source row past the limit, i.e. the one that follows
+    the last row to be returned, or INT_MAX if there are fewer matches than
+    the limit.
+*/
+int TextSearchFilterModel::limitRow() const
+{
     QAbstractItemModel* source = QSortFilterProxyModel::sourceModel();
-    QModelIndex index = source->index(source_row, 0, source_parent);
+    if ((m_limit < 0) || !source) {
+        return INT_MAX;
+    }
+    if (m_limit == 0) {
+        return 0;
+    }
+    int matches = 0;
+    int count = source->rowCount();
+    for (int row = 0; row < count; ++row) {
+        if (matchesRow(row, QModelIndex()) && (++matches == m_limit)) {
+            return row + 1;
+        }
+    }
+    return INT_MAX;
+}
 
-    QSet<QString> foundTerms;
-    int searchTermsCount = QSet<QString>::fromList(m_terms).count();
+void TextSearchFilterModel::applyFilter()
+{
+    m_limitRow = limitRow();
+    m_limitDirty = false;
+    invalidateFilter();
+}
 
-    Q_FOREACH(int role, m_searchRoles) {
-        QString value = source->data(index, role).toString();
-        Q_FOREACH (const QString& term, m_terms) {
-            if (value.contains(term, Qt::CaseInsensitive)) {
-                foundTerms.insert(term);
+void TextSearchFilterModel::updateLimitRow()
+{
+    if (m_limitDirty && !m_busy) {
+        m_limitDirty = false;
+        int limitRow = this->limitRow();
+        if (limitRow != m_limitRow) {
+            m_limitRow = limitRow;
+            invalidateFilter();
+            Q_EMIT countChanged();
+        }
+    }
+}
+
+void TextSearchFilterModel::forgetRejectedRows()
+{
+    for (int i = 0; i < m_searchRows.count(); ++i) {
+        m_searchRows[i].rejected = false;
+    }
+}
+
+void TextSearchFilterModel::setFoldedTerms(const QVector<QString>& foldedTerms)
+{
+    if (!isRefinedBy(foldedTerms)) {
+        forgetRejectedRows();
+    }
+    m_foldedTerms = foldedTerms;
+}
+
+/*
+    Snapshot the search keys of all rows and match them against new terms on
+    worker threads. Keys are computed here, as the source model can only be
+    accessed from the thread it lives in. Rejected rows are skipped if the
+    new terms refine the current ones, which the model keeps filtering with
+    until the matching is done.
+*/
+void TextSearchFilterModel::startFiltering(const QVector<QString>& foldedTerms)
+{
+    if (foldedTerms.isEmpty() || m_searchFields.isEmpty() || m_searchRoles.isEmpty()) {
+        // Nothing to match
+        cancelFiltering();
+        setFoldedTerms(foldedTerms);
+        applyFilter();
+        return;
+    }
+
+    bool refined = isRefinedBy(foldedTerms);
+    m_filterWatcher.cancel();
+    m_pendingChanges.clear();
+    m_pendingTerms = foldedTerms;
+    QList<QVector<QString>> chunks;
+    int count = m_searchRows.count();
+    for (int first = 0; first < count; first += FILTER_CHUNK_SIZE) {
+        int last = qMin(first + FILTER_CHUNK_SIZE, count);
+        QVector<QString> keys;
+        keys.reserve(last - first);
+        for (int i = first; i < last; ++i) {
+            bool rejected = refined && m_searchRows.at(i).rejected;
+            keys.append(rejected ? QString() : searchKey(i, QModelIndex()));
+        }
+        chunks.append(keys);
+    }
+    m_filterWatcher.setFuture(QtConcurrent::mapped(chunks, TermsMatcher(foldedTerms)));
+    setBusy(true);
+}
+
+/*
+    Abandon the matching in progress, if any, the new terms are to be applied
+    synchronously.
+*/
+void TextSearchFilterModel::cancelFiltering()
+{
+    if (m_busy) {
+        m_filterWatcher.cancel();
+        m_pendingChanges.clear();
+        setFoldedTerms(m_pendingTerms);
+        setBusy(false);
+    }
+}
+
+void TextSearchFilterModel::onFilterFinished()
+{
+    if (!m_busy || m_filterWatcher.isCanceled()) {
+        return;
+    }
+
+    m_filterResult.reserve(m_searchRows.count());
+    Q_FOREACH(const QVector<bool>& chunk, m_filterWatcher.future().results()) {
+        Q_FOREACH(bool accepted, chunk) {
+            m_filterResult.append(accepted ? Accepted : Rejected);
+        }
+    }
+    // Replay the changes to the source model since the snapshot was taken
+    Q_FOREACH(const SourceChange& change, m_pendingChanges) {
+        switch (change.type) {
+        case SourceChange::Inserted:
+            m_filterResult.insert(change.start, change.end - change.start + 1, Unmatched);
+            break;
+        case SourceChange::Removed:
+            m_filterResult.remove(change.start, change.end - change.start + 1);
+            break;
+        case SourceChange::Moved:
+            moveRows(m_filterResult, change.start, change.end, change.row);
+            break;
+        case SourceChange::Changed:
+            for (int i = change.start; i <= qMin(change.end, m_filterResult.count() - 1); ++i) {
+                m_filterResult[i] = Unmatched;
             }
-            if (foundTerms.count() == searchTermsCount) {
-                return true;
+            break;
+        }
+    }
+    m_pendingChanges.clear();
+    if (m_filterResult.count() != m_searchRows.count()) {
+        m_filterResult.clear();
+    }
+    setFoldedTerms(m_pendingTerms);
+    for (int i = 0; i < m_filterResult.count(); ++i) {
+        if (m_filterResult.at(i) != Unmatched) {
+            m_searchRows[i].rejected = (m_filterResult.at(i) == Rejected);
+        }
+    }
+    // The proxy model only notifies the rows that were added or removed
+    applyFilter();
+    m_filterResult.clear();
+    setBusy(false);
+    Q_EMIT countChanged();
+}
+
+void TextSearchFilterModel::onSourceRowsInserted(const QModelIndex& parent, int start, int end)
+{
+    if (!parent.isValid()) {
+        m_searchRows.insert(start, end - start + 1, SearchRow());
+        if ((m_limit >= 0) && (start < m_limitRow)) {
+            if (m_limitRow != INT_MAX) {
+                m_limitRow += end - start + 1;
+            }
+            m_limitDirty = true;
+        }
+        if (m_busy) {
+            SourceChange change = { SourceChange::Inserted, start, end, -1 };
+            m_pendingChanges.append(change);
+        }
+    }
+}
+
+void TextSearchFilterModel::onSourceRowsRemoved(const QModelIndex& parent, int start, int end)
+{
+    if (!parent.isValid()) {
+        m_searchRows.remove(start, end - start + 1);
+        if ((m_limit >= 0) && (start < m_limitRow)) {
+            if (m_limitRow != INT_MAX) {
+                m_limitRow -= qMin(end + 1, m_limitRow) - start;
             }
+            m_limitDirty = true;
+        }
+        if (m_busy) {
+            SourceChange change = { SourceChange::Removed, start, end, -1 };
+            m_pendingChanges.append(change);
         }
     }
-    return false;
+}
+
+void TextSearchFilterModel::onSourceRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row)
+{
+    if (parent.isValid() || destination.isValid()) {
+        resetSearchRows();
+        return;
+    }
+    m_limitDirty = m_limitDirty || ((m_limit >= 0) && ((start < m_limitRow) || (row < m_limitRow)));
+    moveRows(m_searchRows, start, end, row);
+    if (m_busy) {
+        SourceChange change = { SourceChange::Moved, start, end, row };
+        m_pendingChanges.append(change);
+    }
+}
+
+void TextSearchFilterModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+{
+    if (topLeft.parent().isValid()) {
+        return;
+    }
+    bool changed = roles.isEmpty();
+    Q_FOREACH(int role, m_searchRoles) {
+        changed = changed || roles.contains(role);
+    }
+    if (changed) {
+        int last = qMin(bottomRight.row(), m_searchRows.count() - 1);
+        for (int i = topLeft.row(); i <= last; ++i) {
+            m_searchRows[i] = SearchRow();
+        }
+        m_limitDirty = m_limitDirty || ((m_limit >= 0) && (topLeft.row() < m_limitRow));
+        if (m_busy) {
+            SourceChange change = { SourceChange::Changed, topLeft.row(), bottomRight.row(), -1 };
+            m_pendingChanges.append(change);
+        }
+    }
+}
+
+void TextSearchFilterModel::resetSearchRows()
+{
+    QAbstractItemModel* source = QSortFilterProxyModel::sourceModel();
+    m_searchRows = QVector<SearchRow>(source ? source->rowCount() : 0);
+    m_limitDirty = (m_limit >= 0);
+    if (m_busy) {
+        // The snapshot is meaningless after a reset
+        startFiltering(m_pendingTerms);
+    }
 }
 
 int TextSearchFilterModel::count() const
@@ -21,11 +21,13 @@
 
 // Qt
 #include <QtCore/QAbstractItemModel>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QList>
 #include <QtCore/QSortFilterProxyModel>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
 
 class TextSearchFilterModel : public QSortFilterProxyModel
 {
@@ -35,9 +37,13 @@ class TextSearchFilterModel : public QSortFilterProxyModel
     Q_PROPERTY(QStringList terms READ terms WRITE setTerms NOTIFY termsChanged)
     Q_PROPERTY(QStringList searchFields READ searchFields WRITE setSearchFields NOTIFY searchFieldsChanged)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
 
 public:
     TextSearchFilterModel(QObject* parent=0);
+    ~TextSearchFilterModel();
 
     QVariant sourceModel() const;
     void setSourceModel(QVariant sourceModel);
@@ -50,22 +56,88 @@ public:
     const QStringList& searchFields() const;
     void setSearchFields(const QStringList&);
 
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+
+    bool busy() const;
+
+    int limit() const;
+    void setLimit(int limit);
+
 Q_SIGNALS:
     void sourceModelChanged() const;
     void termsChanged() const;
     void searchFieldsChanged() const;
     void countChanged() const;
+    void asynchronousChanged() const;
+    void busyChanged() const;
+    void limitChanged() const;
 
 protected:
     // reimplemented from QSortFilterProxyModel
     bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
 
+private Q_SLOTS:
+    void onSourceRowsInserted(const QModelIndex& parent, int start, int end);
+    void onSourceRowsRemoved(const QModelIndex& parent, int start, int end);
+    void onSourceRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void resetSearchRows();
+    void onFilterFinished();
+    void updateLimitRow();
+
 private:
     void updateSearchRoles(const QAbstractItemModel* model);
+    QString searchKey(int row, const QModelIndex& parent) const;
+    bool matchesRow(int row, const QModelIndex& parent) const;
+    int limitRow() const;
+    void applyFilter();
+    bool isRefinedBy(const QVector<QString>& foldedTerms) const;
+    void forgetRejectedRows();
+    void setFoldedTerms(const QVector<QString>& foldedTerms);
+    void startFiltering(const QVector<QString>& foldedTerms);
+    void cancelFiltering();
+    void setBusy(bool busy);
+
+    struct SearchRow {
+        QString key;
+        bool rejected;
+    };
+
+    enum MatchState {
+        Rejected,
+        Accepted,
+        Unmatched
+    };
+
+    // Changes to the source model while matching asynchronously
+    struct SourceChange {
+        enum Type {
+            Inserted,
+            Removed,
+            Moved,
+            Changed
+        };
+        Type type;
+        int start;
+        int end;
+        int row;
+    };
 
     QStringList m_terms;
+    QVector<QString> m_foldedTerms;
+    QVector<QString> m_pendingTerms;
     QStringList m_searchFields;
     QList<int> m_searchRoles;
+    mutable QVector<SearchRow> m_searchRows;
+    bool m_asynchronous;
+    bool m_busy;
+    QFutureWatcher<QVector<bool>> m_filterWatcher;
+    QVector<SourceChange> m_pendingChanges;
+    QVector<MatchState> m_filterResult;
+    int m_limit;
+    int m_limitRow;
+    bool m_limitDirty;
 };
 
 
@@ -120,6 +120,86 @@ private Q_SLOTS:
         model->setFolder("SaMpLe");
         QCOMPARE(model->rowCount(), 0);
     }
+
+    void shouldKeepEntriesSortedChronologically()
+    {
+        model->setFolder("SampleFolder");
+        bookmarks->add(QUrl("http://example.org/"), "Example Domain Org", QUrl(), "SampleFolder");
+        bookmarks->add(QUrl("http://example.com/"), "Example Domain Com", QUrl(), "");
+        bookmarks->add(QUrl("http://example.net/"), "Example Domain Net", QUrl(), "SampleFolder");
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.net/"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.org/"));
+        QVERIFY(!model->data(model->index(2, 0), BookmarksModel::Url).isValid());
+    }
+
+    void shouldNotifyOnlyViewsOfChangedFolders()
+    {
+        BookmarksFolderModel other;
+        other.setSourceModel(bookmarks);
+        other.setFolder("AnotherFolder");
+        model->setFolder("SampleFolder");
+        bookmarks->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
+        bookmarks->add(QUrl("http://example.com/"), "Example Domain", QUrl(), "");
+
+        QSignalSpy spyInserted(model, SIGNAL(rowsInserted(QModelIndex, int, int)));
+        QSignalSpy spyRemoved(model, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+        QSignalSpy spyChanged(model, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)));
+        QSignalSpy spyCount(model, SIGNAL(countChanged()));
+        QSignalSpy spyOther(&other, SIGNAL(rowsInserted(QModelIndex, int, int)));
+
+        bookmarks->add(QUrl("http://example.net/"), "Example Domain", QUrl(), "");
+        bookmarks->update(QUrl("http://example.com/"), "New Title", "");
+        QVERIFY(spyInserted.isEmpty());
+        QVERIFY(spyChanged.isEmpty());
+        QVERIFY(spyCount.isEmpty());
+
+        bookmarks->update(QUrl("http://example.org/"), "New Title", "SampleFolder");
+        QCOMPARE(spyChanged.count(), 1);
+        QCOMPARE(spyChanged.first().at(0).toModelIndex().row(), 0);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Title).toString(), QString("New Title"));
+
+        bookmarks->update(QUrl("http://example.com/"), "New Title", "SampleFolder");
+        QCOMPARE(spyInserted.count(), 1);
+        QCOMPARE(spyCount.count(), 1);
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.com/"));
+        QVERIFY(spyOther.isEmpty());
+
+        bookmarks->update(QUrl("http://example.com/"), "New Title", "AnotherFolder");
+        QCOMPARE(spyRemoved.count(), 1);
+        QCOMPARE(spyRemoved.first().at(1).toInt(), 0);
+        QCOMPARE(spyOther.count(), 1);
+        QCOMPARE(other.rowCount(), 1);
+        QCOMPARE(model->rowCount(), 1);
+
+        bookmarks->remove(QUrl("http://example.org/"));
+        QCOMPARE(spyRemoved.count(), 2);
+        QCOMPARE(model->rowCount(), 0);
+        QCOMPARE(spyCount.count(), 3);
+    }
+
+    void shouldBeEmptiedWhenFolderIsRemoved()
+    {
+        model->setFolder("SampleFolder");
+        bookmarks->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
+        bookmarks->add(QUrl("http://example.com/"), "Example Domain", QUrl(), "SampleFolder");
+        QCOMPARE(model->rowCount(), 2);
+        QSignalSpy spyReset(model, SIGNAL(modelReset()));
+        bookmarks->removeFolder("SampleFolder");
+        QCOMPARE(spyReset.count(), 1);
+        QCOMPARE(model->rowCount(), 0);
+    }
+
+    void shouldBeEmptyWithoutSourceModel()
+    {
+        bookmarks->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        QCOMPARE(model->rowCount(), 1);
+        model->setSourceModel(0);
+        QCOMPARE(model->rowCount(), 0);
+        QVERIFY(!model->data(model->index(0, 0), BookmarksModel::Url).isValid());
+        QVERIFY(model->roleNames().isEmpty());
+    }
 };
 
 QTEST_MAIN(BookmarksFolderModelTests)
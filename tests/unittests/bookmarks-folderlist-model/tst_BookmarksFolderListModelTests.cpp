@@ -18,6 +18,7 @@
 
 // Qt
 #include <QtCore/QObject>
+#include <QtCore/QTemporaryFile>
 #include <QtTest/QSignalSpy>
 #include <QtTest/QtTest>
 
@@ -108,6 +109,36 @@ private Q_SLOTS:
         QCOMPARE(entries->rowCount(), 0);
     }
 
+    void shouldAddFoldersLoadedFromDatabaseInOneBatch()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        BookmarksModel* source = new BookmarksModel;
+        source->setDatabasePath(fileName);
+        source->addFolder("Folder02");
+        source->addFolder("Folder01");
+        source->addFolder("Folder03");
+        delete source;
+
+        source = new BookmarksModel;
+        model->setSourceModel(source);
+        QSignalSpy spyLoaded(source, SIGNAL(loaded()));
+        QSignalSpy spyRowsInserted(model, SIGNAL(rowsInserted(const QModelIndex&, int, int)));
+        QSignalSpy spyReset(model, SIGNAL(modelReset()));
+        source->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 4);
+        QCOMPARE(model->indexOf("Folder01"), 1);
+        QCOMPARE(model->indexOf("Folder03"), 3);
+        // One reset when setting the database, one for the batch of folders
+        QCOMPARE(spyReset.count(), 2);
+        // The default folder is added right away
+        QCOMPARE(spyRowsInserted.count(), 1);
+        model->setSourceModel(bookmarks);
+        delete source;
+    }
+
     void shouldNotUpdateFolderListWhenRemovingEntries()
     {
         bookmarks->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
@@ -263,6 +294,86 @@ private Q_SLOTS:
         QCOMPARE(entries->rowCount(), 1);
         QCOMPARE(entries->data(entries->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.org/"));
     }
+
+    void shouldLookUpFoldersByName()
+    {
+        bookmarks->addFolder("Folder02");
+        bookmarks->addFolder("Folder01");
+        bookmarks->addFolder("Folder03");
+        QCOMPARE(model->indexOf(""), 0);
+        QCOMPARE(model->indexOf("Folder01"), 1);
+        QCOMPARE(model->indexOf("Folder02"), 2);
+        QCOMPARE(model->indexOf("Folder03"), 3);
+        QCOMPARE(model->indexOf("Folder04"), -1);
+        bookmarks->addFolder("Folder00");
+        QCOMPARE(model->indexOf("Folder00"), 1);
+        QCOMPARE(model->indexOf("Folder03"), 4);
+        for (int i = 0; i < model->rowCount(); ++i) {
+            QString folder = model->data(model->index(i, 0), BookmarksFolderListModel::Folder).toString();
+            QCOMPARE(model->indexOf(folder), i);
+        }
+    }
+
+    void shouldRemoveFolder()
+    {
+        bookmarks->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "Folder02");
+        bookmarks->addFolder("Folder01");
+        bookmarks->addFolder("Folder03");
+        QCOMPARE(model->rowCount(), 4);
+        QSignalSpy spyRowsRemoved(model, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+        bookmarks->removeFolder("Folder02");
+        QCOMPARE(spyRowsRemoved.count(), 1);
+        QCOMPARE(spyRowsRemoved.first().at(1).toInt(), 2);
+        QCOMPARE(model->rowCount(), 3);
+        QCOMPARE(model->indexOf("Folder02"), -1);
+        QCOMPARE(model->indexOf("Folder03"), 2);
+    }
+
+    void benchmarkAddWithManyFolders()
+    {
+        for (int i = 0; i < 200; ++i) {
+            bookmarks->addFolder(QString("Folder%1").arg(i, 3, 10, QChar('0')));
+        }
+        for (int i = 0; i < 2000; ++i) {
+            bookmarks->add(QUrl(QString("http://example.org/%1").arg(i)), "Example Domain", QUrl(),
+                           QString("Folder%1").arg(i % 200, 3, 10, QChar('0')));
+        }
+        int i = 0;
+        QBENCHMARK {
+            QUrl url(QString("http://example.com/%1").arg(i++));
+            bookmarks->add(url, "Example Domain", QUrl(), "Folder100");
+            bookmarks->update(url, "Example", "Folder150");
+        }
+    }
+
+    void benchmarkData()
+    {
+        for (int i = 0; i < 200; ++i) {
+            bookmarks->addFolder(QString("Folder%1").arg(i, 3, 10, QChar('0')));
+        }
+        QCOMPARE(model->rowCount(), 201);
+        QBENCHMARK {
+            for (int i = 0; i < model->rowCount(); ++i) {
+                QModelIndex index = model->index(i, 0);
+                model->data(index, BookmarksFolderListModel::Folder);
+                model->data(index, BookmarksFolderListModel::Entries);
+            }
+        }
+    }
+
+    void benchmarkIndexOf()
+    {
+        QStringList folders;
+        for (int i = 0; i < 200; ++i) {
+            folders.append(QString("Folder%1").arg(i, 3, 10, QChar('0')));
+            bookmarks->addFolder(folders.last());
+        }
+        QBENCHMARK {
+            Q_FOREACH(const QString& folder, folders) {
+                model->indexOf(folder);
+            }
+        }
+    }
 };
 
 QTEST_MAIN(BookmarksFolderListModelTests)
@@ -24,6 +24,7 @@
 
 // local
 #include "bookmarks-model.h"
+#include "database-fixtures.h"
 
 class BookmarksModelTests : public QObject
 {
@@ -32,6 +33,13 @@ class BookmarksModelTests : public QObject
 private:
     BookmarksModel* model;
 
+    void writeFile(QTemporaryFile& file, const QByteArray& contents)
+    {
+        QVERIFY(file.open());
+        file.write(contents);
+        file.close();
+    }
+
 private Q_SLOTS:
     void init()
     {
@@ -205,10 +213,186 @@ private Q_SLOTS:
         model->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl(), "");
         delete model;
         model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
         model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
         QCOMPARE(model->rowCount(), 2);
     }
 
+    void shouldLoadAsynchronously()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new BookmarksModel;
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
+        model->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl(), "");
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), "");
+        model->remove(QUrl("http://example.com/"));
+        model->update(QUrl("http://ubuntu.com/"), "Ubuntu", "AnotherFolder");
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        QSignalSpy spyCount(model, SIGNAL(rowCountChanged()));
+        model->setDatabasePath(fileName);
+        QCOMPARE(model->rowCount(), 0);
+        QVERIFY(!model->contains(QUrl("http://example.org/")));
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 2);
+        QVERIFY(spyCount.count() >= 2);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://ubuntu.com/"));
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Folder).toString(), QString("AnotherFolder"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.org/"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Folder).toString(), QString("SampleFolder"));
+        QVERIFY(!model->contains(QUrl("http://example.com/")));
+        QCOMPARE(model->folders().count(), 3);
+    }
+
+    void shouldNotDuplicateEntriesAddedWhileLoading()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new BookmarksModel;
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example", QUrl(), "");
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 1);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Title).toString(), QString("Example"));
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyReloaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyReloaded.wait());
+        QCOMPARE(model->rowCount(), 1);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Title).toString(), QString("Example"));
+    }
+
+    void shouldKeepEntriesSortedWhenLoadingAfterAdding()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateBookmarks(fileName, 10, 0);
+        // Created later than the entry added while loading (e.g. synced
+        // from a device whose clock is ahead)
+        DatabaseFixtures::query(fileName, "UPDATE bookmarks SET created = created + 3600000 "
+                                          "WHERE url IN ('http://example0.org/page0', "
+                                          "'http://example1.org/page1');");
+
+        delete model;
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        QSignalSpy spyInserted(model, SIGNAL(rowsInserted(const QModelIndex&, int, int)));
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 11);
+
+        // Inserted before and after the added entry
+        QCOMPARE(spyInserted.count(), 3);
+        QCOMPARE(spyInserted.at(1).at(1).toInt(), 0);
+        QCOMPARE(spyInserted.at(1).at(2).toInt(), 1);
+        QCOMPARE(spyInserted.at(2).at(1).toInt(), 3);
+        QCOMPARE(spyInserted.at(2).at(2).toInt(), 10);
+
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(),
+                 QUrl("http://example0.org/page0"));
+        QCOMPARE(model->data(model->index(2, 0), BookmarksModel::Url).toUrl(),
+                 QUrl("http://example.org/"));
+        QCOMPARE(model->data(model->index(3, 0), BookmarksModel::Url).toUrl(),
+                 QUrl("http://example2.org/page2"));
+        QCOMPARE(model->folderEntryCount(""), 11);
+        for (int i = 0; i < model->rowCount(); ++i) {
+            QCOMPARE(model->folderEntryData("", i, BookmarksModel::Url),
+                     model->data(model->index(i, 0), BookmarksModel::Url));
+        }
+
+        // Entries are still found by their creation date
+        model->remove(QUrl("http://example1.org/page1"));
+        QCOMPARE(model->rowCount(), 10);
+        QVERIFY(!model->contains(QUrl("http://example1.org/page1")));
+    }
+
+    void shouldMoveNewEntryToNewFolderBeforeFlushing()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new BookmarksModel;
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        model->addFolder("SampleFolder");
+        model->update(QUrl("http://example.org/"), "Example", "SampleFolder");
+        model->update(QUrl("http://example.org/"), "Example", "AnotherFolder");
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 1);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Title).toString(), QString("Example"));
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Folder).toString(), QString("AnotherFolder"));
+    }
+
+    void shouldRemoveDuplicateUrlsFromLegacyDatabase()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateBookmarks(fileName, 10, 0);
+        DatabaseFixtures::query(fileName, "INSERT INTO bookmarks (url, title, icon, created) "
+                                          "SELECT url, 'Duplicate', icon, created + 1000 FROM bookmarks "
+                                          "WHERE url = 'http://example3.org/page3';");
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM bookmarks;").toInt(), 11);
+
+        delete model;
+        model = new BookmarksModel;
+        DatabaseFixtures::loadModel(model, fileName, 10);
+        int index = -1;
+        for (int i = 0; i < model->rowCount(); ++i) {
+            if (model->data(model->index(i, 0), BookmarksModel::Url).toUrl() == QUrl("http://example3.org/page3")) {
+                index = i;
+            }
+        }
+        QVERIFY(index != -1);
+        QCOMPARE(model->data(model->index(index, 0), BookmarksModel::Title).toString(), QString("Duplicate"));
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM sqlite_master "
+                                                   "WHERE type = 'index' AND name = 'bookmarks_url';").toInt(), 1);
+    }
+
+    void shouldDropEntriesFetchedFromPreviousDatabase()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateBookmarks(fileName, 100, 2);
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        model->setDatabasePath(":memory:");
+        QVERIFY(spyLoaded.wait());
+        QTest::qWait(100);
+        QCOMPARE(spyLoaded.count(), 1);
+        QCOMPARE(model->rowCount(), 0);
+        QCOMPARE(model->folders().count(), 1);
+    }
+
     void shouldCountNumberOfEntries()
     {
         QSignalSpy spyCount(model, SIGNAL(rowCountChanged()));
@@ -241,10 +425,348 @@ private Q_SLOTS:
         delete model;
         model = new BookmarksModel;
         QSignalSpy spyPopulate(model, SIGNAL(folderAdded(QString)));
+        QSignalSpy spyPopulateBatch(model, SIGNAL(foldersAdded(QStringList)));
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
         model->setDatabasePath(fileName);
-        QCOMPARE(spyPopulate.count(), 3);
+        QVERIFY(spyLoaded.wait());
+        // Existing folders are notified in a single batch once loaded
+        QCOMPARE(spyPopulate.count(), 1);
+        QCOMPARE(spyPopulateBatch.count(), 1);
+        QStringList folders = spyPopulateBatch.first().at(0).toStringList();
+        QCOMPARE(folders.count(), 2);
+        QVERIFY(folders.contains("SampleFolder"));
+        QVERIFY(folders.contains("AnotherFolder"));
         QCOMPARE(model->folders().count(), 3);
     }
+
+    void shouldPublishLoadedEntriesAtOnce()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateBookmarks(fileName, 5000, 10);
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        QSignalSpy spyReset(model, SIGNAL(modelReset()));
+        QSignalSpy spyInserted(model, SIGNAL(rowsInserted(QModelIndex, int, int)));
+        model->setDatabasePath(fileName);
+        QCOMPARE(spyReset.count(), 1);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(spyReset.count(), 2);
+        QVERIFY(spyInserted.isEmpty());
+        QCOMPARE(model->rowCount(), 5000);
+        QCOMPARE(model->folders().count(), 11);
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoadedAgain(model, SIGNAL(loaded()));
+        QSignalSpy spyInsertedAgain(model, SIGNAL(rowsInserted(QModelIndex, int, int)));
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        QCOMPARE(spyInsertedAgain.count(), 1);
+        QVERIFY(spyLoadedAgain.wait());
+        QCOMPARE(spyInsertedAgain.count(), 2);
+        QVariantList args = spyInsertedAgain.at(1);
+        QCOMPARE(args.at(1).toInt(), 1);
+        QCOMPARE(args.at(2).toInt(), 5000);
+        QCOMPARE(model->rowCount(), 5001);
+    }
+
+    void shouldRemoveFolders()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new BookmarksModel;
+        model->setDatabasePath(fileName);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), "SampleFolder");
+        model->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl(), "");
+        model->add(QUrl("http://example.net/"), "Example Domain", QUrl(), "SampleFolder");
+        model->addFolder("AnotherFolder");
+
+        QSignalSpy spyRemoved(model, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+        QSignalSpy spyFolderRemoved(model, SIGNAL(folderRemoved(QString)));
+        model->removeFolder("");
+        model->removeFolder("NoSuchFolder");
+        QVERIFY(spyFolderRemoved.isEmpty());
+
+        model->removeFolder("SampleFolder");
+        QCOMPARE(spyFolderRemoved.count(), 1);
+        QCOMPARE(spyFolderRemoved.first().at(0).toString(), QString("SampleFolder"));
+        QCOMPARE(spyRemoved.count(), 2);
+        QCOMPARE(spyRemoved.at(0).at(1).toInt(), 2);
+        QCOMPARE(spyRemoved.at(0).at(2).toInt(), 3);
+        QCOMPARE(spyRemoved.at(1).at(1).toInt(), 0);
+        QCOMPARE(spyRemoved.at(1).at(2).toInt(), 0);
+        QCOMPARE(model->rowCount(), 1);
+        QVERIFY(!model->contains(QUrl("http://example.org/")));
+        QVERIFY(model->contains(QUrl("http://ubuntu.com/")));
+        QCOMPARE(model->folders().count(), 2);
+        QCOMPARE(model->folderEntryCount("SampleFolder"), 0);
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 1);
+        QCOMPARE(model->folders().count(), 2);
+        QVERIFY(!model->folders().contains("SampleFolder"));
+    }
+
+    void shouldPartitionEntriesByFolder()
+    {
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "SampleFolder");
+        model->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl(), "");
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), "SampleFolder");
+        QCOMPARE(model->folderEntryCount(""), 1);
+        QCOMPARE(model->folderEntryCount("SampleFolder"), 2);
+        QCOMPARE(model->folderEntryCount("AnotherFolder"), 0);
+        QCOMPARE(model->folderEntryData("SampleFolder", 0, BookmarksModel::Url).toUrl(), QUrl("http://example.com/"));
+        QCOMPARE(model->folderEntryData("SampleFolder", 1, BookmarksModel::Url).toUrl(), QUrl("http://example.org/"));
+        QVERIFY(!model->folderEntryData("SampleFolder", 2, BookmarksModel::Url).isValid());
+
+        model->update(QUrl("http://ubuntu.com/"), "Ubuntu", "SampleFolder");
+        QCOMPARE(model->folderEntryCount(""), 0);
+        QCOMPARE(model->folderEntryCount("SampleFolder"), 3);
+    }
+
+    void shouldMatchUrlsInDatabase()
+    {
+        QSignalSpy spy(model, SIGNAL(urlsMatched(int, const QList<QUrl>&)));
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        model->add(QUrl("https://ubports.com/"), "UBports", QUrl(), "");
+
+        int requestId = model->matchUrls(QStringList() << "ubp", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        QList<QVariant> args = spy.takeFirst();
+        QCOMPARE(args.at(0).toInt(), requestId);
+        QList<QUrl> urls = args.at(1).value<QList<QUrl>>();
+        QCOMPARE(urls.count(), 1);
+        QCOMPARE(urls.first(), QUrl("https://ubports.com/"));
+
+        model->update(QUrl("https://ubports.com/"), "Ubuntu Touch", "");
+        model->matchUrls(QStringList() << "touch", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        urls = spy.takeFirst().at(1).value<QList<QUrl>>();
+        QCOMPARE(urls.count(), 1);
+        QCOMPARE(urls.first(), QUrl("https://ubports.com/"));
+
+        model->remove(QUrl("http://example.org/"));
+        model->matchUrls(QStringList() << "example", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        QVERIFY(spy.takeFirst().at(1).value<QList<QUrl>>().isEmpty());
+    }
+
+    void shouldImportNetscapeBookmarksFile()
+    {
+        QTemporaryFile file(QDir::tempPath() + "/bookmarksXXXXXX.html");
+        writeFile(file,
+            "<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+            "<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; charset=UTF-8\">\n"
+            "<TITLE>Bookmarks</TITLE>\n"
+            "<H1>Bookmarks</H1>\n"
+            "<DL><p>\n"
+            "    <DT><H3 ADD_DATE=\"1500000000\">News &amp; Weather</H3>\n"
+            "    <DL><p>\n"
+            "        <DT><A HREF=\"http://example.com/\" ADD_DATE=\"1500000100\">Example</A>\n"
+            "        <DT><H3>Nested</H3>\n"
+            "        <DL><p>\n"
+            "            <DT><A HREF=\"http://example.net/?a=1&amp;b=2\" ADD_DATE=\"1500000200\">Caf\xc3\xa9 &lt;net&gt;</A>\n"
+            "        </DL><p>\n"
+            "    </DL><p>\n"
+            "    <DT><A HREF=\"http://example.org/\" ADD_DATE=\"1500000300\">Example again</A>\n"
+            "    <DT><A HREF=\"place:sort=8&amp;maxResults=10\">Recent</A>\n"
+            "    <DT><A HREF=\"http://ubuntu.com/\" ADD_DATE=\"1500000400\">Ubuntu</A>\n"
+            "    <DT><A HREF=\"http://example.com/\" ADD_DATE=\"1500000500\">Duplicate</A>\n"
+            "</DL><p>\n");
+
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), "");
+        QSignalSpy spyFinished(model, SIGNAL(importFinished(bool, int)));
+        QSignalSpy spyReset(model, SIGNAL(modelReset()));
+        QSignalSpy spyFolders(model, SIGNAL(foldersAdded(QStringList)));
+        model->importBookmarks(file.fileName());
+        QVERIFY(spyFinished.wait());
+        QVERIFY(spyFinished.first().at(0).toBool());
+        QCOMPARE(spyFinished.first().at(1).toInt(), 3);
+        QCOMPARE(spyReset.count(), 1);
+        QCOMPARE(spyFolders.count(), 1);
+        QCOMPARE(model->rowCount(), 4);
+        QCOMPARE(model->folders().count(), 3);
+        QVERIFY(model->folders().contains("News & Weather"));
+        QVERIFY(model->folders().contains("Nested"));
+
+        // Still sorted chronologically
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.org/"));
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Title).toString(), QString("Example Domain"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Url).toUrl(), QUrl("http://ubuntu.com/"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Folder).toString(), QString(""));
+        QCOMPARE(model->data(model->index(2, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.net/?a=1&b=2"));
+        QCOMPARE(model->data(model->index(2, 0), BookmarksModel::Title).toString(), QString::fromUtf8("Caf\xc3\xa9 <net>"));
+        QCOMPARE(model->data(model->index(2, 0), BookmarksModel::Folder).toString(), QString("Nested"));
+        QCOMPARE(model->data(model->index(2, 0), BookmarksModel::Created).toDateTime(),
+                 QDateTime::fromMSecsSinceEpoch(1500000200000));
+        QCOMPARE(model->data(model->index(3, 0), BookmarksModel::Url).toUrl(), QUrl("http://example.com/"));
+        QCOMPARE(model->data(model->index(3, 0), BookmarksModel::Title).toString(), QString("Example"));
+        QCOMPARE(model->data(model->index(3, 0), BookmarksModel::Folder).toString(), QString("News & Weather"));
+    }
+
+    void shouldFailToImportInvalidFiles()
+    {
+        QSignalSpy spyFinished(model, SIGNAL(importFinished(bool, int)));
+        model->importBookmarks(QDir::tempPath() + "/does-not-exist.html");
+        QVERIFY(spyFinished.wait());
+        QVERIFY(!spyFinished.takeFirst().at(0).toBool());
+
+        QTemporaryFile file(QDir::tempPath() + "/bookmarksXXXXXX.json");
+        writeFile(file, "{ \"not\": \"an array\" }");
+        model->importBookmarks(file.fileName());
+        QVERIFY(spyFinished.wait());
+        QVERIFY(!spyFinished.takeFirst().at(0).toBool());
+        QCOMPARE(model->rowCount(), 0);
+    }
+
+    void shouldExportAndImportBookmarks_data()
+    {
+        QTest::addColumn<QString>("suffix");
+        QTest::newRow("html") << QString(".html");
+        QTest::newRow("json") << QString(".json");
+    }
+
+    void shouldExportAndImportBookmarks()
+    {
+        QFETCH(QString, suffix);
+        model->add(QUrl("http://example.org/"), "Example \"Domain\"", QUrl(), "");
+        model->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl("image://webicon/123"), "Sample <Folder>");
+        model->add(QUrl("http://example.com/"), "Example", QUrl(), "AnotherFolder");
+
+        QTemporaryFile file(QDir::tempPath() + "/bookmarksXXXXXX" + suffix);
+        QVERIFY(file.open());
+        file.close();
+        QSignalSpy spyExported(model, SIGNAL(exportFinished(bool, int)));
+        model->exportBookmarks(file.fileName());
+        QVERIFY(spyExported.wait());
+        QVERIFY(spyExported.first().at(0).toBool());
+        QCOMPARE(spyExported.first().at(1).toInt(), 3);
+
+        BookmarksModel imported;
+        imported.setDatabasePath(":memory:");
+        QSignalSpy spyImported(&imported, SIGNAL(importFinished(bool, int)));
+        imported.importBookmarks(file.fileName());
+        QVERIFY(spyImported.wait());
+        QVERIFY(spyImported.first().at(0).toBool());
+        QCOMPARE(imported.rowCount(), 3);
+        QCOMPARE(imported.folders().count(), 3);
+        for (int i = 0; i < 3; ++i) {
+            QModelIndex original = model->index(i, 0);
+            QModelIndexList matches = imported.match(imported.index(0, 0), BookmarksModel::Url,
+                                                     model->data(original, BookmarksModel::Url),
+                                                     1, Qt::MatchExactly);
+            QCOMPARE(matches.count(), 1);
+            QModelIndex index = matches.first();
+            QCOMPARE(imported.data(index, BookmarksModel::Title), model->data(original, BookmarksModel::Title));
+            QCOMPARE(imported.data(index, BookmarksModel::Icon).toUrl(), model->data(original, BookmarksModel::Icon).toUrl());
+            QCOMPARE(imported.data(index, BookmarksModel::Folder), model->data(original, BookmarksModel::Folder));
+        }
+    }
+
+    void shouldPersistImportedBookmarks()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        QTemporaryFile file(QDir::tempPath() + "/bookmarksXXXXXX.json");
+        writeFile(file,
+            "[{\"url\": \"http://example.org/\", \"title\": \"Example\", \"created\": 1500000000000},\n"
+            " {\"url\": \"http://ubuntu.com/\", \"title\": \"Ubuntu\", \"folder\": \"SampleFolder\"}]");
+        delete model;
+        model = new BookmarksModel;
+        model->setDatabasePath(fileName);
+        QSignalSpy spyFinished(model, SIGNAL(importFinished(bool, int)));
+        model->importBookmarks(file.fileName());
+        QVERIFY(spyFinished.wait());
+        QCOMPARE(spyFinished.first().at(1).toInt(), 2);
+        delete model;
+
+        model = new BookmarksModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Url).toUrl(), QUrl("http://ubuntu.com/"));
+        QCOMPARE(model->data(model->index(0, 0), BookmarksModel::Folder).toString(), QString("SampleFolder"));
+        QCOMPARE(model->data(model->index(1, 0), BookmarksModel::Created).toDateTime(),
+                 QDateTime::fromMSecsSinceEpoch(1500000000000));
+        QCOMPARE(model->folders().count(), 2);
+    }
+
+    void benchmarkTimeToLoaded_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("1000 entries") << 1000;
+        QTest::newRow("5000 entries") << 5000;
+        QTest::newRow("20000 entries") << 20000;
+        QTest::newRow("50000 entries") << 50000;
+    }
+
+    void benchmarkTimeToLoaded()
+    {
+        QFETCH(int, size);
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateBookmarks(fileName, size, 50);
+        delete model;
+        model = nullptr;
+        QBENCHMARK {
+            BookmarksModel bookmarks;
+            QSignalSpy spyLoaded(&bookmarks, SIGNAL(loaded()));
+            bookmarks.setDatabasePath(fileName);
+            QVERIFY(spyLoaded.wait(60000));
+            QCOMPARE(bookmarks.rowCount(), size);
+        }
+        model = new BookmarksModel;
+    }
+
+    void benchmarkImport_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("1000 entries") << 1000;
+        QTest::newRow("10000 entries") << 10000;
+    }
+
+    void benchmarkImport()
+    {
+        QFETCH(int, size);
+        QByteArray contents("<!DOCTYPE NETSCAPE-Bookmark-file-1>\n<H1>Bookmarks</H1>\n<DL><p>\n");
+        for (int i = 0; i < size; ++i) {
+            if (i % 100 == 0) {
+                contents.append(QString("    <DT><H3>Folder %1</H3>\n    <DL><p>\n").arg(i / 100).toUtf8());
+            }
+            contents.append(QString("        <DT><A HREF=\"http://example%1.org/page%2\" ADD_DATE=\"%3\">Example Page %2</A>\n")
+                            .arg(i % 1000).arg(i).arg(1500000000 + i).toUtf8());
+            if (i % 100 == 99) {
+                contents.append("    </DL><p>\n");
+            }
+        }
+        contents.append("</DL><p>\n");
+        QTemporaryFile file(QDir::tempPath() + "/bookmarksXXXXXX.html");
+        writeFile(file, contents);
+        QBENCHMARK {
+            QTemporaryFile tempFile;
+            tempFile.open();
+            BookmarksModel bookmarks;
+            bookmarks.setDatabasePath(tempFile.fileName());
+            QSignalSpy spyFinished(&bookmarks, SIGNAL(importFinished(bool, int)));
+            bookmarks.importBookmarks(file.fileName());
+            QVERIFY(spyFinished.wait(60000));
+            QCOMPARE(bookmarks.rowCount(), size);
+        }
+    }
 };
 
 QTEST_MAIN(BookmarksModelTests)
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DATABASE_FIXTURES_H__
+#define __DATABASE_FIXTURES_H__
+
+// Qt
+#include <QtCore/QDateTime>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+namespace DatabaseFixtures {
+
+// Write 'count' entries to a history database with the legacy schema (no
+// migration applied yet), one visited every minute, most recent first.
+// Entry i is http://example<i % domains>.org/page<i>, visited 1 + i % 10 times.
+static void populateHistory(const QString& fileName, int count, int domains=1000)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "populate");
+        database.setDatabaseName(fileName);
+        database.open();
+        QSqlQuery createQuery(database);
+        createQuery.exec("CREATE TABLE IF NOT EXISTS history "
+                         "(url VARCHAR, domain VARCHAR, title VARCHAR,"
+                         " icon VARCHAR, visits INTEGER, lastVisit DATETIME);");
+        database.transaction();
+        QSqlQuery insertQuery(database);
+        insertQuery.prepare("INSERT INTO history (url, domain, title, icon, visits, lastVisit) "
+                            "VALUES (?, ?, ?, ?, ?, ?);");
+        uint now = QDateTime::currentDateTimeUtc().toTime_t();
+        for (int i = 0; i < count; ++i) {
+            insertQuery.bindValue(0, QString("http://example%1.org/page%2").arg(i % domains).arg(i));
+            insertQuery.bindValue(1, QString("example%1.org").arg(i % domains));
+            insertQuery.bindValue(2, QString("Example Page %1").arg(i));
+            insertQuery.bindValue(3, QString());
+            insertQuery.bindValue(4, 1 + i % 10);
+            insertQuery.bindValue(5, now - i * 60);
+            insertQuery.exec();
+        }
+        database.commit();
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("populate");
+}
+
+// Write 'count' bookmarks to a database, one created every minute, most
+// recent first, spread over 'folders' folders and the default one.
+// Bookmark i is http://example<i % 1000>.org/page<i>.
+static void populateBookmarks(const QString& fileName, int count, int folders)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "populate");
+        database.setDatabaseName(fileName);
+        database.open();
+        QSqlQuery createQuery(database);
+        createQuery.exec("CREATE TABLE IF NOT EXISTS bookmarks "
+                         "(url VARCHAR, title VARCHAR, icon VARCHAR, "
+                         "created INTEGER, folderId INTEGER);");
+        createQuery.exec("CREATE TABLE IF NOT EXISTS folders "
+                         "(folderId INTEGER PRIMARY KEY, folder VARCHAR);");
+        database.transaction();
+        QSqlQuery insertFolderQuery(database);
+        insertFolderQuery.prepare("INSERT INTO folders (folderId, folder) VALUES (?, ?);");
+        for (int i = 1; i <= folders; ++i) {
+            insertFolderQuery.bindValue(0, i);
+            insertFolderQuery.bindValue(1, QString("Folder %1").arg(i));
+            insertFolderQuery.exec();
+        }
+        QSqlQuery insertQuery(database);
+        insertQuery.prepare("INSERT INTO bookmarks (url, title, icon, created, folderId) "
+                            "VALUES (?, ?, ?, ?, ?);");
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; i < count; ++i) {
+            insertQuery.bindValue(0, QString("http://example%1.org/page%2").arg(i % 1000).arg(i));
+            insertQuery.bindValue(1, QString("Example Page %1").arg(i));
+            insertQuery.bindValue(2, QString());
+            insertQuery.bindValue(3, now - i * 60000);
+            insertQuery.bindValue(4, (folders > 0) ? QVariant(1 + i % (folders + 1)) : QVariant());
+            insertQuery.exec();
+        }
+        database.commit();
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("populate");
+}
+
+// Run a statement on a database, and return the first column of the first
+// row of the result, if any.
+static QVariant query(const QString& fileName, const QString& statement)
+{
+    QVariant result;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "query");
+        database.setDatabaseName(fileName);
+        database.open();
+        QSqlQuery query(database);
+        query.exec(statement);
+        if (query.next()) {
+            result = query.value(0);
+        }
+        query.finish();
+        database.close();
+    }
+    QSqlDatabase::removeDatabase("query");
+    return result;
+}
+
+// Point a model (history or bookmarks) to a database, and wait until
+// it is loaded with the expected number of entries.
+template<class Model>
+static void loadModel(Model* model, const QString& fileName, int count)
+{
+    QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+    model->setDatabasePath(fileName);
+    QVERIFY(spyLoaded.wait(60000));
+    QCOMPARE(model->rowCount(), count);
+}
+
+} // namespace DatabaseFixtures
+
+#endif // __DATABASE_FIXTURES_H__
@@ -99,6 +99,75 @@ private Q_SLOTS:
         model->setDomain("");
         QCOMPARE(model->rowCount(), 2);
     }
+
+    void shouldOnlyBeNotifiedOfChangesToItsDomain()
+    {
+        model->setDomain("example.org");
+        QSignalSpy spyRowsInserted(model, SIGNAL(rowsInserted(const QModelIndex&, int, int)));
+        QSignalSpy spyRowsMoved(model, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+        QSignalSpy spyRowsRemoved(model, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+        qRegisterMetaType<QVector<int> >();
+        QSignalSpy spyDataChanged(model, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+
+        history->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com/test"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        history->removeEntryByUrl(QUrl("http://example.com/test"));
+        QVERIFY(spyRowsInserted.isEmpty());
+        QVERIFY(spyRowsMoved.isEmpty());
+        QVERIFY(spyRowsRemoved.isEmpty());
+        QVERIFY(spyDataChanged.isEmpty());
+        QCOMPARE(model->rowCount(), 0);
+
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com/test"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.org/test"), "Test Page", QUrl());
+        QCOMPARE(spyRowsInserted.count(), 2);
+        QList<QVariant> args = spyRowsInserted.takeLast();
+        QCOMPARE(args.at(1).toInt(), 0);
+        QCOMPARE(args.at(2).toInt(), 0);
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/test"));
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/"));
+
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        QCOMPARE(spyRowsMoved.count(), 1);
+        args = spyRowsMoved.takeFirst();
+        QCOMPARE(args.at(1).toInt(), 1);
+        QCOMPARE(args.at(2).toInt(), 1);
+        QCOMPARE(args.at(4).toInt(), 0);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/"));
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/test"));
+        QCOMPARE(spyDataChanged.count(), 1);
+        args = spyDataChanged.takeFirst();
+        QCOMPARE(args.at(0).toModelIndex().row(), 0);
+
+        history->update(QUrl("http://example.org/test"), "Updated", QUrl());
+        QCOMPARE(spyDataChanged.count(), 1);
+        args = spyDataChanged.takeFirst();
+        QCOMPARE(args.at(0).toModelIndex().row(), 1);
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Title).toString(), QString("Updated"));
+
+        history->removeEntryByUrl(QUrl("http://example.org/test"));
+        QCOMPARE(spyRowsRemoved.count(), 1);
+        args = spyRowsRemoved.takeFirst();
+        QCOMPARE(args.at(1).toInt(), 1);
+        QCOMPARE(args.at(2).toInt(), 1);
+        QCOMPARE(model->rowCount(), 1);
+
+        QSignalSpy spyModelReset(model, SIGNAL(modelReset()));
+        history->removeEntriesByDomain("example.org");
+        QCOMPARE(spyModelReset.count(), 1);
+        QCOMPARE(model->rowCount(), 0);
+        QCOMPARE(history->rowCount(), 2);
+    }
+
+    void shouldBeCaseInsensitive()
+    {
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->setDomain("Example.ORG");
+        QCOMPARE(model->rowCount(), 1);
+    }
 };
 
 QTEST_MAIN(HistoryDomainModelTests)
@@ -17,10 +17,12 @@
  */
 
 // Qt
+#include <QtCore/QTemporaryFile>
 #include <QtTest/QSignalSpy>
 #include <QtTest/QtTest>
 
 // local
+#include "database-fixtures.h"
 #include "domain-utils.h"
 #include "history-model.h"
 #include "history-domain-model.h"
@@ -89,7 +91,8 @@ private Q_SLOTS:
         QCOMPARE(args.at(1).toInt(), 0);
         QCOMPARE(args.at(2).toInt(), 0);
         QCOMPARE(model->rowCount(), 2);
-        QCOMPARE(model->data(model->index(1, 0), HistoryDomainListModel::Domain).toString(), QString("example.com"));
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::Domain).toString(), QString("example.com"));
+        QCOMPARE(model->data(model->index(1, 0), HistoryDomainListModel::Domain).toString(), QString("example.org"));
 
         history->add(QUrl("http://example.org/test.html"), "Test page", QUrl());
         QVERIFY(spyRowsInserted.isEmpty());
@@ -98,6 +101,7 @@ private Q_SLOTS:
         QCOMPARE(args.at(0).toModelIndex().row(), 0);
         QCOMPARE(args.at(1).toModelIndex().row(), 0);
         QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::Domain).toString(), QString("example.org"));
     }
 
     void shouldUpdateDomainListWhenRemovingEntries()
@@ -123,9 +127,40 @@ private Q_SLOTS:
         QSignalSpy spyDataChanged(model, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
 
         history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        QCOMPARE(spyRowsMoved.count(), 1);
+        QList<QVariant> args = spyRowsMoved.takeFirst();
+        QCOMPARE(args.at(1).toInt(), 1);
+        QCOMPARE(args.at(2).toInt(), 1);
+        QCOMPARE(args.at(4).toInt(), 0);
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::Domain).toString(), QString("example.org"));
+        verifyDataChanged(spyDataChanged, 0);
+
+        history->add(QUrl("http://example.org/test"), "Example Domain", QUrl());
         QVERIFY(spyRowsMoved.isEmpty());
     }
 
+    void shouldMoveDomainsWhenRemovingEntries()
+    {
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        QTest::qWait(100);
+        history->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        QTest::qWait(100);
+        history->add(QUrl("http://example.org/test"), "Example Domain", QUrl());
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::Domain).toString(), QString("example.org"));
+
+        QSignalSpy spyRowsMoved(model, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+        QSignalSpy spyModelReset(model, SIGNAL(modelReset()));
+        history->removeEntryByUrl(QUrl("http://example.org/test"));
+        QCOMPARE(spyRowsMoved.count(), 1);
+        QList<QVariant> args = spyRowsMoved.takeFirst();
+        QCOMPARE(args.at(1).toInt(), 0);
+        QCOMPARE(args.at(2).toInt(), 0);
+        QCOMPARE(args.at(4).toInt(), 2);
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::Domain).toString(), QString("example.com"));
+        QCOMPARE(model->data(model->index(1, 0), HistoryDomainListModel::Domain).toString(), QString("example.org"));
+        QVERIFY(spyModelReset.isEmpty());
+    }
+
     void shouldUpdateDataWhenDataChanges()
     {
         history->add(QUrl("http://example.com/"), "Example Domain", QUrl());
@@ -138,13 +173,15 @@ private Q_SLOTS:
         history->add(QUrl("http://example.org/foobar"), "Example Domain", QUrl());
         QVERIFY(spyRowsMoved.isEmpty());
         QVERIFY(!spyDataChanged.isEmpty());
-        verifyDataChanged(spyDataChanged, 1);
+        verifyDataChanged(spyDataChanged, 0);
 
         spyDataChanged.clear();
         history->add(QUrl("http://example.org/foobar"), "Example Domain 2", QUrl());
         QVERIFY(spyRowsMoved.isEmpty());
         QVERIFY(!spyDataChanged.isEmpty());
-        verifyDataChanged(spyDataChanged, 1);
+        verifyDataChanged(spyDataChanged, 0);
+        QCOMPARE(model->data(model->index(0, 0), HistoryDomainListModel::LastVisitedTitle).toString(),
+                 QString("Example Domain 2"));
     }
 
     void shouldUpdateWhenChangingSourceModel()
@@ -171,7 +208,7 @@ private Q_SLOTS:
         QCOMPARE(model->rowCount(), 0);
     }
 
-    void shouldKeepDomainsSortedInsertionOrder()
+    void shouldKeepDomainsSortedByLastVisit()
     {
         history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
         history->add(QUrl("http://www.gogle.com/lawnmower"), "Gogle Lawn Mower", QUrl());
@@ -183,8 +220,8 @@ private Q_SLOTS:
         history->add(QUrl("https://es.wikipedia.org/wiki/Wikipedia:Portada"), "Wikipedia, la enciclopedia libre", QUrl());
         QCOMPARE(model->rowCount(), 6);
         QStringList domains;
-        domains << "example.org" << "gogle.com" << "example.com" << "ubuntu.com"
-                << DomainUtils::TOKEN_LOCAL << "wikipedia.org";
+        domains << "wikipedia.org" << "gogle.com" << DomainUtils::TOKEN_LOCAL
+                << "ubuntu.com" << "example.com" << "example.org";
         for (int i = 0; i < domains.count(); ++i) {
             QModelIndex index = model->index(i, 0);
             QString domain = model->data(index, HistoryDomainListModel::Domain).toString();
@@ -205,7 +242,7 @@ private Q_SLOTS:
         history->add(QUrl("http://ubuntu.com/"), "Ubuntu", QUrl());
         QCOMPARE(model->rowCount(), 3);
 
-        QModelIndex index = model->index(0, 0);
+        QModelIndex index = model->index(2, 0);
         QString domain = model->data(index, HistoryDomainListModel::Domain).toString();
         QCOMPARE(domain, QString("example.com"));
         HistoryDomainModel* entries = model->data(index, HistoryDomainListModel::Entries).value<HistoryDomainModel*>();
@@ -220,7 +257,7 @@ private Q_SLOTS:
         QCOMPARE(entries->data(entries->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/test.html"));
         QCOMPARE(entries->data(entries->index(1, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/"));
 
-        index = model->index(2, 0);
+        index = model->index(0, 0);
         domain = model->data(index, HistoryDomainListModel::Domain).toString();
         QCOMPARE(domain, QString("ubuntu.com"));
         entries = model->data(index, HistoryDomainListModel::Entries).value<HistoryDomainModel*>();
@@ -242,6 +279,47 @@ private Q_SLOTS:
         QCOMPARE(entries->rowCount(), 1);
         QVERIFY(!model->data(model->index(0, 0), HistoryDomainListModel::Entries + 3).isValid());
     }
+
+    void benchmarkPopulate_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("10000 entries") << 10000;
+        QTest::newRow("100000 entries") << 100000;
+    }
+
+    void benchmarkPopulate()
+    {
+        QFETCH(int, size);
+        QTemporaryFile tempFile;
+        tempFile.open();
+        DatabaseFixtures::populateHistory(tempFile.fileName(), size, 3000);
+        model->setSourceModel(nullptr);
+        DatabaseFixtures::loadModel(history, tempFile.fileName(), size);
+        QBENCHMARK {
+            model->setSourceModel(history);
+            QCOMPARE(model->rowCount(), 3000);
+            model->setSourceModel(nullptr);
+        }
+    }
+
+    void benchmarkAdd()
+    {
+        // 100k entries over 3k domains, each add moves an entry to the front
+        const int size = 100000;
+        QTemporaryFile tempFile;
+        tempFile.open();
+        DatabaseFixtures::populateHistory(tempFile.fileName(), size, 3000);
+        DatabaseFixtures::loadModel(history, tempFile.fileName(), size);
+        QCOMPARE(model->rowCount(), 3000);
+        int i = 0;
+        QBENCHMARK {
+            int page = (i * 7919) % size;
+            QUrl url(QString("http://example%1.org/page%2").arg(page % 3000).arg(page));
+            history->add(url, "Example Page", QUrl());
+            ++i;
+        }
+        QCOMPARE(history->rowCount(), size);
+    }
 };
 
 QTEST_MAIN(HistoryDomainListModelTests)
@@ -84,6 +84,9 @@ public:
         } else {
             QVector<int> roles;
             roles << LastVisit;
+            if (entryDate(index) != lastVisit.toLocalTime().date()) {
+                roles << LastVisitDate;
+            }
             if (index == 0) {
                 HistoryEntry& entry = m_entries.first();
                 entry.lastVisit = lastVisit;
@@ -125,6 +128,11 @@ private:
         bool hidden;
     };
 
+    QDate entryDate(int index) const
+    {
+        return m_entries.at(index).lastVisit.toLocalTime().date();
+    }
+
     int getEntryIndex(const QUrl& url) const
     {
         for (int i = 0; i < m_entries.count(); ++i) {
@@ -276,6 +284,36 @@ private Q_SLOTS:
         QCOMPARE(model->rowCount(), 2);
     }
 
+    void shouldUpdateDataWhenDataChangesWithoutMoving()
+    {
+        QSignalSpy spyRowsInserted(model, SIGNAL(rowsInserted(const QModelIndex&, int, int)));
+        QSignalSpy spyRowsRemoved(model, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+        QSignalSpy spyModelReset(model, SIGNAL(modelReset()));
+        QDateTime dt1 = QDateTime(QDate(1970, 1, 1), QTime(6, 0, 0));
+        QDateTime dt2 = QDateTime(QDate(1970, 1, 2), QTime(6, 0, 0));
+
+        mockHistory->add(QUrl("http://example.com/"), "Example Domain", "example.com", QUrl(), dt1);
+        QCOMPARE(model->rowCount(), 2);
+        spyRowsInserted.clear();
+
+        mockHistory->add(QUrl("http://example.com/"), "Example Domain", "example.com", QUrl(), dt2);
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(spyRowsInserted.count(), 1);
+        QCOMPARE(spyRowsInserted.first().at(1).toInt(), 1);
+        QCOMPARE(spyRowsRemoved.count(), 1);
+        QCOMPARE(spyRowsRemoved.first().at(1).toInt(), 2);
+        QVERIFY(spyModelReset.isEmpty());
+        QCOMPARE(model->data(model->index(1, 0), HistoryLastVisitDateListModel::LastVisitDate).toDate(), dt2.date());
+
+        // Same date, nothing to update
+        spyRowsInserted.clear();
+        spyRowsRemoved.clear();
+        mockHistory->add(QUrl("http://example.com/"), "Example Domain", "example.com", QUrl(), dt2.addSecs(60));
+        QVERIFY(spyRowsInserted.isEmpty());
+        QVERIFY(spyRowsRemoved.isEmpty());
+        QCOMPARE(model->rowCount(), 2);
+    }
+
     void shouldUpdateWhenChangingSourceModel()
     {
         QDateTime dt1 = QDateTime(QDate(1970, 1, 1), QTime(6, 0, 0));
@@ -16,13 +16,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// system
+#include <time.h>
+
 // Qt
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QTemporaryFile>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
 #include <QtTest/QSignalSpy>
 #include <QtTest/QtTest>
 
 // local
+#include "database-fixtures.h"
 #include "history-model.h"
 
 class HistoryModelTests : public QObject
@@ -32,6 +39,28 @@ class HistoryModelTests : public QObject
 private:
     HistoryModel* model;
 
+    qint64 usedDatabaseSize(const QString& fileName)
+    {
+        qint64 pageCount = DatabaseFixtures::query(fileName, "PRAGMA page_count;").toLongLong();
+        qint64 freePageCount = DatabaseFixtures::query(fileName, "PRAGMA freelist_count;").toLongLong();
+        return (pageCount - freePageCount) * DatabaseFixtures::query(fileName, "PRAGMA page_size;").toLongLong();
+    }
+
+    // Resident set size of the process (Linux only), in bytes
+    qint64 residentMemory()
+    {
+        QFile status("/proc/self/status");
+        if (!status.open(QIODevice::ReadOnly)) {
+            return -1;
+        }
+        Q_FOREACH(const QByteArray& line, status.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+        return -1;
+    }
+
 private Q_SLOTS:
     void init()
     {
@@ -232,7 +261,7 @@ private Q_SLOTS:
         QCOMPARE(model->data(model->index(0, 0), HistoryModel::Icon).toUrl(), QUrl("image://webicon/123"));
         QCOMPARE(model->data(model->index(0, 0), HistoryModel::Visits).toInt(), 1);
         QVERIFY(model->data(model->index(0, 0), HistoryModel::LastVisit).toDateTime() >= now);
-        QVERIFY(!model->data(model->index(0, 0), HistoryModel::LastVisit + 4).isValid());
+        QVERIFY(!model->data(model->index(0, 0), HistoryModel::Frecency + 1).isValid());
     }
 
     void shouldReturnDatabasePath()
@@ -348,6 +377,674 @@ private Q_SLOTS:
         QCOMPARE(spyCount.count(), 3);
     }
 
+    void shouldFlushPendingOperationsInOneBatch()
+    {
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        model->hide(QUrl("http://example.com/"));
+        QTRY_COMPARE(spyFlushed.count(), 1);
+        QList<QVariant> args = spyFlushed.takeFirst();
+        // Two insertions, two visits logged, and one hidden entry
+        QCOMPARE(args.at(0).toInt(), 5);
+        QVERIFY(args.at(1).toLongLong() >= 0);
+    }
+
+    void shouldCoalescePendingOperations()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new HistoryModel;
+        model->setDatabasePath(fileName);
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->update(QUrl("http://example.org/"), "Example Domain 1", QUrl());
+        model->add(QUrl("http://example.org/"), "Example Domain 2", QUrl());
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        model->removeEntryByUrl(QUrl("http://example.com/"));
+        model->hide(QUrl("http://example.net/"));
+        model->unHide(QUrl("http://example.net/"));
+        QTRY_COMPARE(spyFlushed.count(), 1);
+        // One insertion, and the three visits logged
+        QCOMPARE(spyFlushed.takeFirst().at(0).toInt(), 4);
+
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl());
+        model->clearAll();
+        QTRY_COMPARE(spyFlushed.count(), 1);
+        QCOMPARE(spyFlushed.takeFirst().at(0).toInt(), 2);
+
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->update(QUrl("http://example.org/"), "Example Domain 1", QUrl());
+        model->add(QUrl("http://example.org/"), "Example Domain 2", QUrl());
+        QTRY_COMPARE(spyFlushed.count(), 1);
+        delete model;
+        model = new HistoryModel;
+        model->setDatabasePath(fileName);
+        QTRY_COMPARE(model->rowCount(), 1);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/"));
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Title).toString(), QString("Example Domain 2"));
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Visits).toInt(), 2);
+    }
+
+    void shouldFetchOlderEntriesByPage()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 50);
+        delete model;
+        model = new HistoryModel;
+        QCOMPARE(model->pageSize(), 0);
+        model->setPageSize(20);
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 20);
+        QTRY_VERIFY(model->canFetchMore());
+        model->fetchMore();
+        QVERIFY(!model->canFetchMore());
+        QTRY_COMPARE(model->rowCount(), 40);
+        QTRY_VERIFY(model->canFetchMore());
+        model->fetchMore();
+        QTRY_COMPARE(model->rowCount(), 50);
+        QCOMPARE(model->data(model->index(49, 0), HistoryModel::Url).toString(),
+                 QString("http://example49.org/page49"));
+    }
+
+    void shouldMergeNonResidentEntriesWhenPaged()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 50);
+        delete model;
+        model = new HistoryModel;
+        model->setPageSize(10);
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 10);
+
+        // The entry was visited 6 times before, but is not resident yet:
+        // the visits count returned is provisional until it is looked up
+        QUrl url("http://example25.org/page25");
+        QCOMPARE(model->add(url, "Example Page 25", QUrl()), 1);
+        QCOMPARE(model->rowCount(), 11);
+        QTRY_COMPARE(model->data(model->index(0, 0), HistoryModel::Visits).toInt(), 7);
+
+        for (int i = 0; i < 4; ++i) {
+            QTRY_VERIFY(model->canFetchMore());
+            model->fetchMore();
+        }
+        QTRY_COMPARE(model->rowCount(), 50);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), url);
+    }
+
+    void shouldMigrateLegacyDatabase()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 10);
+        DatabaseFixtures::query(fileName, "INSERT INTO history (url, domain, title, icon, visits, lastVisit) "
+                                "SELECT url, domain, 'Duplicate', icon, visits, lastVisit + 3600 "
+                                "FROM history WHERE url = 'http://example3.org/page3';");
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history;").toInt(), 11);
+        QCOMPARE(DatabaseFixtures::query(fileName, "PRAGMA user_version;").toInt(), 0);
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 10);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toString(),
+                 QString("http://example3.org/page3"));
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Title).toString(), QString("Duplicate"));
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Visits).toInt(), 8);
+        delete model;
+        model = new HistoryModel;
+
+        QVERIFY(DatabaseFixtures::query(fileName, "PRAGMA user_version;").toInt() > 0);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM sqlite_master "
+                                         "WHERE type = 'index' AND name = 'history_url';").toInt(), 1);
+    }
+
+    void shouldKeepVisitsLinkedWhenCompactingDatabase()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 10);
+        // Leave a gap in the rowids, that a VACUUM may close
+        DatabaseFixtures::query(fileName, "DELETE FROM history WHERE rowid <= 3;");
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 7);
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        model->add(QUrl("http://example9.org/page9"), "Example Page 9", QUrl());
+        QTRY_COMPARE(spyFlushed.count(), 1);
+
+        // Pruning compacts the database (a full VACUUM for legacy databases)
+        QSignalSpy spyPruned(model, SIGNAL(pruned(int)));
+        model->setMaxCount(5);
+        QTRY_COMPARE(spyPruned.count(), 1);
+        QCOMPARE(DatabaseFixtures::query(fileName, "PRAGMA auto_vacuum;").toInt(), 2);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT id FROM history "
+                                         "WHERE url = 'http://example9.org/page9';").toInt(), 10);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM visits JOIN history "
+                                         "ON history.id = visits.historyId "
+                                         "WHERE url = 'http://example9.org/page9';").toInt(), 1);
+    }
+
+    void shouldBackfillMissingDomains()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 10);
+        DatabaseFixtures::query(fileName, "UPDATE history SET domain = NULL;");
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 10);
+        QCOMPARE(model->data(model->index(3, 0), HistoryModel::Domain).toString(), QString("example3.org"));
+        QTRY_COMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history "
+                                             "WHERE domain = 'example3.org';").toInt(), 1);
+        QTRY_COMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history "
+                                             "WHERE domain IS NOT NULL;").toInt(), 10);
+    }
+
+    void shouldLookUpEntriesAfterReordering()
+    {
+        model->add(QUrl("http://example.org/1"), "Example 1", QUrl());
+        model->add(QUrl("http://example.org/2"), "Example 2", QUrl());
+        model->add(QUrl("http://example.org/3"), "Example 3", QUrl());
+        model->add(QUrl("http://example.org/4"), "Example 4", QUrl());
+        model->add(QUrl("http://example.org/5"), "Example 5", QUrl());
+
+        // Move an entry from the tail, then one from the head
+        QCOMPARE(model->add(QUrl("http://example.org/2"), "Example 2", QUrl()), 2);
+        QCOMPARE(model->add(QUrl("http://example.org/4"), "Example 4", QUrl()), 2);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/4"));
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/2"));
+
+        // Remove entries close to both ends
+        model->removeEntryByUrl(QUrl("http://example.org/2"));
+        model->removeEntryByUrl(QUrl("http://example.org/1"));
+        QCOMPARE(model->rowCount(), 3);
+
+        QVERIFY(model->update(QUrl("http://example.org/3"), "Example 3 updated", QUrl()));
+        QCOMPARE(model->data(model->index(2, 0), HistoryModel::Title).toString(), QString("Example 3 updated"));
+        QVERIFY(model->update(QUrl("http://example.org/5"), "Example 5 updated", QUrl()));
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Title).toString(), QString("Example 5 updated"));
+        QVERIFY(!model->update(QUrl("http://example.org/1"), "Example 1 updated", QUrl()));
+
+        model->hide(QUrl("http://example.org/3"));
+        QCOMPARE(model->data(model->index(2, 0), HistoryModel::Hidden).toBool(), true);
+        QCOMPARE(model->add(QUrl("http://example.org/3"), "Example 3", QUrl()), 2);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://example.org/3"));
+
+        model->removeEntriesByDomain("example.org");
+        QCOMPARE(model->rowCount(), 0);
+        QCOMPARE(model->add(QUrl("http://example.org/3"), "Example 3", QUrl()), 1);
+    }
+
+    void shouldMatchUrlsInDatabase()
+    {
+        QSignalSpy spy(model, SIGNAL(urlsMatched(int, const QList<QUrl>&)));
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("https://ubports.com/"), "UBports", QUrl());
+        model->add(QUrl("http://example.com/"), "Another example", QUrl());
+
+        int requestId = model->matchUrls(QStringList() << "ubp", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        QList<QVariant> args = spy.takeFirst();
+        QCOMPARE(args.at(0).toInt(), requestId);
+        QList<QUrl> urls = args.at(1).value<QList<QUrl>>();
+        QCOMPARE(urls.count(), 1);
+        QCOMPARE(urls.first(), QUrl("https://ubports.com/"));
+
+        model->matchUrls(QStringList() << "example" << "domain", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        urls = spy.takeFirst().at(1).value<QList<QUrl>>();
+        QCOMPARE(urls.count(), 1);
+        QCOMPARE(urls.first(), QUrl("http://example.org/"));
+
+        model->matchUrls(QStringList() << "example", 1);
+        QTRY_COMPARE(spy.count(), 1);
+        QCOMPARE(spy.takeFirst().at(1).value<QList<QUrl>>().count(), 1);
+
+        // Removed entries are not matched anymore
+        model->removeEntryByUrl(QUrl("https://ubports.com/"));
+        model->matchUrls(QStringList() << "ubports", 10);
+        QTRY_COMPARE(spy.count(), 1);
+        QVERIFY(spy.takeFirst().at(1).value<QList<QUrl>>().isEmpty());
+    }
+
+    void shouldLogVisitsAndMaintainFrecency()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new HistoryModel;
+        model->setDatabasePath(fileName);
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.net/"), "Example Domain", QUrl());
+        QVERIFY(qAbs(model->data(model->index(0, 0), HistoryModel::Frecency).toDouble() - 1.0) < 0.01);
+        QVERIFY(qAbs(model->data(model->index(1, 0), HistoryModel::Frecency).toDouble() - 3.0) < 0.01);
+        QVERIFY(qAbs(model->data(model->index(2, 0), HistoryModel::Frecency).toDouble() - 2.0) < 0.01);
+
+        QTRY_COMPARE(spyFlushed.count(), 1);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM visits;").toInt(), 5);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM visits JOIN history "
+                                         "ON history.id = visits.historyId "
+                                         "WHERE url = 'http://example.org/';").toInt(), 3);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT transition FROM visits JOIN history "
+                                         "ON history.id = visits.historyId "
+                                         "WHERE url = 'http://example.com/';").toInt(),
+                 int(HistoryModel::Typed));
+
+        model->removeEntryByUrl(QUrl("http://example.org/"));
+        QTRY_COMPARE(spyFlushed.count(), 2);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM visits;").toInt(), 2);
+
+        delete model;
+        model = new HistoryModel;
+        model->setDatabasePath(fileName);
+        QTRY_COMPARE(model->rowCount(), 2);
+        QVERIFY(qAbs(model->data(model->index(1, 0), HistoryModel::Frecency).toDouble() - 2.0) < 0.01);
+    }
+
+    void shouldWeighVisitsByTransition()
+    {
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), HistoryModel::Link);
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        model->add(QUrl("http://example.net/"), "Example Domain", QUrl(), HistoryModel::Bookmark);
+        double bookmark = model->data(model->index(0, 0), HistoryModel::Frecency).toDouble();
+        double typed = model->data(model->index(1, 0), HistoryModel::Frecency).toDouble();
+        double link = model->data(model->index(2, 0), HistoryModel::Frecency).toDouble();
+        QVERIFY(typed > bookmark);
+        QVERIFY(bookmark > link);
+
+        // A typed visit of an existing entry weighs more than a link
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        model->add(QUrl("http://example.net/"), "Example Domain", QUrl(), HistoryModel::Link);
+        QVERIFY(qAbs(model->data(model->index(1, 0), HistoryModel::Frecency).toDouble()
+                     - (link + typed)) < 0.01);
+        QVERIFY(qAbs(model->data(model->index(0, 0), HistoryModel::Frecency).toDouble()
+                     - (bookmark + link)) < 0.01);
+    }
+
+    void shouldKeepVisitsOfNonResidentEntries()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        delete model;
+        model = new HistoryModel;
+        model->setDatabasePath(fileName);
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        QUrl url("http://example.org/");
+        model->add(url, "Example Domain", QUrl(), HistoryModel::Typed);
+        for (int i = 0; i < 10; ++i) {
+            model->add(QUrl(QString("http://example.com/page%1").arg(i)), "Example Domain", QUrl());
+        }
+        QTRY_COMPARE(spyFlushed.count(), 1);
+
+        delete model;
+        model = new HistoryModel;
+        model->setPageSize(5);
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QSignalSpy spyFlushedPaged(model, SIGNAL(databaseFlushed(int, qint64)));
+        model->add(url, "Example Domain", QUrl());
+        QTRY_COMPARE(spyFlushedPaged.count(), 1);
+        QString visits("SELECT %1 FROM visits JOIN history ON history.id = visits.historyId "
+                       "WHERE url = 'http://example.org/';");
+        QCOMPARE(DatabaseFixtures::query(fileName, visits.arg("COUNT(*)")).toInt(), 2);
+        QCOMPARE(DatabaseFixtures::query(fileName, visits.arg("MAX(transition)")).toInt(),
+                 int(HistoryModel::Typed));
+    }
+
+    void shouldDecayFrecencyOverTime()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 10);
+        // A single visit a month ago, and another one two months ago
+        DatabaseFixtures::query(fileName, QString("UPDATE history SET lastVisit = %1, visits = 1 "
+                                        "WHERE url = 'http://example1.org/page1';")
+                                    .arg(QDateTime::currentDateTimeUtc().addDays(-30).toTime_t()));
+        DatabaseFixtures::query(fileName, QString("UPDATE history SET lastVisit = %1, visits = 1 "
+                                        "WHERE url = 'http://example2.org/page2';")
+                                    .arg(QDateTime::currentDateTimeUtc().addDays(-60).toTime_t()));
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        int index1 = -1;
+        int index2 = -1;
+        for (int i = 0; i < model->rowCount(); ++i) {
+            QString url = model->data(model->index(i, 0), HistoryModel::Url).toString();
+            if (url == "http://example1.org/page1") {
+                index1 = i;
+            } else if (url == "http://example2.org/page2") {
+                index2 = i;
+            }
+        }
+        QVERIFY(qAbs(model->data(model->index(index1, 0), HistoryModel::Frecency).toDouble() - 0.5) < 0.01);
+        QVERIFY(qAbs(model->data(model->index(index2, 0), HistoryModel::Frecency).toDouble() - 0.25) < 0.01);
+
+        // A new visit adds to the decayed score
+        model->add(QUrl("http://example2.org/page2"), "Example Page 2", QUrl());
+        QVERIFY(qAbs(model->data(model->index(0, 0), HistoryModel::Frecency).toDouble() - 1.25) < 0.01);
+    }
+
+    void shouldNotifyAllEntriesWhenRefreshingFrecency()
+    {
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.com/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        double frecency = model->data(model->index(0, 0), HistoryModel::Frecency).toDouble();
+        QTest::qWait(10);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Frecency).toDouble(), frecency);
+
+        qRegisterMetaType<QVector<int> >();
+        QSignalSpy spyChanged(model, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+        model->refreshFrecency();
+        QCOMPARE(spyChanged.count(), 1);
+        QList<QVariant> args = spyChanged.takeFirst();
+        QCOMPARE(args.at(0).toModelIndex().row(), 0);
+        QCOMPARE(args.at(1).toModelIndex().row(), 1);
+        QVector<int> roles = args.at(2).value<QVector<int> >();
+        QCOMPARE(roles.size(), 1);
+        QVERIFY(roles.contains(HistoryModel::Frecency));
+    }
+
+    void shouldPruneEntriesBeyondMaxCount()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 100);
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyPruned(model, SIGNAL(pruned(int)));
+        model->setMaxCount(40);
+        model->setDatabasePath(fileName);
+        QTRY_COMPARE(spyPruned.count(), 1);
+        QCOMPARE(spyPruned.first().at(0).toInt(), 60);
+        // Entries beyond the limit are not even loaded
+        QCOMPARE(model->rowCount(), 40);
+        QCOMPARE(model->data(model->index(39, 0), HistoryModel::Url).toString(),
+                 QString("http://example39.org/page39"));
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history;").toInt(), 40);
+        QCOMPARE(DatabaseFixtures::query(fileName, "PRAGMA auto_vacuum;").toInt(), 2);
+    }
+
+    void shouldNotFetchPagesBeyondMaxCount()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 100);
+
+        delete model;
+        model = new HistoryModel;
+        model->setPageSize(10);
+        model->setMaxCount(25);
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 10);
+        for (int i = 0; i < 2; ++i) {
+            QTRY_VERIFY(model->canFetchMore());
+            model->fetchMore();
+        }
+        QTRY_COMPARE(model->rowCount(), 25);
+        QTest::qWait(100);
+        QVERIFY(!model->canFetchMore());
+        QCOMPARE(model->rowCount(), 25);
+        QCOMPARE(model->data(model->index(24, 0), HistoryModel::Url).toString(),
+                 QString("http://example24.org/page24"));
+    }
+
+    void shouldPruneUrlsInTheOrderOfTheDatabase()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 1);
+        // Visited in the same second: SQLite sorts U+FF21 before U+1F600
+        // (as UTF-8), QString sorts it after (as UTF-16)
+        uint lastVisit = QDateTime::currentDateTimeUtc().addDays(-1).toTime_t();
+        DatabaseFixtures::query(fileName, QString::fromUtf8("INSERT INTO history (url, domain, title, icon, visits, lastVisit) "
+                                                  "VALUES ('http://example.org/\xef\xbc\xa1', 'example.org', "
+                                                  "'A', '', 1, %1);").arg(lastVisit));
+        DatabaseFixtures::query(fileName, QString::fromUtf8("INSERT INTO history (url, domain, title, icon, visits, lastVisit) "
+                                                  "VALUES ('http://example.org/\xf0\x9f\x98\x80', 'example.org', "
+                                                  "'Smiley', '', 1, %1);").arg(lastVisit));
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyPruned(model, SIGNAL(pruned(int)));
+        model->setMaxCount(2);
+        model->setDatabasePath(fileName);
+        QTRY_COMPARE(spyPruned.count(), 1);
+        QCOMPARE(spyPruned.first().at(0).toInt(), 1);
+        QCOMPARE(model->rowCount(), 2);
+        QCOMPARE(model->data(model->index(1, 0), HistoryModel::Title).toString(), QString("Smiley"));
+    }
+
+    void shouldPruneOldEntriesInOneRange()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 100);
+        DatabaseFixtures::query(fileName, "UPDATE history SET lastVisit = lastVisit - 864000 WHERE rowid > 70;");
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        QCOMPARE(model->rowCount(), 100);
+
+        QSignalSpy spyRemoved(model, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+        QSignalSpy spyPruned(model, SIGNAL(pruned(int)));
+        model->setMaxAge(5);
+        QTRY_COMPARE(spyPruned.count(), 1);
+        QCOMPARE(spyPruned.first().at(0).toInt(), 30);
+        QCOMPARE(model->rowCount(), 70);
+        QCOMPARE(spyRemoved.count(), 1);
+        QList<QVariant> args = spyRemoved.takeFirst();
+        QCOMPARE(args.at(1).toInt(), 70);
+        QCOMPARE(args.at(2).toInt(), 99);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history;").toInt(), 70);
+
+        // Remaining entries are still indexed
+        QCOMPARE(model->add(QUrl("http://example69.org/page69"), "Example Page 69", QUrl()), 11);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Url).toString(),
+                 QString("http://example69.org/page69"));
+    }
+
+    void shouldPruneToMaxDatabaseSize()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 5000);
+
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait());
+        qint64 size = usedDatabaseSize(fileName);
+        QVERIFY(size > 0);
+
+        QSignalSpy spyPruned(model, SIGNAL(pruned(int)));
+        model->setMaxDatabaseSize(size / 2);
+        QTRY_COMPARE_WITH_TIMEOUT(spyPruned.count(), 1, 30000);
+        QVERIFY(model->rowCount() > 0);
+        QVERIFY(model->rowCount() < 5000);
+        QCOMPARE(DatabaseFixtures::query(fileName, "SELECT COUNT(*) FROM history;").toInt(), model->rowCount());
+        QVERIFY(usedDatabaseSize(fileName) <= size / 2);
+    }
+
+    void shouldUpdateLastVisitDateWhenTimeZoneChanges()
+    {
+        QByteArray timeZone = qgetenv("TZ");
+        // Those time zones are 25 hours apart, dates always differ
+        // (by one or two days, depending on the time of the day)
+        qputenv("TZ", "Pacific/Pago_Pago");
+        tzset();
+        model->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        QDate date = model->data(model->index(0, 0), HistoryModel::LastVisitDate).toDate();
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::LastVisitDateString).toString(),
+                 date.toString(Qt::ISODate));
+
+        QSignalSpy spy(model, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+        QMetaObject::invokeMethod(model, "checkTimeZone");
+        QCOMPARE(spy.count(), 0);
+
+        qputenv("TZ", "Pacific/Kiritimati");
+        tzset();
+        QMetaObject::invokeMethod(model, "checkTimeZone");
+        QCOMPARE(spy.count(), 1);
+        QVector<int> roles = spy.first().at(2).value<QVector<int>>();
+        QVERIFY(roles.contains(HistoryModel::LastVisitDate));
+        QVERIFY(roles.contains(HistoryModel::LastVisitDateString));
+        QDateTime lastVisit = model->data(model->index(0, 0), HistoryModel::LastVisit).toDateTime();
+        QDate newDate = QDateTime::fromMSecsSinceEpoch(lastVisit.toMSecsSinceEpoch()).toLocalTime().date();
+        QVERIFY(newDate > date);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::LastVisitDate).toDate(), newDate);
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::LastVisitDateString).toString(),
+                 newDate.toString(Qt::ISODate));
+
+        if (timeZone.isNull()) {
+            qunsetenv("TZ");
+        } else {
+            qputenv("TZ", timeZone);
+        }
+        tzset();
+    }
+
+    void benchmarkTimeToLoaded_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("1000 entries") << 1000;
+        QTest::newRow("10000 entries") << 10000;
+        QTest::newRow("100000 entries") << 100000;
+        QTest::newRow("200000 entries") << 200000;
+    }
+
+    void benchmarkTimeToLoaded()
+    {
+        QFETCH(int, size);
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, size);
+        delete model;
+        model = nullptr;
+        QBENCHMARK {
+            HistoryModel history;
+            QSignalSpy spyLoaded(&history, SIGNAL(loaded()));
+            history.setDatabasePath(fileName);
+            QVERIFY(spyLoaded.wait(60000));
+            QCOMPARE(history.rowCount(), size);
+        }
+        model = new HistoryModel;
+    }
+
+    void benchmarkMemoryPerEntry()
+    {
+        const int size = 100000;
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, size);
+        delete model;
+        qint64 before = residentMemory();
+        if (before < 0) {
+            model = new HistoryModel;
+            QSKIP("Resident memory cannot be measured on this platform");
+        }
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait(60000));
+        QCOMPARE(model->rowCount(), size);
+        qint64 after = residentMemory();
+        QTest::setBenchmarkResult(double(after - before) / size, QTest::BytesAllocated);
+    }
+
+    void benchmarkFlush()
+    {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        QString fileName = tempFile.fileName();
+        DatabaseFixtures::populateHistory(fileName, 200000);
+        delete model;
+        model = new HistoryModel;
+        QSignalSpy spyLoaded(model, SIGNAL(loaded()));
+        model->setDatabasePath(fileName);
+        QVERIFY(spyLoaded.wait(60000));
+        QSignalSpy spyFlushed(model, SIGNAL(databaseFlushed(int, qint64)));
+        // Updates spread over the whole table, plus a removal by domain
+        for (int i = 0; i < 1000; ++i) {
+            int row = i * 199;
+            QUrl url(QString("http://example%1.org/page%2").arg(row % 1000).arg(row));
+            QVERIFY(model->update(url, "Updated", QUrl()));
+        }
+        model->removeEntriesByDomain("example999.org");
+        QVERIFY(spyFlushed.wait(60000));
+        // Report the time actually spent writing, not the flush timer delay
+        QTest::setBenchmarkResult(spyFlushed.first().at(1).toLongLong() / 1000.,
+                                  QTest::WalltimeMilliseconds);
+    }
+
+    void benchmarkAddWithGrowingModel_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("1000 entries") << 1000;
+        QTest::newRow("10000 entries") << 10000;
+        QTest::newRow("50000 entries") << 50000;
+    }
+
+    void benchmarkAddWithGrowingModel()
+    {
+        QFETCH(int, size);
+        for (int i = 0; i < size; ++i) {
+            model->add(QUrl(QStringLiteral("http://example.org/%1").arg(i)), "Example Domain", QUrl());
+        }
+        int i = size;
+        QBENCHMARK {
+            model->add(QUrl(QStringLiteral("http://example.org/%1").arg(i++)), "Example Domain", QUrl());
+        }
+    }
+
 };
 
 QTEST_MAIN(HistoryModelTests)
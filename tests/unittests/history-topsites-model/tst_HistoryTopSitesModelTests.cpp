@@ -0,0 +1,170 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Qt
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+// local
+#include "history-model.h"
+#include "history-topsites-model.h"
+
+class HistoryTopSitesModelTests : public QObject
+{
+    Q_OBJECT
+
+private:
+    HistoryModel* history;
+    HistoryTopSitesModel* model;
+
+    QStringList urls() const
+    {
+        QStringList urls;
+        for (int i = 0; i < model->rowCount(); ++i) {
+            urls << model->data(model->index(i, 0), HistoryModel::Url).toString();
+        }
+        return urls;
+    }
+
+    void addEntries()
+    {
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        history->add(QUrl("http://example.net/"), "Example Domain", QUrl());
+    }
+
+private Q_SLOTS:
+    void init()
+    {
+        history = new HistoryModel;
+        history->setDatabasePath(":memory:");
+        model = new HistoryTopSitesModel;
+        model->setSourceModel(history);
+    }
+
+    void cleanup()
+    {
+        delete model;
+        delete history;
+    }
+
+    void shouldBeInitiallyEmpty()
+    {
+        QCOMPARE(model->rowCount(), 0);
+    }
+
+    void shouldNotifyWhenChangingSourceModel()
+    {
+        QSignalSpy spy(model, SIGNAL(sourceModelChanged()));
+        model->setSourceModel(history);
+        QVERIFY(spy.isEmpty());
+        model->setSourceModel(nullptr);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(model->sourceModel(), (HistoryModel*) nullptr);
+        QCOMPARE(model->rowCount(), 0);
+    }
+
+    void shouldRankEntriesByFrecency()
+    {
+        addEntries();
+        QCOMPARE(urls(), QStringList() << "http://example.com/" << "http://example.org/"
+                                       << "http://example.net/");
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.org/"), "Example Domain", QUrl());
+        QCOMPARE(urls(), QStringList() << "http://example.org/" << "http://example.com/"
+                                       << "http://example.net/");
+    }
+
+    void shouldBeBoundedByLimit()
+    {
+        QSignalSpy spy(model, SIGNAL(limitChanged()));
+        model->setLimit(2);
+        QCOMPARE(spy.count(), 1);
+        addEntries();
+        QCOMPARE(urls(), QStringList() << "http://example.com/" << "http://example.org/");
+        history->add(QUrl("http://example.net/"), "Example Domain", QUrl(), HistoryModel::Typed);
+        QCOMPARE(urls(), QStringList() << "http://example.net/" << "http://example.com/");
+        model->setLimit(3);
+        QCOMPARE(model->rowCount(), 3);
+        QCOMPARE(model->data(model->index(2, 0), HistoryModel::Url).toString(),
+                 QString("http://example.org/"));
+    }
+
+    void shouldExcludeHiddenEntries()
+    {
+        model->setLimit(2);
+        addEntries();
+        history->hide(QUrl("http://example.com/"));
+        QCOMPARE(urls(), QStringList() << "http://example.net/" << "http://example.org/");
+        history->unHide(QUrl("http://example.com/"));
+        QCOMPARE(urls(), QStringList() << "http://example.com/" << "http://example.net/");
+    }
+
+    void shouldReplaceRemovedEntries()
+    {
+        model->setLimit(2);
+        addEntries();
+        history->removeEntryByUrl(QUrl("http://example.com/"));
+        QCOMPARE(urls(), QStringList() << "http://example.net/" << "http://example.org/");
+        history->removeEntryByUrl(QUrl("http://example.net/"));
+        QCOMPARE(urls(), QStringList() << "http://example.org/");
+    }
+
+    void shouldMoveRowsInsteadOfResetting()
+    {
+        addEntries();
+        QSignalSpy spyReset(model, SIGNAL(modelReset()));
+        QSignalSpy spyMoved(model, SIGNAL(rowsMoved(const QModelIndex&, int, int, const QModelIndex&, int)));
+        history->add(QUrl("http://example.net/"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.net/"), "Example Domain", QUrl());
+        QCOMPARE(spyMoved.count(), 2);
+        QCOMPARE(urls(), QStringList() << "http://example.net/" << "http://example.com/"
+                                       << "http://example.org/");
+        history->refreshFrecency();
+        QVERIFY(spyReset.isEmpty());
+    }
+
+    void shouldForwardChangesToTopSites()
+    {
+        addEntries();
+        qRegisterMetaType<QVector<int> >();
+        QSignalSpy spy(model, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>&)));
+        history->update(QUrl("http://example.com/"), "Example Domain 2", QUrl());
+        QCOMPARE(spy.count(), 1);
+        QList<QVariant> args = spy.takeFirst();
+        QCOMPARE(args.at(0).toModelIndex().row(), 0);
+        QCOMPARE(args.at(1).toModelIndex().row(), 0);
+        QVERIFY(args.at(2).value<QVector<int> >().contains(HistoryModel::Title));
+        QCOMPARE(model->data(model->index(0, 0), HistoryModel::Title).toString(),
+                 QString("Example Domain 2"));
+    }
+
+    void benchmarkVisit()
+    {
+        for (int i = 0; i < 10000; ++i) {
+            history->add(QUrl(QString("http://example.org/%1").arg(i)), "Example Domain", QUrl());
+        }
+        int i = 0;
+        QBENCHMARK {
+            history->add(QUrl(QString("http://example.org/%1").arg(i++ % 100)), "Example Domain", QUrl());
+        }
+    }
+};
+
+QTEST_MAIN(HistoryTopSitesModelTests)
+#include "tst_HistoryTopSitesModelTests.moc"
@@ -34,6 +34,7 @@
 #include "history-domainlist-model.h"
 #include "history-model.h"
 #include "history-lastvisitdatelist-model.h"
+#include "history-topsites-model.h"
 #include "limit-proxy-model.h"
 #include "reparenter.h"
 #include "searchengine.h"
@@ -182,6 +183,7 @@ int main(int argc, char** argv)
     qmlRegisterType<HistoryDomainModel>(browserUri, 0, 1, "HistoryDomainModel");
     qmlRegisterType<HistoryDomainListModel>(browserUri, 0, 1, "HistoryDomainListModel");
     qmlRegisterType<HistoryLastVisitDateListModel>(browserUri, 0, 1, "HistoryLastVisitDateListModel");
+    qmlRegisterType<HistoryTopSitesModel>(browserUri, 0, 1, "HistoryTopSitesModel");
     qmlRegisterType<LimitProxyModel>(browserUri, 0, 1, "LimitProxyModel");
     qmlRegisterType<TextSearchFilterModel>(browserUri, 0, 1, "TextSearchFilterModel");
     qmlRegisterSingletonType<FileOperations>(browserUri, 0, 1, "FileOperations", FileOperations_singleton_factory);
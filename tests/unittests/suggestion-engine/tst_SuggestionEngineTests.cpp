@@ -0,0 +1,332 @@
+/*
+ * Copyright 2026 UBports Foundation
+ *
+ * This file is part of morph-browser.
+ *
+ * morph-browser is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * morph-browser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Qt
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+// local
+#include "bookmarks-model.h"
+#include "history-model.h"
+#include "suggestion-engine.h"
+
+// A list model with "url" and "title" roles, which may contain duplicates
+class UrlListModel : public QAbstractListModel
+{
+public:
+    enum Roles {
+        Url = Qt::UserRole + 1,
+        Title
+    };
+
+    QHash<int, QByteArray> roleNames() const
+    {
+        QHash<int, QByteArray> roles;
+        roles[Url] = "url";
+        roles[Title] = "title";
+        return roles;
+    }
+
+    int rowCount(const QModelIndex& parent=QModelIndex()) const
+    {
+        Q_UNUSED(parent);
+        return m_rows.count();
+    }
+
+    QVariant data(const QModelIndex& index, int role) const
+    {
+        if (!index.isValid()) {
+            return QVariant();
+        }
+        const QPair<QString, QString>& row = m_rows.at(index.row());
+        switch (role) {
+        case Url:
+            return row.first;
+        case Title:
+            return row.second;
+        default:
+            return QVariant();
+        }
+    }
+
+    void append(const QString& url, const QString& title)
+    {
+        beginInsertRows(QModelIndex(), m_rows.count(), m_rows.count());
+        m_rows.append(qMakePair(url, title));
+        endInsertRows();
+    }
+
+    void remove(int row)
+    {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.removeAt(row);
+        endRemoveRows();
+    }
+
+    void setTitle(int row, const QString& title)
+    {
+        m_rows[row].second = title;
+        Q_EMIT dataChanged(index(row, 0), index(row, 0), QVector<int>() << Title);
+    }
+
+    void reset(const QList<QPair<QString, QString> >& rows)
+    {
+        beginResetModel();
+        m_rows = rows;
+        endResetModel();
+    }
+
+private:
+    QList<QPair<QString, QString> > m_rows;
+};
+
+class SuggestionEngineTests : public QObject
+{
+    Q_OBJECT
+
+private:
+    HistoryModel* history;
+    BookmarksModel* bookmarks;
+    SuggestionEngine* engine;
+
+    QUrl urlAt(int row) const
+    {
+        return engine->data(engine->index(row, 0), SuggestionEngine::Url).toUrl();
+    }
+
+private Q_SLOTS:
+    void init()
+    {
+        history = new HistoryModel;
+        history->setDatabasePath(":memory:");
+        bookmarks = new BookmarksModel;
+        bookmarks->setDatabasePath(":memory:");
+        engine = new SuggestionEngine;
+        engine->setHistoryModel(history);
+        engine->setBookmarksModel(bookmarks);
+    }
+
+    void cleanup()
+    {
+        delete engine;
+        delete bookmarks;
+        delete history;
+    }
+
+    void shouldBeInitiallyEmpty()
+    {
+        QCOMPARE(engine->rowCount(), 0);
+        QCOMPARE(engine->limit(), 4);
+        QVERIFY(engine->terms().isEmpty());
+    }
+
+    void shouldNotSuggestAnythingWithoutTerms()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        QCOMPARE(engine->rowCount(), 0);
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 1);
+        engine->setTerms(QStringList());
+        QCOMPARE(engine->rowCount(), 0);
+    }
+
+    void shouldMatchAllTerms()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com"), "Example Domain", QUrl());
+        history->add(QUrl("http://wikipedia.org"), "Wikipedia", QUrl());
+        QSignalSpy spyCount(engine, SIGNAL(countChanged()));
+        engine->setTerms(QStringList({"EXAMPLE", "org"}));
+        QCOMPARE(spyCount.count(), 1);
+        QCOMPARE(engine->rowCount(), 1);
+        QCOMPARE(urlAt(0), QUrl("http://example.org"));
+        engine->setTerms(QStringList({"example", "domain"}));
+        QCOMPARE(engine->rowCount(), 2);
+        engine->setTerms(QStringList({"example", "ubuntu"}));
+        QCOMPARE(engine->rowCount(), 0);
+    }
+
+    void shouldRankPrefixAndWordHitsFirst()
+    {
+        history->add(QUrl("http://test.com/counterexample"), "Other", QUrl());
+        history->add(QUrl("http://test.com/example"), "Test page", QUrl());
+        history->add(QUrl("http://www.example.com"), "Home", QUrl());
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 3);
+        QCOMPARE(urlAt(0), QUrl("http://www.example.com"));
+        QCOMPARE(urlAt(1), QUrl("http://test.com/example"));
+        QCOMPARE(urlAt(2), QUrl("http://test.com/counterexample"));
+        double first = engine->data(engine->index(0, 0), SuggestionEngine::Score).toDouble();
+        double last = engine->data(engine->index(2, 0), SuggestionEngine::Score).toDouble();
+        QVERIFY(first > last);
+    }
+
+    void shouldMergeAndBoostBookmarks()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com"), "Example Domain", QUrl());
+        bookmarks->add(QUrl("http://example.org"), "Example Domain", QUrl(), "");
+        bookmarks->add(QUrl("http://example.net"), "Example", QUrl(), "");
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 3);
+        QCOMPARE(urlAt(0), QUrl("http://example.org"));
+        QCOMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Sources).toInt(),
+                 int(SuggestionEngine::History | SuggestionEngine::Bookmark));
+        QCOMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Icon).toString(), QString("non-starred"));
+        QCOMPARE(urlAt(1), QUrl("http://example.com"));
+        QCOMPARE(engine->data(engine->index(1, 0), SuggestionEngine::Icon).toString(), QString("history"));
+        QCOMPARE(urlAt(2), QUrl("http://example.net"));
+        QCOMPARE(engine->data(engine->index(2, 0), SuggestionEngine::Sources).toInt(),
+                 int(SuggestionEngine::Bookmark));
+    }
+
+    void shouldLimitResults()
+    {
+        for (int i = 0; i < 10; ++i) {
+            history->add(QUrl(QString("http://example.org/%1").arg(i)), "Example Domain", QUrl());
+        }
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 4);
+        QSignalSpy spyLimit(engine, SIGNAL(limitChanged()));
+        engine->setLimit(2);
+        QCOMPARE(spyLimit.count(), 1);
+        QCOMPARE(engine->rowCount(), 2);
+        engine->setLimit(0);
+        QCOMPARE(engine->rowCount(), 0);
+        engine->setLimit(-1);
+        QCOMPARE(engine->rowCount(), 10);
+    }
+
+    void shouldUpdateWhenSourceModelsChange()
+    {
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 0);
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        QTRY_COMPARE(engine->rowCount(), 1);
+        bookmarks->add(QUrl("http://example.com"), "Example Domain", QUrl(), "");
+        QTRY_COMPARE(engine->rowCount(), 2);
+        history->removeEntryByUrl(QUrl("http://example.org"));
+        QTRY_COMPARE(engine->rowCount(), 1);
+        engine->setHistoryModel(nullptr);
+        engine->setBookmarksModel(nullptr);
+        QTRY_COMPARE(engine->rowCount(), 0);
+    }
+
+    void shouldUpdateChangedEntries()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        history->add(QUrl("http://example.com"), "Example Domain", QUrl());
+        engine->setTerms(QStringList({"domain"}));
+        QCOMPARE(engine->rowCount(), 2);
+        history->update(QUrl("http://example.org"), "Example Site", QUrl());
+        QTRY_COMPARE(engine->rowCount(), 1);
+        QCOMPARE(urlAt(0), QUrl("http://example.com"));
+        engine->setTerms(QStringList({"site"}));
+        QCOMPARE(engine->rowCount(), 1);
+        QCOMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Title).toString(),
+                 QString("Example Site"));
+    }
+
+    void shouldRefineAndWidenMatches()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        history->add(QUrl("http://exam.org"), "Exam results", QUrl());
+        history->add(QUrl("http://wikipedia.org"), "Wikipedia", QUrl());
+        engine->setTerms(QStringList({"exa"}));
+        QCOMPARE(engine->rowCount(), 2);
+        engine->setTerms(QStringList({"examp"}));
+        QCOMPARE(engine->rowCount(), 1);
+        history->add(QUrl("http://example.com"), "Example Domain", QUrl());
+        QTRY_COMPARE(engine->rowCount(), 2);
+        engine->setTerms(QStringList({"examp", "org"}));
+        QCOMPARE(engine->rowCount(), 1);
+        QCOMPARE(urlAt(0), QUrl("http://example.org"));
+        engine->setTerms(QStringList({"org"}));
+        QCOMPARE(engine->rowCount(), 3);
+    }
+
+    void shouldMergeRowsWithTheSameUrl()
+    {
+        UrlListModel tabs;
+        tabs.append("http://example.org", "");
+        tabs.append("http://example.org", "Example Domain");
+        engine->setTabsModel(&tabs);
+        engine->setTerms(QStringList({"example"}));
+        QCOMPARE(engine->rowCount(), 1);
+        QCOMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Title).toString(),
+                 QString("Example Domain"));
+        tabs.remove(1);
+        QTRY_COMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Title).toString(), QString());
+        tabs.setTitle(0, "Example");
+        QTRY_COMPARE(engine->data(engine->index(0, 0), SuggestionEngine::Title).toString(),
+                     QString("Example"));
+        tabs.remove(0);
+        QTRY_COMPARE(engine->rowCount(), 0);
+        tabs.reset(QList<QPair<QString, QString> >() << qMakePair(QString("http://example.com"), QString()));
+        QTRY_COMPARE(engine->rowCount(), 1);
+        QCOMPARE(urlAt(0), QUrl("http://example.com"));
+        engine->setTabsModel(nullptr);
+    }
+
+    void shouldReturnData()
+    {
+        history->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        engine->setTerms(QStringList({"example"}));
+        QVariantMap item = engine->get(0);
+        QCOMPARE(item.value("url").toUrl(), QUrl("http://example.org"));
+        QCOMPARE(item.value("title").toString(), QString("Example Domain"));
+        QCOMPARE(item.value("icon").toString(), QString("history"));
+        QVERIFY(item.value("displayUrl").toBool());
+        QVERIFY(engine->get(1).isEmpty());
+        QVERIFY(!engine->data(QModelIndex(), SuggestionEngine::Url).isValid());
+    }
+
+    void benchmarkKeystroke_data()
+    {
+        QTest::addColumn<int>("limit");
+        QTest::newRow("unlimited") << -1;
+        QTest::newRow("limit 4") << 4;
+    }
+
+    void benchmarkKeystroke()
+    {
+        // 100k entries, 3 terms, as when typing in the address bar
+        UrlListModel urls;
+        QList<QPair<QString, QString> > rows;
+        for (int i = 0; i < 100000; ++i) {
+            rows.append(qMakePair(QString("http://example%1.org/page%2").arg(i % 3000).arg(i),
+                                  QString("Example Page %1").arg(i)));
+        }
+        urls.reset(rows);
+        engine->setHistoryModel(&urls);
+        engine->setBookmarksModel(nullptr);
+        QFETCH(int, limit);
+        engine->setLimit(limit);
+        engine->setTerms(QStringList({"example"}));
+        QBENCHMARK {
+            engine->setTerms(QStringList({"example", "PAGE", "42"}));
+            QVERIFY(engine->rowCount() > 0);
+            engine->setTerms(QStringList({"example", "PAGE", "421"}));
+            QVERIFY(engine->rowCount() > 0);
+        }
+        engine->setHistoryModel(nullptr);
+    }
+};
+
+QTEST_MAIN(SuggestionEngineTests)
+#include "tst_SuggestionEngineTests.moc"
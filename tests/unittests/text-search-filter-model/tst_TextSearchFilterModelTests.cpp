@@ -17,6 +17,7 @@
  */
 
 // Qt
+#include <QtCore/QStringListModel>
 #include <QtTest/QSignalSpy>
 #include <QtTest/QtTest>
 
@@ -140,6 +141,38 @@ private Q_SLOTS:
         QCOMPARE(matches->rowCount(), 1);
     }
 
+    void shouldUpdateResultsWhenRefiningAndBroadeningTerms()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        model->add(QUrl("http://ubports.com"), "UBports", QUrl());
+        model->add(QUrl("http://ubuntu.com/download"), "Download Ubuntu | Ubuntu", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        QCOMPARE(matches->rowCount(), 4);
+        QSignalSpy spyModelReset(matches, SIGNAL(modelReset()));
+        QSignalSpy spyRowsRemoved(matches, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+        matches->setTerms(QStringList({"ub"}));
+        QCOMPARE(matches->rowCount(), 3);
+        matches->setTerms(QStringList({"ubu"}));
+        QCOMPARE(matches->rowCount(), 2);
+        matches->setTerms(QStringList({"ubu", "home"}));
+        QCOMPARE(matches->rowCount(), 1);
+        QVERIFY(spyModelReset.isEmpty());
+        QCOMPARE(spyRowsRemoved.count(), 3);
+
+        // Rows that change are matched again
+        model->update(QUrl("http://example.org"), "Ubuntu Home", QUrl());
+        QCOMPARE(matches->rowCount(), 2);
+        matches->setTerms(QStringList({"ubuntu", "home"}));
+        QCOMPARE(matches->rowCount(), 2);
+
+        // Terms that are removed or shortened broaden the results again
+        matches->setTerms(QStringList({"ubuntu"}));
+        QCOMPARE(matches->rowCount(), 3);
+        matches->setTerms(QStringList({"ub"}));
+        QCOMPARE(matches->rowCount(), 4);
+    }
+
     void shouldUpdateResultsWhenSourceModelUpdates()
     {
         model->add(QUrl("http://example.org"), "Example Domain", QUrl());
@@ -151,6 +184,52 @@ private Q_SLOTS:
         QCOMPARE(matches->rowCount(), 1);
     }
 
+    void shouldUpdateResultsWhenSourceDataChanges()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://example.com"), "Example Domain", QUrl());
+        matches->setTerms(QStringList({"ubuntu"}));
+        matches->setSearchFields(QStringList({"url", "title"}));
+        QCOMPARE(matches->rowCount(), 0);
+        model->update(QUrl("http://example.org"), "Home | Ubuntu", QUrl());
+        QCOMPARE(matches->rowCount(), 1);
+        model->update(QUrl("http://example.org"), "Example Domain", QUrl());
+        QCOMPARE(matches->rowCount(), 0);
+    }
+
+    void shouldMatchCaseInsensitively()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        matches->setTerms(QStringList({"UBUNTU"}));
+        QCOMPARE(matches->rowCount(), 1);
+        matches->setTerms(QStringList({"eXaMpLe", "DOMAIN"}));
+        QCOMPARE(matches->rowCount(), 1);
+    }
+
+    void shouldNotMatchAcrossFields()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        matches->setTerms(QStringList({"orgexample"}));
+        QCOMPARE(matches->rowCount(), 0);
+    }
+
+    void shouldMatchLongHaystacks()
+    {
+        QStringListModel strings;
+        QString prefix(100, QChar('a'));
+        strings.setStringList(QStringList({prefix + "Needle" + prefix, prefix + "needl" + prefix, prefix + "NEEDLE"}));
+        matches->setSourceModel(QVariant::fromValue(static_cast<QAbstractItemModel*>(&strings)));
+        matches->setSearchFields(QStringList({"display"}));
+        matches->setTerms(QStringList({"needle"}));
+        QCOMPARE(matches->rowCount(), 2);
+        matches->setTerms(QStringList({"aneedlea"}));
+        QCOMPARE(matches->rowCount(), 1);
+        matches->setSourceModel(QVariant());
+    }
+
     void shouldMatchAllTerms()
     {
         model->add(QUrl("http://example.org"), "Example Domain", QUrl());
@@ -186,6 +265,149 @@ private Q_SLOTS:
         matches->setSearchFields(QStringList({"url", "foo"}));
         QCOMPARE(matches->count(), 1);
     }
+
+    void shouldFilterAsynchronously()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        model->add(QUrl("http://wikipedia.org"), "Wikipedia", QUrl());
+        model->add(QUrl("http://ubuntu.com/download"), "Download Ubuntu | Ubuntu", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        QCOMPARE(matches->rowCount(), 4);
+
+        QSignalSpy spyAsynchronous(matches, SIGNAL(asynchronousChanged()));
+        matches->setAsynchronous(true);
+        QVERIFY(matches->asynchronous());
+        QCOMPARE(spyAsynchronous.count(), 1);
+
+        QSignalSpy spyBusy(matches, SIGNAL(busyChanged()));
+        QSignalSpy spyCount(matches, SIGNAL(countChanged()));
+        QSignalSpy spyModelReset(matches, SIGNAL(modelReset()));
+        matches->setTerms(QStringList({"wiki"}));
+        QVERIFY(matches->busy());
+        QCOMPARE(spyBusy.count(), 1);
+        QVERIFY(spyCount.isEmpty());
+
+        // Superseded by new terms before it completes
+        matches->setTerms(QStringList({"ubuntu"}));
+        QVERIFY(matches->busy());
+        QCOMPARE(spyBusy.count(), 1);
+
+        QTRY_VERIFY(!matches->busy());
+        QCOMPARE(spyBusy.count(), 2);
+        QCOMPARE(spyCount.count(), 1);
+        QVERIFY(spyModelReset.isEmpty());
+        QCOMPARE(matches->rowCount(), 2);
+
+        // Source model changes while busy are filtered with the previous
+        // terms, and matched against the new ones once done
+        matches->setTerms(QStringList({"ubuntu", "home"}));
+        model->add(QUrl("http://ubuntu.com/home"), "Ubuntu", QUrl());
+        QVERIFY(matches->busy());
+        QCOMPARE(matches->rowCount(), 3);
+        QTRY_VERIFY(!matches->busy());
+        QCOMPARE(matches->rowCount(), 2);
+
+        matches->setTerms(QStringList());
+        QVERIFY(!matches->busy());
+        QCOMPARE(matches->rowCount(), 5);
+    }
+
+    void shouldApplySourceChangesOnceFilteredAsynchronously()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        model->add(QUrl("http://wikipedia.org"), "Wikipedia", QUrl());
+        model->add(QUrl("http://ubuntu.com/download"), "Download Ubuntu | Ubuntu", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        matches->setAsynchronous(true);
+
+        matches->setTerms(QStringList({"ubuntu"}));
+        QVERIFY(matches->busy());
+        model->removeEntryByUrl(QUrl("http://ubuntu.com"));
+        model->update(QUrl("http://wikipedia.org"), "Ubuntu - Wikipedia", QUrl());
+        model->add(QUrl("http://ubuntu.com/phone"), "Ubuntu Touch", QUrl());
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        QVERIFY(matches->busy());
+        QCOMPARE(matches->rowCount(), 4);
+
+        QTRY_VERIFY(!matches->busy());
+        QCOMPARE(matches->rowCount(), 3);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://ubuntu.com/phone"));
+        QCOMPARE(matches->data(matches->index(1, 0), HistoryModel::Url).toUrl(), QUrl("http://ubuntu.com/download"));
+        QCOMPARE(matches->data(matches->index(2, 0), HistoryModel::Url).toUrl(), QUrl("http://wikipedia.org"));
+    }
+
+    void shouldLimitResults()
+    {
+        model->add(QUrl("http://example.org"), "Example Domain", QUrl());
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        model->add(QUrl("http://wikipedia.org"), "Wikipedia", QUrl());
+        model->add(QUrl("http://ubuntu.com/download"), "Download Ubuntu | Ubuntu", QUrl());
+        matches->setSearchFields(QStringList({"url", "title"}));
+        matches->setTerms(QStringList({"org"}));
+        QCOMPARE(matches->limit(), -1);
+        QCOMPARE(matches->rowCount(), 2);
+
+        QSignalSpy spyLimit(matches, SIGNAL(limitChanged()));
+        matches->setLimit(1);
+        QCOMPARE(spyLimit.count(), 1);
+        QCOMPARE(matches->rowCount(), 1);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://wikipedia.org"));
+
+        // Rows past the limit are ignored, rows before it are taken into account
+        matches->setTerms(QStringList({"ubuntu"}));
+        QCOMPARE(matches->rowCount(), 1);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://ubuntu.com/download"));
+        model->add(QUrl("http://ubports.com"), "UBports | Ubuntu", QUrl());
+        QCOMPARE(matches->rowCount(), 1);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://ubports.com"));
+        model->add(QUrl("http://ubuntu.com"), "Home | Ubuntu", QUrl());
+        QCOMPARE(matches->rowCount(), 1);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://ubuntu.com"));
+        model->removeEntryByUrl(QUrl("http://ubuntu.com"));
+        QCOMPARE(matches->rowCount(), 1);
+        QCOMPARE(matches->data(matches->index(0, 0), HistoryModel::Url).toUrl(), QUrl("http://ubports.com"));
+
+        // Raising the limit resumes matching
+        matches->setLimit(2);
+        QCOMPARE(matches->rowCount(), 2);
+        matches->setLimit(10);
+        QCOMPARE(matches->rowCount(), 2);
+        matches->setLimit(0);
+        QCOMPARE(matches->rowCount(), 0);
+        matches->setLimit(-1);
+        QCOMPARE(matches->rowCount(), 2);
+        QCOMPARE(spyLimit.count(), 5);
+    }
+
+    void benchmarkFilter_data()
+    {
+        QTest::addColumn<int>("limit");
+        QTest::newRow("unlimited") << -1;
+        QTest::newRow("limit 2") << 2;
+    }
+
+    void benchmarkFilter()
+    {
+        // 100k rows, 3 terms, as when typing in the address bar
+        QStringList rows;
+        for (int i = 0; i < 100000; ++i) {
+            rows.append(QString("http://example%1.org/page%2 Example Page %2").arg(i % 3000).arg(i));
+        }
+        QStringListModel strings(rows);
+        matches->setSourceModel(QVariant::fromValue(static_cast<QAbstractItemModel*>(&strings)));
+        matches->setSearchFields(QStringList({"display"}));
+        QFETCH(int, limit);
+        matches->setLimit(limit);
+        QBENCHMARK {
+            matches->setTerms(QStringList({"example", "PAGE", "42"}));
+            QVERIFY(matches->rowCount() > 0);
+            matches->setTerms(QStringList({"example", "PAGE", "421"}));
+            QVERIFY(matches->rowCount() > 0);
+        }
+        matches->setSourceModel(QVariant());
+    }
 };
 
 QTEST_MAIN(TextSearchFilterModelTests)